@@ -0,0 +1,52 @@
+# Writes a C++ source with every file of SPIRV_FILES as a byte array and a lookup table for FindEmbeddedSpirv().
+# usage: cmake -DSPIRV_FILES=<a.spv|b.spv|...> -DOUTPUT=<file.cpp> -P embed_spirv.cmake
+
+string(REPLACE "|" ";" SPIRV_FILES "${SPIRV_FILES}")
+list(SORT SPIRV_FILES)
+
+set(ARRAYS "")
+set(TABLE "")
+set(INDEX 0)
+foreach(SPV ${SPIRV_FILES})
+  get_filename_component(NAME ${SPV} NAME)
+  file(READ ${SPV} HEX HEX)
+  string(LENGTH "${HEX}" HEX_LEN)
+  math(EXPR SIZE "${HEX_LEN} / 2")
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+  string(APPEND ARRAYS "alignas(4) static const unsigned char spirv${INDEX}[] = {${BYTES}};\n")
+  string(APPEND TABLE "  {\"${NAME}\", spirv${INDEX}, ${SIZE}},\n")
+  math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// generated by cmake/embed_spirv.cmake from the modules built from shaders/*.comp, do not edit
+#include \"embedded_spirv.h\"
+
+#include <cstring>
+
+${ARRAYS}
+static const EmbeddedSpirv embedded[] = {
+${TABLE}  {nullptr, nullptr, 0}
+};
+
+const EmbeddedSpirv* FindEmbeddedSpirv(const char* a_path)
+{
+  const char* name = a_path;
+  for(const char* p = a_path; *p != '\\0'; ++p)
+  {
+    if(*p == '/' || *p == '\\\\')
+      name = p + 1;
+  }
+
+  for(const EmbeddedSpirv* e = embedded; e->name != nullptr; ++e)
+  {
+    if(std::strcmp(e->name, name) == 0)
+      return e;
+  }
+  return nullptr;
+}
+")
+
+# keep the timestamp of an unchanged output, so the executable is not relinked for nothing
+configure_file(${OUTPUT}.tmp ${OUTPUT} COPYONLY)
+file(REMOVE ${OUTPUT}.tmp)
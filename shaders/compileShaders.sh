@@ -1,2 +1,14 @@
 glslangValidator -V shader.comp -o comp.spv --D GLSL
-glslangValidator -V shader_varying_work.comp -o shader_varying_work.spv --D GLSL
\ No newline at end of file
+glslangValidator -V shader_varying_work.comp -o shader_varying_work.spv --D GLSL
+glslangValidator -V shader_persistent.comp -o shader_persistent.spv --D GLSL
+glslangValidator -V shader_persistent.comp -o shader_persistent_varying_work.spv --D GLSL -DVARYING_WORK
+glslangValidator -V shader_mariani_silver.comp -o shader_mariani_silver.spv --D GLSL
+glslangValidator -V shader_colorize.comp -o shader_colorize.spv --D GLSL
+glslangValidator -V shader_histogram.comp -o shader_histogram.spv --D GLSL
+glslangValidator -V shader_progressive.comp -o shader_progressive.spv --D GLSL
+glslangValidator -V shader_edge_detect.comp -o shader_edge_detect.spv --D GLSL
+glslangValidator -V shader_supersample.comp -o shader_supersample.spv --D GLSL
+glslangValidator -V shader_float_float.comp -o shader_float_float.spv --D GLSL
+glslangValidator -V shader_fp64.comp -o shader_fp64.spv --D GLSL
+glslangValidator -V shader_perturbation.comp -o shader_perturbation.spv --D GLSL
+glslangValidator -V shader_optimized.comp -o shader_optimized.spv --D GLSL
\ No newline at end of file
@@ -1,13 +1,86 @@
 #ifndef VK_ASYNC_COMPUTE_SHADERCOMMON_H
 #define VK_ASYNC_COMPUTE_SHADERCOMMON_H
 
-#define WIDTH 2048
-#define HEIGHT 2048
-#define WORKGROUP_SIZE 16
+// Default render parameters. In shaders they are specialization constants and the host
+// overrides them at pipeline creation (see KernelParams in src/kernel_params.h).
+#define DEFAULT_WIDTH 2048
+#define DEFAULT_HEIGHT 2048
+#define DEFAULT_WORKGROUP_SIZE 16
 
-#define TILE_X 128
-#define TILE_Y 128
+#define DEFAULT_TILE_X 128
+#define DEFAULT_TILE_Y 128
 
-#define MANDELBROT_ITERATIONS 256
+#define DEFAULT_MANDELBROT_ITERATIONS 256
+
+// layout of the fractal buffer (binding 0)
+#define OUTPUT_FORMAT_RGBA32F 0 // vec4 per pixel, 16 bytes
+#define OUTPUT_FORMAT_RGBA8   1 // packUnorm4x8 color, 4 bytes
+#define OUTPUT_FORMAT_ITER16  2 // raw iteration count clamped to 65535, 2 bytes; colored on the host
+#define OUTPUT_FORMAT_SMOOTH32F 3 // fractional (smooth) iteration count as a float, 4 bytes
+
+#define DEFAULT_OUTPUT_FORMAT OUTPUT_FORMAT_RGBA32F
+
+// |z|^2 past which an orbit has escaped. The smooth count takes a large one: past 2 the log-log term is off by up to a
+// count right where the integer count changes, so neighbouring pixels jump.
+#define DEFAULT_BAILOUT 2.0f
+#define SMOOTH_BAILOUT  256.0f
+
+// interior shortcuts of shader_optimized.comp, the other kernels ignore them
+#define KERNEL_FEATURE_INTERIOR_TEST 1 // main cardioid and period-2 bulb are inside without iterating
+#define KERNEL_FEATURE_PERIODICITY   2 // Brent-style cycle detection ends orbits caught in an attracting cycle
+
+#define DEFAULT_KERNEL_FEATURES (KERNEL_FEATURE_INTERIOR_TEST | KERNEL_FEATURE_PERIODICITY)
+
+// --tile-cache: shader.comp, shader_optimized.comp and shader_mariani_silver.comp take c of the first pixel of the
+// tile and the tile size from the push constants (tileOriginC()), so a tile's pixels depend on nothing but what the
+// cache key holds
+#define KERNEL_FEATURE_TILE_ORIGIN   4
+
+// specialization constant ids
+#define SPEC_ID_WIDTH 0
+#define SPEC_ID_HEIGHT 1
+#define SPEC_ID_WORKGROUP_SIZE_X 2
+#define SPEC_ID_WORKGROUP_SIZE_Y 3
+#define SPEC_ID_TILE_X 4
+#define SPEC_ID_TILE_Y 5
+#define SPEC_ID_MANDELBROT_ITERATIONS 6
+#define SPEC_ID_OUTPUT_FORMAT 7
+#define SPEC_ID_KERNEL_FEATURES 8
+
+// colors in the palette uniform buffer of shader_colorize.comp
+#define PALETTE_SIZE 256
+// bins of the iteration histogram of shader_histogram.comp, spread evenly over [0, MANDELBROT_ITERATIONS]
+#define HISTOGRAM_BINS 256
+// invocations of a shader_supersample.comp workgroup, one edge pixel each
+#define SUPERSAMPLE_GROUP 64
+
+#ifndef __cplusplus
+
+layout(constant_id = SPEC_ID_WIDTH)  const uint WIDTH  = DEFAULT_WIDTH;
+layout(constant_id = SPEC_ID_HEIGHT) const uint HEIGHT = DEFAULT_HEIGHT;
+layout(constant_id = SPEC_ID_TILE_X) const uint TILE_X = DEFAULT_TILE_X;
+layout(constant_id = SPEC_ID_TILE_Y) const uint TILE_Y = DEFAULT_TILE_Y;
+layout(constant_id = SPEC_ID_MANDELBROT_ITERATIONS) const uint MANDELBROT_ITERATIONS = DEFAULT_MANDELBROT_ITERATIONS;
+layout(constant_id = SPEC_ID_OUTPUT_FORMAT) const uint OUTPUT_FORMAT = DEFAULT_OUTPUT_FORMAT;
+layout(constant_id = SPEC_ID_KERNEL_FEATURES) const uint KERNEL_FEATURES = DEFAULT_KERNEL_FEATURES;
+
+#define BAILOUT ((OUTPUT_FORMAT == OUTPUT_FORMAT_SMOOTH32F) ? SMOOTH_BAILOUT : DEFAULT_BAILOUT)
+
+// fractional count of an orbit that passed BAILOUT after a_n iterations at a_z: n + 1 right at the bailout, down to n
+// where one more iteration would have been needed, so it is continuous between pixels whose n differs
+float smoothCount(float a_n, vec2 a_z)
+{
+  if(a_n >= float(MANDELBROT_ITERATIONS))
+    return a_n;
+  return clamp(a_n + 1.0 - log2(log2(dot(a_z, a_z)) / log2(BAILOUT)), 0.0, float(MANDELBROT_ITERATIONS));
+}
+
+// KERNEL_FEATURE_TILE_ORIGIN: c of pixel a_local of a tile whose first pixel is at a_origin, one pixel size step per pixel
+vec2 tileOriginC(vec2 a_origin, uvec2 a_local, float a_scale)
+{
+  return a_origin + vec2(a_local) * (a_scale / vec2(WIDTH, HEIGHT));
+}
+
+#endif
 
 #endif //VK_ASYNC_COMPUTE_SHADERCOMMON_H
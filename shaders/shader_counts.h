@@ -0,0 +1,18 @@
+#ifndef VK_ASYNC_COMPUTE_SHADER_COUNTS_H
+#define VK_ASYNC_COMPUTE_SHADER_COUNTS_H
+
+// Read side of shader_output.h for the passes that run over a finished render of iteration counts
+// (OUTPUT_FORMAT_ITER16 or OUTPUT_FORMAT_SMOOTH32F).
+layout(std430, binding = 0) readonly buffer iterationBuf
+{
+  uint counts[];
+};
+
+float loadCount(uint a_index)
+{
+  if(OUTPUT_FORMAT == OUTPUT_FORMAT_SMOOTH32F)
+    return uintBitsToFloat(counts[a_index]);
+  return float((counts[a_index >> 1] >> ((a_index & 1u) * 16u)) & 0xFFFFu);
+}
+
+#endif //VK_ASYNC_COMPUTE_SHADER_COUNTS_H
@@ -0,0 +1,19 @@
+#ifndef VK_ASYNC_COMPUTE_SHADER_EDGES_H
+#define VK_ASYNC_COMPUTE_SHADER_EDGES_H
+
+// Edge list of --supersample, EdgeListHeader in src/supersampler.h. The host resets the header before every run,
+// shader_edge_detect.comp appends pixels and sizes the indirect dispatch of shader_supersample.comp to them.
+// Set EDGE_LIST_BINDING before the include.
+layout(std430, binding = EDGE_LIST_BINDING) buffer edgeList
+{
+  uint  groupsX;   // VkDispatchIndirectCommand of the supersample pass, groupsY and groupsZ are 1
+  uint  groupsY;
+  uint  groupsZ;
+  uint  count;     // pixels in the list
+  uint  grid;      // samples per axis of an edge pixel
+  float threshold; // neighbours whose counts differ by more than this make a pixel an edge
+  uint  pad[2];
+  uint  pixels[];  // row-major pixel indices, in no particular order
+} edges;
+
+#endif //VK_ASYNC_COMPUTE_SHADER_EDGES_H
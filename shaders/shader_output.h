@@ -0,0 +1,41 @@
+#ifndef VK_ASYNC_COMPUTE_SHADER_OUTPUT_H
+#define VK_ASYNC_COMPUTE_SHADER_OUTPUT_H
+
+// The fractal buffer is a plain array of words; OUTPUT_FORMAT (a specialization constant) selects how a pixel is
+// stored, so every format is the same SPIR-V module and the untaken branches are removed at pipeline creation.
+layout(std430, binding = 0) buffer buf
+{
+   uint imageData[];
+};
+
+// a_smooth is the fractional iteration count stored by OUTPUT_FORMAT_SMOOTH32F
+void storePixel(uint a_index, vec4 a_color, uint a_iterations, float a_smooth)
+{
+  if(OUTPUT_FORMAT == OUTPUT_FORMAT_RGBA8)
+    imageData[a_index] = packUnorm4x8(a_color);
+  else if(OUTPUT_FORMAT == OUTPUT_FORMAT_ITER16)
+  {
+    // two pixels share a word and the neighbour may belong to another invocation (or tile),
+    // so only our half is cleared and set; the other half is never touched
+    uint shift = (a_index & 1u) * 16u;
+    atomicAnd(imageData[a_index >> 1], ~(0xFFFFu << shift));
+    atomicOr (imageData[a_index >> 1], min(a_iterations, 0xFFFFu) << shift);
+  }
+  else if(OUTPUT_FORMAT == OUTPUT_FORMAT_SMOOTH32F)
+    imageData[a_index] = floatBitsToUint(a_smooth);
+  else
+  {
+    imageData[a_index * 4 + 0] = floatBitsToUint(a_color.r);
+    imageData[a_index * 4 + 1] = floatBitsToUint(a_color.g);
+    imageData[a_index * 4 + 2] = floatBitsToUint(a_color.b);
+    imageData[a_index * 4 + 3] = floatBitsToUint(a_color.a);
+  }
+}
+
+// kernels that do not compute a fractional count store the whole one
+void storePixel(uint a_index, vec4 a_color, uint a_iterations)
+{
+  storePixel(a_index, a_color, a_iterations, float(a_iterations));
+}
+
+#endif //VK_ASYNC_COMPUTE_SHADER_OUTPUT_H
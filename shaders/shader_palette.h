@@ -0,0 +1,42 @@
+#ifndef VK_ASYNC_COMPUTE_SHADER_PALETTE_H
+#define VK_ASYNC_COMPUTE_SHADER_PALETTE_H
+
+// Palette lookup of the passes that color iteration counts (shader_colorize.comp, shader_supersample.comp);
+// PaletteUniforms in src/palette.h.
+
+// colors spread evenly over [0, MANDELBROT_ITERATIONS], linearly interpolated
+layout(std140, binding = 2) uniform paletteParams
+{
+  vec4 colors[PALETTE_SIZE];
+  uint entries;
+  uint equalize;                   // non zero: escaping counts go through cdf before the palette lookup
+  vec4 cdf[HISTOGRAM_BINS / 4 + 1]; // HISTOGRAM_BINS + 1 floats, share of escaping pixels below every bin
+} palette;
+
+float cdfAt(uint a_bin)
+{
+  return palette.cdf[a_bin >> 2][a_bin & 3u];
+}
+
+// histogram equalization: a count moves to its share of the escaping pixels, so the palette is spread over the
+// pixels of the image rather than over the iteration range
+float equalized(float a_t)
+{
+  const float pos = a_t * float(HISTOGRAM_BINS);
+  const uint  bin = min(uint(pos), HISTOGRAM_BINS - 1);
+  return mix(cdfAt(bin), cdfAt(bin + 1), pos - float(bin));
+}
+
+vec4 paletteColor(float a_count)
+{
+  float t = clamp(a_count / float(MANDELBROT_ITERATIONS), 0.0, 1.0);
+  if(palette.equalize != 0 && a_count < float(MANDELBROT_ITERATIONS))
+    t = equalized(t);
+
+  const float pos = t * float(palette.entries - 1);
+  const uint  i0  = min(uint(pos), palette.entries - 1);
+  const uint  i1  = min(i0 + 1, palette.entries - 1);
+  return mix(palette.colors[i0], palette.colors[i1], pos - float(i0));
+}
+
+#endif //VK_ASYNC_COMPUTE_SHADER_PALETTE_H
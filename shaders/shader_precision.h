@@ -0,0 +1,59 @@
+#ifndef VK_ASYNC_COMPUTE_SHADER_PRECISION_H
+#define VK_ASYNC_COMPUTE_SHADER_PRECISION_H
+
+// The view of the deep-zoom kernels (--precision), filled by FillPrecisionBuffer in src/precision.cpp; the layout
+// must match PrecisionHeader in src/precision.h. Only shader_fp64.comp declares the doubles, the other kernels see
+// the same bytes as words, so they do not need the Float64 capability.
+layout(std430, binding = 3) readonly buffer precisionBuf
+{
+#ifdef PRECISION_FP64
+  dvec2 center;
+  dvec2 pixelStep; // size of a pixel
+#else
+  uvec4 centerBits;
+  uvec4 pixelStepBits;
+#endif
+  vec2  centerHi; // float-float: value = hi + lo
+  vec2  centerLo;
+  vec2  stepHi;
+  vec2  stepLo;
+  uint  orbitLength;
+  uint  pad0, pad1, pad2;
+  vec2  orbit[];  // perturbation: reference orbit Z_0 = 0, Z_1 = center, ... in floats
+} view;
+
+layout( push_constant ) uniform kernelIntArgs
+{
+  uint offsetX;
+  uint offsetY;
+  uint baseY;   // first image row held by the bound buffer, non zero when rendering in bands
+} pcData;
+
+// offset of the invocation's pixel from the center of the image in pixels, exact in float for any image size;
+// false past the tile or the image
+bool pixelOffset(out uvec2 a_pixel, out vec2 a_offset)
+{
+  a_pixel = gl_GlobalInvocationID.xy + uvec2(pcData.offsetX, pcData.offsetY);
+  if(gl_GlobalInvocationID.x >= TILE_X || gl_GlobalInvocationID.y >= TILE_Y || a_pixel.x >= WIDTH || a_pixel.y >= HEIGHT)
+    return false;
+
+  a_offset = vec2(a_pixel) - 0.5 * vec2(WIDTH, HEIGHT);
+  return true;
+}
+
+// colors and stores the pixel like shader.comp; a_z is the first point past the bailout, or the last one inside
+void storeEscape(uvec2 a_pixel, float a_n, vec2 a_z)
+{
+  float t = a_n / float(MANDELBROT_ITERATIONS);
+  vec3 d = vec3(0.3, 0.3 ,0.5);
+  vec3 e = vec3(-0.2, -0.3 ,-0.5);
+  vec3 f = vec3(2.1, 2.0, 3.0);
+  vec3 g = vec3(0.0, 0.1, 0.0);
+  vec4 color = max(vec4(d + e * cos(6.28318 * (f * t + g) ), 1.0), 0.0);
+
+  float smoothN = smoothCount(a_n, a_z);
+
+  storePixel(WIDTH * (a_pixel.y - pcData.baseY) + a_pixel.x, color, uint(a_n), smoothN);
+}
+
+#endif //VK_ASYNC_COMPUTE_SHADER_PRECISION_H
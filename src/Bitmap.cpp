@@ -1,50 +1,77 @@
-#include <vector>
-#include <fstream>
 #include <cstring>
 
-struct Pixel { unsigned char r, g, b; };
+#include "Bitmap.h"
+#include "mapped_file.h"
 
-void WriteBMP(const char* fname, Pixel* a_pixelData, int width, int height)
+// SaveBMP converts straight into the mapped file, there is no image sized buffer on the way
+void SaveBMP(const char* fname, const unsigned int* pixels, int w, int h)
+{
+  MappedFile file(fname, BMPFileSize(w, h));
+  WriteBMPHeader(file.Data(), w, h);
+
+  const size_t stride = BMPRowStride(w);
+  for(int y = 0; y < h; ++y)
+  {
+    unsigned char* row = file.Data() + BMP_HEADER_SIZE + stride * y;
+    for(int x = 0; x < w; ++x)
+    {
+      const unsigned int px = pixels[size_t(y) * w + x];
+      row[x * 3 + 0] = (unsigned char)((px & 0x00FF0000) >> 16);
+      row[x * 3 + 1] = (unsigned char)((px & 0x0000FF00) >> 8);
+      row[x * 3 + 2] = (unsigned char)((px & 0x000000FF));
+    }
+  }
+}
+
+size_t BMPRowStride(int w)
+{
+  return (size_t(w) * 3 + 3) & ~size_t(3);
+}
+
+size_t BMPFileSize(int w, int h)
 {
-  int paddedsize = (width*height) * sizeof(Pixel);
+  return BMP_HEADER_SIZE + BMPRowStride(w) * size_t(h);
+}
 
+static void PutLE32(unsigned char* a_dst, size_t a_value)
+{
+  a_dst[0] = (unsigned char)(a_value      );
+  a_dst[1] = (unsigned char)(a_value >>  8);
+  a_dst[2] = (unsigned char)(a_value >> 16);
+  a_dst[3] = (unsigned char)(a_value >> 24);
+}
+
+void WriteBMPHeader(unsigned char* a_dst, int w, int h)
+{
   unsigned char bmpfileheader[14] = {'B','M', 0,0,0,0, 0,0, 0,0, 54,0,0,0};
   unsigned char bmpinfoheader[40] = {40,0,0,0, 0,0,0,0, 0,0,0,0, 1,0, 24,0};
 
-  bmpfileheader[ 2] = (unsigned char)(paddedsize    );
-  bmpfileheader[ 3] = (unsigned char)(paddedsize>> 8);
-  bmpfileheader[ 4] = (unsigned char)(paddedsize>>16);
-  bmpfileheader[ 5] = (unsigned char)(paddedsize>>24);
-
-  bmpinfoheader[ 4] = (unsigned char)(width    );
-  bmpinfoheader[ 5] = (unsigned char)(width>> 8);
-  bmpinfoheader[ 6] = (unsigned char)(width>>16);
-  bmpinfoheader[ 7] = (unsigned char)(width>>24);
-  bmpinfoheader[ 8] = (unsigned char)(height    );
-  bmpinfoheader[ 9] = (unsigned char)(height>> 8);
-  bmpinfoheader[10] = (unsigned char)(height>>16);
-  bmpinfoheader[11] = (unsigned char)(height>>24);
-
-  std::ofstream out(fname, std::ios::out | std::ios::binary);
-  out.write((const char*)bmpfileheader, 14);
-  out.write((const char*)bmpinfoheader, 40);
-  out.write((const char*)a_pixelData, paddedsize);
-  out.flush();
-  out.close();
+  PutLE32(bmpfileheader + 2, BMPFileSize(w, h));
+  PutLE32(bmpinfoheader + 4, size_t(w));
+  PutLE32(bmpinfoheader + 8, size_t(h));
+  PutLE32(bmpinfoheader + 20, BMPRowStride(w) * size_t(h));
+
+  memcpy(a_dst,      bmpfileheader, 14);
+  memcpy(a_dst + 14, bmpinfoheader, 40);
 }
 
-void SaveBMP(const char* fname, const unsigned int* pixels, int w, int h)
+size_t BMP32FileSize(int w, int h)
 {
-  std::vector<Pixel> pixels2(w*h);
+  return BMP32_HEADER_SIZE + size_t(w) * size_t(h) * 4;
+}
 
-  for (size_t i = 0; i < pixels2.size(); i++)
-  {
-    Pixel px;
-    px.r       = (pixels[i] & 0x00FF0000) >> 16;
-    px.g       = (pixels[i] & 0x0000FF00) >> 8;
-    px.b       = (pixels[i] & 0x000000FF);
-    pixels2[i] = px;
-  }
+void WriteBMP32Header(unsigned char* a_dst, int w, int h)
+{
+  unsigned char bmpfileheader[14] = {'B','M', 0,0,0,0, 0,0, 0,0, (unsigned char)BMP32_HEADER_SIZE,0,0,0};
+  unsigned char bmpinfoheader[40] = {40,0,0,0, 0,0,0,0, 0,0,0,0, 1,0, 32,0, 3,0,0,0}; // BI_BITFIELDS
+  unsigned char masks[12]         = {0xFF,0,0,0, 0,0xFF,0,0, 0,0,0xFF,0};               // R, G, B: bytes 0, 1, 2
 
-  WriteBMP(fname, &pixels2[0], w, h);
-}
\ No newline at end of file
+  PutLE32(bmpfileheader + 2, BMP32FileSize(w, h));
+  PutLE32(bmpinfoheader + 4, size_t(w));
+  PutLE32(bmpinfoheader + 8, size_t(h));
+  PutLE32(bmpinfoheader + 20, size_t(w) * size_t(h) * 4);
+
+  memcpy(a_dst,      bmpfileheader, 14);
+  memcpy(a_dst + 14, bmpinfoheader, 40);
+  memcpy(a_dst + 54, masks,         12);
+}
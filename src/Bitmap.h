@@ -5,6 +5,23 @@
 #ifndef BITMAP_GUARDIAN_H
 #define BITMAP_GUARDIAN_H
 
+#include <cstddef>
+
 void SaveBMP(const char* fname, const unsigned int* pixels, int w, int h);
 
+// Layout of an uncompressed 24-bit BMP, so pixels can be written straight into the file image:
+// a BMP_HEADER_SIZE header followed by h rows of w BGR triplets, each row padded to 4 bytes.
+constexpr size_t BMP_HEADER_SIZE = 54;
+
+size_t BMPRowStride(int w);
+size_t BMPFileSize(int w, int h);
+void   WriteBMPHeader(unsigned char* a_dst, int w, int h);
+
+// A 32-bit BMP whose pixels are R, G, B, A bytes in memory order (BI_BITFIELDS masks), i.e. exactly the
+// packUnorm4x8 words of an rgba8 fractal buffer, so the GPU can copy that buffer into the file as it is.
+constexpr size_t BMP32_HEADER_SIZE = 66;
+
+size_t BMP32FileSize(int w, int h);
+void   WriteBMP32Header(unsigned char* a_dst, int w, int h);
+
 #endif //VULKAN_MINIMAL_COMPUTE_BITMAP_H
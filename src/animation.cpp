@@ -0,0 +1,319 @@
+#include "animation.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "Bitmap.h"
+#include "mapped_file.h"
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float msBetween(Clock::time_point a_start, Clock::time_point a_end)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(a_end - a_start).count() / 1000.f;
+}
+
+std::vector<CameraFrame> MakeZoomPath(const RenderParams& a_start, float a_targetX, float a_targetY, uint32_t a_frames,
+                                      float a_zoomPerFrame, uint32_t a_iterations, uint32_t a_iterationsPerOctave)
+{
+  assert(a_zoomPerFrame > 0.0f);
+
+  std::vector<CameraFrame> path(a_frames);
+  for(uint32_t i = 0; i < a_frames; ++i)
+  {
+    // the offset of the center from the target shrinks with the scale, so the target keeps its screen position
+    const double zoom    = std::pow(double(a_zoomPerFrame), double(i));
+    const double octaves = std::max(std::log2(zoom), 0.0);
+
+    CameraFrame& frame = path[i];
+    frame.params         = a_start;
+    frame.params.scale   = float(a_start.scale / zoom);
+    frame.params.centerX = float(a_targetX + (a_start.centerX - a_targetX) / zoom);
+    frame.params.centerY = float(a_targetY + (a_start.centerY - a_targetY) / zoom);
+
+    const uint32_t iterations = a_iterations + uint32_t(octaves * a_iterationsPerOctave);
+    frame.iterations = (iterations + ANIMATION_ITERATION_STEP - 1) / ANIMATION_ITERATION_STEP * ANIMATION_ITERATION_STEP;
+  }
+  return path;
+}
+
+float AnimationStats::Fps() const
+{
+  return totalMs > 0.0f ? frames * 1000.0f / totalMs : 0.0f;
+}
+
+float AnimationStats::LatencyPercentile(float a_percent) const
+{
+  if(latencyMs.empty())
+    return 0.0f;
+
+  // nearest rank
+  std::vector<float> sorted = latencyMs;
+  std::sort(sorted.begin(), sorted.end());
+  const size_t rank = size_t(std::ceil(a_percent / 100.0f * sorted.size()));
+  return sorted[std::min(std::max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+AnimationRenderer::AnimationRenderer(VkDevice a_device, VkPipelineLayout a_layout, const KernelParams& a_kernel,
+                                     vk_utils::FencePool* a_pFences) :
+                                     device(a_device), pipelineLayout(a_layout), kernel(a_kernel), pFences(a_pFences)
+{
+}
+
+AnimationRenderer::~AnimationRenderer()
+{
+  for(auto& slot : slots)
+  {
+    if(slot.fence != VK_NULL_HANDLE)
+    {
+      vkWaitForFences(device, 1, &slot.fence, VK_TRUE, FENCE_TIMEOUT);
+      pFences->Release(slot.fence);
+    }
+
+    for(size_t q = 0; q < queues.size(); ++q)
+    {
+      vkFreeCommandBuffers(device, queues[q].pool, 1, &slot.cmds[q]);
+      vkFreeCommandBuffers(device, queues[q].pool, 1, &slot.copyCmds[q]);
+    }
+  }
+}
+
+void AnimationRenderer::AddQueue(VkQueue a_queue, VkCommandPool a_pool)
+{
+  assert(slots.empty());
+  queues.push_back({a_queue, a_pool});
+}
+
+void AnimationRenderer::AddSlot(const AnimationSlot& a_slot)
+{
+  assert(!queues.empty());
+
+  Slot slot;
+  slot.res = a_slot;
+  slot.cmds.resize(queues.size());
+  slot.copyCmds.resize(queues.size());
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+
+  for(size_t q = 0; q < queues.size(); ++q)
+  {
+    commandBufferAllocateInfo.commandPool = queues[q].pool;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &slot.cmds[q]));
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &slot.copyCmds[q]));
+  }
+
+  slots.push_back(slot);
+}
+
+// The pipeline changes with the iteration limit of the frame, so the slot's command buffers are re-recorded at every
+// use, like the bands of BandStreamer. The slot is idle here: its previous frame has been encoded.
+void AnimationRenderer::submitFrame(Slot& a_slot, uint32_t a_frame, const CameraFrame& a_camera, VkPipeline a_pipeline,
+                                    const std::vector<TileRect>& a_tiles)
+{
+  const size_t q = a_frame % queues.size();
+
+  memcpy(a_slot.res.paramsMapped, &a_camera.params, sizeof(RenderParams));
+
+  RenderPlan::recordTilesTo(a_slot.cmds[q], a_pipeline, pipelineLayout, a_slot.res.descriptorSet, kernel.workgroupSize,
+                            a_tiles.data(), a_tiles.size());
+
+  VkCommandBuffer copyCmd = a_slot.copyCmds[q];
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(copyCmd, &beginInfo));
+
+  // both command buffers are in one submission, so this barrier orders the copy after the dispatches
+  VkBufferMemoryBarrier toTransfer = {};
+  toTransfer.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  toTransfer.srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT;
+  toTransfer.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+  toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.buffer              = a_slot.res.buffer;
+  toTransfer.offset              = 0;
+  toTransfer.size                = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                       0, nullptr, 1, &toTransfer, 0, nullptr);
+
+  VkBufferCopy region = {};
+  region.size = kernel.ImageBytes();
+  vkCmdCopyBuffer(copyCmd, a_slot.res.buffer, a_slot.res.staging, 1, &region);
+
+  VkBufferMemoryBarrier toHost = {};
+  toHost.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  toHost.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toHost.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+  toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.buffer              = a_slot.res.staging;
+  toHost.offset              = 0;
+  toHost.size                = region.size;
+  vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                       0, nullptr, 1, &toHost, 0, nullptr);
+  VK_CHECK_RESULT(vkEndCommandBuffer(copyCmd));
+
+  const VkCommandBuffer cmds[2] = {a_slot.cmds[q], copyCmd};
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 2;
+  submitInfo.pCommandBuffers    = cmds;
+
+  a_slot.fence = pFences->Acquire();
+  VK_CHECK_RESULT(vkQueueSubmit(queues[q].queue, 1, &submitInfo, a_slot.fence));
+}
+
+AnimationStats AnimationRenderer::Run(const std::vector<CameraFrame>& a_path, const std::map<uint32_t, VkPipeline>& a_pipelines,
+                                      const std::string& a_filePattern, unsigned a_threads, SimdPath a_simd)
+{
+  assert(!slots.empty());
+
+  const size_t fileSize = BMPFileSize(int(kernel.width), int(kernel.height));
+  if(fileSize > size_t(0xFFFFFFFFu))
+    RUN_TIME_ERROR("AnimationRenderer: the image does not fit into a BMP file (4 GiB)");
+
+  std::vector<TileRect> tiles;
+  for(uint32_t i = 0; i < kernel.TilesY(); ++i)
+  {
+    for(uint32_t j = 0; j < kernel.TilesX(); ++j)
+    {
+      tiles.push_back({kernel.tileX * j, kernel.tileY * i, std::min(kernel.tileX, kernel.width  - kernel.tileX * j),
+                       std::min(kernel.tileY, kernel.height - kernel.tileY * i), i * kernel.TilesX() + j});
+    }
+  }
+
+  const uint32_t framesNum = uint32_t(a_path.size());
+  const size_t   slotsNum  = slots.size();
+
+  AnimationStats stats;
+  stats.frames = framesNum;
+  stats.latencyMs.resize(framesNum);
+
+  std::vector<Clock::time_point> submitTimes(framesNum);
+
+  // frames are submitted and encoded in order and frame f always takes slot f % slotsNum, so two counters are the
+  // whole protocol: the submitter may reuse a slot once encoded passes its previous frame
+  std::mutex              mutex;
+  std::condition_variable changed;
+  uint32_t                submitted = 0;
+  uint32_t                encoded   = 0;
+  bool                    abort     = false;
+  std::exception_ptr      encodeError;
+
+  const auto start = Clock::now();
+
+  std::thread encoder([&]()
+  {
+    try
+    {
+      for(uint32_t frame = 0; frame < framesNum; ++frame)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [&]() { return submitted > frame || abort; });
+          if(submitted <= frame)
+            return;
+        }
+
+        Slot& slot = slots[frame % slotsNum];
+
+        const auto waitStart = Clock::now();
+        VK_CHECK_RESULT(vkWaitForFences(device, 1, &slot.fence, VK_TRUE, FENCE_TIMEOUT));
+        pFences->Release(slot.fence);
+        slot.fence = VK_NULL_HANDLE;
+        const auto waitEnd = Clock::now();
+
+        // the palette of the counting formats follows the iteration limit of the frame
+        KernelParams frameKernel = kernel;
+        frameKernel.iterations = a_path[frame].iterations;
+
+        char fileName[1024];
+        std::snprintf(fileName, sizeof(fileName), a_filePattern.c_str(), frame);
+
+        MappedFile file(fileName, fileSize);
+        WriteBMPHeader(file.Data(), int(kernel.width), int(kernel.height));
+        ConvertToBMPPixels(slot.res.stagingMapped, frameKernel, file.Data() + BMP_HEADER_SIZE, a_threads, a_simd);
+        const auto encodeEnd = Clock::now();
+        file.Close();
+        const auto writeEnd = Clock::now();
+
+        stats.gpuWaitMs += msBetween(waitStart, waitEnd);
+        stats.encodeMs  += msBetween(waitEnd, encodeEnd);
+        stats.writeMs   += msBetween(encodeEnd, writeEnd);
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stats.latencyMs[frame] = msBetween(submitTimes[frame], writeEnd);
+          encoded = frame + 1;
+        }
+        changed.notify_all();
+      }
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      encodeError = std::current_exception();
+      abort       = true;
+    }
+    changed.notify_all();
+  });
+
+  try
+  {
+    for(uint32_t frame = 0; frame < framesNum; ++frame)
+    {
+      auto pipeline = a_pipelines.find(a_path[frame].iterations);
+      if(pipeline == a_pipelines.end())
+        RUN_TIME_ERROR("AnimationRenderer: no pipeline for the iteration limit of a frame");
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return encoded + slotsNum > frame || abort; });
+        if(abort)
+          break;
+      }
+
+      const auto submitTime = Clock::now();
+      submitFrame(slots[frame % slotsNum], frame, a_path[frame], pipeline->second, tiles);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitTimes[frame] = submitTime;
+        submitted = frame + 1;
+      }
+      changed.notify_all();
+    }
+  }
+  catch(...)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      abort = true;
+    }
+    changed.notify_all();
+    encoder.join();
+    throw;
+  }
+
+  encoder.join();
+  if(encodeError)
+    std::rethrow_exception(encodeError);
+
+  stats.totalMs = msBetween(start, Clock::now());
+  return stats;
+}
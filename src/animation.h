@@ -0,0 +1,108 @@
+#ifndef VK_ASYNC_COMPUTE_ANIMATION_H
+#define VK_ASYNC_COMPUTE_ANIMATION_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <string>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+#include "readback.h"
+#include "render_plan.h"
+
+// One frame of a camera path: the view and the iteration limit it is rendered with.
+struct CameraFrame
+{
+  RenderParams params;
+  uint32_t     iterations;
+};
+
+// iteration limits of a path are rounded up to multiples of this, every distinct limit is a pipeline variant
+constexpr uint32_t ANIMATION_ITERATION_STEP = 64;
+
+// a_frames frames zooming by a_zoomPerFrame per frame towards (a_targetX, a_targetY), which stays at the same place
+// on the screen. Deeper views need more iterations to resolve the boundary, so the limit grows by
+// a_iterationsPerOctave for every halving of the scale.
+std::vector<CameraFrame> MakeZoomPath(const RenderParams& a_start, float a_targetX, float a_targetY, uint32_t a_frames,
+                                      float a_zoomPerFrame, uint32_t a_iterations, uint32_t a_iterationsPerOctave);
+
+// Buffers of one frame in flight, owned by the caller. 'buffer' holds one image and is bound at binding 0 of
+// 'descriptorSet', whose binding 1 is the slot's own uniform buffer mapped at 'paramsMapped' (host coherent), so a
+// frame's view can be written while other frames are rendering. 'staging' is host visible, coherent and mapped.
+struct AnimationSlot
+{
+  VkBuffer        buffer;
+  VkDescriptorSet descriptorSet;
+  void*           paramsMapped;
+  VkBuffer        staging;
+  const void*     stagingMapped;
+};
+
+struct AnimationStats
+{
+  uint32_t           frames    = 0;
+  float              totalMs   = 0.0f;
+  float              gpuWaitMs = 0.0f; // encode thread blocked on frame fences
+  float              encodeMs  = 0.0f; // conversion into the mapped files
+  float              writeMs   = 0.0f; // unmapping and closing the files
+  std::vector<float> latencyMs;        // per frame, from its submission until its file is closed
+
+  float Fps() const;
+  // a_percent of the frames were written within the returned latency
+  float LatencyPercentile(float a_percent) const;
+};
+
+// Renders a camera path as a sequence of BMP files with up to SlotsNum() frames in flight. Every frame has its own
+// slot (image buffer, parameters, staging), its tiles are recorded into one command buffer on one queue, queues are
+// taken round robin, and the copy into staging follows in the same submission. A separate thread waits for the
+// frames in order, converts them and writes their files, so the compute of the next frames overlaps the readback
+// and the encoding of the previous ones; the submitting thread only blocks when all slots are waiting to be encoded.
+class AnimationRenderer
+{
+public:
+  AnimationRenderer(VkDevice a_device, VkPipelineLayout a_layout, const KernelParams& a_kernel, vk_utils::FencePool* a_pFences);
+  ~AnimationRenderer();
+
+  AnimationRenderer(const AnimationRenderer&) = delete;
+  AnimationRenderer& operator=(const AnimationRenderer&) = delete;
+
+  // all queues must be added before the first slot
+  void AddQueue(VkQueue a_queue, VkCommandPool a_pool);
+  void AddSlot(const AnimationSlot& a_slot);
+
+  size_t SlotsNum() const { return slots.size(); }
+
+  // a_pipelines maps every iteration limit of a_path to its pipeline variant; a_filePattern is a printf format
+  // of the frame index, e.g. "frame_%05u.bmp"
+  AnimationStats Run(const std::vector<CameraFrame>& a_path, const std::map<uint32_t, VkPipeline>& a_pipelines,
+                     const std::string& a_filePattern, unsigned a_threads, SimdPath a_simd);
+
+private:
+  struct Queue
+  {
+    VkQueue       queue;
+    VkCommandPool pool;
+  };
+
+  struct Slot
+  {
+    AnimationSlot                res;
+    std::vector<VkCommandBuffer> cmds;     // per queue
+    std::vector<VkCommandBuffer> copyCmds; // per queue
+    VkFence                      fence = VK_NULL_HANDLE; // signaled when the frame is in staging, null if the slot is idle
+  };
+
+  void submitFrame(Slot& a_slot, uint32_t a_frame, const CameraFrame& a_camera, VkPipeline a_pipeline,
+                   const std::vector<TileRect>& a_tiles);
+
+  VkDevice         device;
+  VkPipelineLayout pipelineLayout;
+  KernelParams     kernel;
+
+  vk_utils::FencePool* pFences;
+  std::vector<Queue>   queues;
+  std::vector<Slot>    slots;
+};
+
+#endif //VK_ASYNC_COMPUTE_ANIMATION_H
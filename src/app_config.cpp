@@ -0,0 +1,474 @@
+#include "app_config.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+
+// strtoul alone takes "-1" as ULONG_MAX and clamps overflow, so only plain digits in the uint32_t range pass
+static uint32_t ParseUInt(const char* a_name, const char* a_value)
+{
+  char* end = nullptr;
+  errno = 0;
+  unsigned long val = std::strtoul(a_value, &end, 10);
+  if(a_value[0] < '0' || a_value[0] > '9' || *end != '\0' || errno == ERANGE || val > UINT32_MAX)
+    throw std::runtime_error(std::string("bad value for ") + a_name + ": " + a_value);
+  return uint32_t(val);
+}
+
+static float ParseFloat(const char* a_name, const char* a_value)
+{
+  char* end = nullptr;
+  float val = std::strtof(a_value, &end);
+  if(end == a_value || *end != '\0')
+    throw std::runtime_error(std::string("bad value for ") + a_name + ": " + a_value);
+  return val;
+}
+
+// "<x>,<y>,<scale>" in doubles, so deep zooms can be given to the precision modes
+static DeepView ParseView(const char* a_name, const char* a_value)
+{
+  DeepView view = {};
+  double* fields[3] = {&view.centerX, &view.centerY, &view.scale};
+  const char* pos = a_value;
+  for(int i = 0; i < 3; ++i)
+  {
+    char* end = nullptr;
+    (*fields[i]) = std::strtod(pos, &end);
+    if(end == pos || *end != ((i < 2) ? ',' : '\0'))
+      throw std::runtime_error(std::string("bad value for ") + a_name + ": " + a_value);
+    pos = end + 1;
+  }
+  if(!(view.scale > 0.0))
+    throw std::runtime_error(std::string("bad value for ") + a_name + ": " + a_value);
+  return view;
+}
+
+void PrintUsage(const char* a_appName)
+{
+  std::cout << "usage: " << a_appName << " [options]" << std::endl;
+  std::cout << "  --device <id>          index of the Vulkan physical device (default 0)" << std::endl;
+  std::cout << "  --runs <n>             number of benchmark runs (default 8)" << std::endl;
+  std::cout << "  --tiles-per-cmd <n>    tiles recorded into one command buffer, 0 = all tiles of a queue (default 1)" << std::endl;
+  std::cout << "  --max-queues <n>       limit on compute queues taken from all families, 0 = all (default 0)" << std::endl;
+  std::cout << "  --schedule <s>         static | dynamic | lpt | persistent (default static)" << std::endl;
+  std::cout << "  --batch <n>            tiles per claim in the dynamic schedule (default 4)" << std::endl;
+  std::cout << "  --persistent-groups <n> workgroups of the persistent schedule, 0 = enough to fill the device (default 0)" << std::endl;
+  std::cout << "  --persistent-shader <file> kernel of the persistent schedule (default shaders/shader_persistent.spv)" << std::endl;
+  std::cout << "  --shader <file>        compute shader SPIR-V, e.g. shaders/shader_varying_work.spv (default shaders/comp.spv)" << std::endl;
+  std::cout << "  --kernel <k>           reference | optimized; optimized skips the cardioid, the period-2 bulb and periodic" << std::endl;
+  std::cout << "                         orbits, and is benchmarked against the reference first (default reference)" << std::endl;
+  std::cout << "  --optimized-shader <file> kernel of --kernel optimized (default shaders/shader_optimized.spv)" << std::endl;
+  std::cout << "  --width <n>            image width (default " << DEFAULT_WIDTH << ")" << std::endl;
+  std::cout << "  --height <n>           image height (default " << DEFAULT_HEIGHT << ")" << std::endl;
+  std::cout << "  --tile <n>             tile width and height (default " << DEFAULT_TILE_X << ")" << std::endl;
+  std::cout << "  --tile-x <n>           tile width" << std::endl;
+  std::cout << "  --tile-y <n>           tile height" << std::endl;
+  std::cout << "  --workgroup <n>        workgroup is n x n invocations (default " << DEFAULT_WORKGROUP_SIZE << ")" << std::endl;
+  std::cout << "  --iterations <n>       Mandelbrot iteration limit (default " << DEFAULT_MANDELBROT_ITERATIONS << ")" << std::endl;
+  std::cout << "  --view <x>,<y>,<scale> center and width of the frame in the complex plane (default -0.445,0,2.34)" << std::endl;
+  std::cout << "  --precision <p>        float | float-float | double | perturbation | auto; auto benchmarks the modes and" << std::endl;
+  std::cout << "                         renders with the fastest one accurate at the view (default float)" << std::endl;
+  std::cout << "  --float-float-shader <file> kernel of --precision float-float (default shaders/shader_float_float.spv)" << std::endl;
+  std::cout << "  --fp64-shader <file>   kernel of --precision double (default shaders/shader_fp64.spv)" << std::endl;
+  std::cout << "  --perturbation-shader <file> kernel of --precision perturbation (default shaders/shader_perturbation.spv)" << std::endl;
+  std::cout << "  --format <f>           fractal buffer format: rgba32f | rgba8 | iter16 | smooth (default rgba32f)" << std::endl;
+  std::cout << "  --colorize             iter16/smooth: color the counts in a separate GPU pass, the image is saved as rgba8" << std::endl;
+  std::cout << "  --palette <p>          palette of --colorize: cosine | gray | fire (default cosine)" << std::endl;
+  std::cout << "  --colorize-shader <file> kernel of --colorize (default shaders/shader_colorize.spv)" << std::endl;
+  std::cout << "  --stats                iter16/smooth: iteration histogram, min/max/mean and in-set pixels reduced on the GPU" << std::endl;
+  std::cout << "  --equalize             --colorize with a histogram-equalized palette, implies --stats" << std::endl;
+  std::cout << "  --histogram-shader <file> kernel of --stats (default shaders/shader_histogram.spv)" << std::endl;
+  std::cout << "  --supersample <n>      anti-alias --colorize with n x n samples per pixel on count edges, implies --colorize" << std::endl;
+  std::cout << "  --edge-threshold <t>   counts of neighbours differing by more than t make an edge pixel (default 0.5)" << std::endl;
+  std::cout << "  --edge-shader <file>   edge detection kernel of --supersample (default shaders/shader_edge_detect.spv)" << std::endl;
+  std::cout << "  --supersample-shader <file> kernel of --supersample (default shaders/shader_supersample.spv)" << std::endl;
+  std::cout << "  --simd <s>             readback conversion: auto | scalar | sse2 | avx2, capped by the CPU (default auto)" << std::endl;
+  std::cout << "  --readback-threads <n> threads converting the readback, 0 = all hardware threads (default 0)" << std::endl;
+  std::cout << "  --pipelined-readback   also read bands back on a transfer queue while later bands compute" << std::endl;
+  std::cout << "  --no-zero-copy         read rgba8 back through staging even if the file pages can be imported" << std::endl;
+  std::cout << "  --stream <rows>        out-of-core: render bands of <rows> rows straight to the file, no image sized buffers" << std::endl;
+  std::cout << "  --ring <n>             band buffers in flight with --stream (default 3)" << std::endl;
+  std::cout << "  --animate <frames>     render a zoom animation as frame_NNNNN.bmp files and report fps and frame latency" << std::endl;
+  std::cout << "  --zoom <factor>        scale divisor per animation frame (default 1.05)" << std::endl;
+  std::cout << "  --in-flight <n>        animation frames in flight (default 3)" << std::endl;
+  std::cout << "  --iterations-per-octave <n> iteration limit added per halving of the animation scale (default 64)" << std::endl;
+  std::cout << "  --backend <b>          gpu | cpu; cpu renders with the SIMD CPU backend and needs no Vulkan device (default gpu)" << std::endl;
+  std::cout << "  --cpu-isa <i>          CPU backend kernel: auto | scalar | neon | avx2 | avx512, capped by the CPU (default auto)" << std::endl;
+  std::cout << "  --cpu-threads <n>      CPU backend threads, 0 = all hardware threads (default 0)" << std::endl;
+  std::cout << "  --validate             check the GPU image against the CPU backend" << std::endl;
+  std::cout << "  --mariani-silver       fill tiles whose border has one iteration count, compared against brute force" << std::endl;
+  std::cout << "  --mariani-shader <file> kernel of --mariani-silver (default shaders/shader_mariani_silver.spv)" << std::endl;
+  std::cout << "  --progressive          also render the frame in passes of stride 8, 4, 2, 1 and time every partial image" << std::endl;
+  std::cout << "  --progressive-shader <file> kernel of --progressive (default shaders/shader_progressive.spv)" << std::endl;
+  std::cout << "  --hybrid               CPU backend pulls tiles next to the GPU queues, implies --schedule dynamic" << std::endl;
+  std::cout << "  --tile-cache <MiB>     render frames through a tile cache with a memory tier of <MiB> (default 256)" << std::endl;
+  std::cout << "  --tile-cache-dir <dir> also keep cached tiles as files in <dir>, across runs of the program" << std::endl;
+  std::cout << "  --pan <pixels>         move the view right by <pixels> every cached frame, up to the configured view (default 0)" << std::endl;
+  std::cout << "  --sweep                benchmark several tile/workgroup sizes and render with the fastest one" << std::endl;
+  std::cout << "  --trace <file.json>    write per-tile GPU timestamps of the last run as a Chrome trace" << std::endl;
+  std::cout << "  --pipeline-cache <file> file the pipeline cache is loaded from and saved to (default pipeline_cache.bin)" << std::endl;
+  std::cout << "  --no-pipeline-cache    do not load or save the pipeline cache" << std::endl;
+  std::cout << "  --help                 print this message" << std::endl;
+}
+
+bool ParseCommandLine(int argc, const char** argv, AppConfig* a_pConfig)
+{
+  for(int i = 1; i < argc; ++i)
+  {
+    const char* arg = argv[i];
+
+    if(std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+    {
+      PrintUsage(argv[0]);
+      return false;
+    }
+
+    if(std::strcmp(arg, "--sweep") == 0)
+    {
+      a_pConfig->sweep = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--pipelined-readback") == 0)
+    {
+      a_pConfig->pipelinedReadback = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--validate") == 0)
+    {
+      a_pConfig->validate = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--mariani-silver") == 0)
+    {
+      a_pConfig->marianiSilver = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--progressive") == 0)
+    {
+      a_pConfig->progressive = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--hybrid") == 0)
+    {
+      a_pConfig->hybrid = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--colorize") == 0)
+    {
+      a_pConfig->colorize = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--stats") == 0)
+    {
+      a_pConfig->stats = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--equalize") == 0)
+    {
+      a_pConfig->equalize = true;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--no-zero-copy") == 0)
+    {
+      a_pConfig->zeroCopy = false;
+      continue;
+    }
+
+    if(std::strcmp(arg, "--no-pipeline-cache") == 0)
+    {
+      a_pConfig->pipelineCachePath.clear();
+      continue;
+    }
+
+    if(i + 1 >= argc)
+      throw std::runtime_error(std::string("missing value for ") + arg);
+    const char* value = argv[++i];
+
+    if(std::strcmp(arg, "--device") == 0)
+      a_pConfig->deviceId = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--runs") == 0)
+      a_pConfig->runs = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--tiles-per-cmd") == 0)
+      a_pConfig->tilesPerCmd = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--max-queues") == 0)
+      a_pConfig->maxQueues = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--schedule") == 0)
+    {
+      if(std::strcmp(value, "static") == 0)
+        a_pConfig->schedule = Schedule::STATIC;
+      else if(std::strcmp(value, "dynamic") == 0)
+        a_pConfig->schedule = Schedule::DYNAMIC;
+      else if(std::strcmp(value, "lpt") == 0)
+        a_pConfig->schedule = Schedule::LPT;
+      else if(std::strcmp(value, "persistent") == 0)
+        a_pConfig->schedule = Schedule::PERSISTENT;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--batch") == 0)
+      a_pConfig->batchSize = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--persistent-groups") == 0)
+      a_pConfig->persistentGroups = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--persistent-shader") == 0)
+      a_pConfig->persistentShaderPath = value;
+    else if(std::strcmp(arg, "--mariani-shader") == 0)
+      a_pConfig->marianiShaderPath = value;
+    else if(std::strcmp(arg, "--progressive-shader") == 0)
+      a_pConfig->progressiveShaderPath = value;
+    else if(std::strcmp(arg, "--float-float-shader") == 0)
+      a_pConfig->floatFloatShaderPath = value;
+    else if(std::strcmp(arg, "--fp64-shader") == 0)
+      a_pConfig->fp64ShaderPath = value;
+    else if(std::strcmp(arg, "--perturbation-shader") == 0)
+      a_pConfig->perturbationShaderPath = value;
+    else if(std::strcmp(arg, "--colorize-shader") == 0)
+      a_pConfig->colorizeShaderPath = value;
+    else if(std::strcmp(arg, "--histogram-shader") == 0)
+      a_pConfig->histogramShaderPath = value;
+    else if(std::strcmp(arg, "--edge-shader") == 0)
+      a_pConfig->edgeShaderPath = value;
+    else if(std::strcmp(arg, "--supersample-shader") == 0)
+      a_pConfig->supersampleShaderPath = value;
+    else if(std::strcmp(arg, "--supersample") == 0)
+      a_pConfig->supersample = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--edge-threshold") == 0)
+      a_pConfig->edgeThreshold = ParseFloat(arg, value);
+    else if(std::strcmp(arg, "--palette") == 0)
+    {
+      if(std::strcmp(value, "cosine") == 0)
+        a_pConfig->palette = PaletteKind::COSINE;
+      else if(std::strcmp(value, "gray") == 0)
+        a_pConfig->palette = PaletteKind::GRAY;
+      else if(std::strcmp(value, "fire") == 0)
+        a_pConfig->palette = PaletteKind::FIRE;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--shader") == 0)
+      a_pConfig->shaderPath = value;
+    else if(std::strcmp(arg, "--optimized-shader") == 0)
+      a_pConfig->optimizedShaderPath = value;
+    else if(std::strcmp(arg, "--kernel") == 0)
+    {
+      if(std::strcmp(value, "reference") == 0)
+        a_pConfig->optimizedKernel = false;
+      else if(std::strcmp(value, "optimized") == 0)
+        a_pConfig->optimizedKernel = true;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--trace") == 0)
+      a_pConfig->tracePath = value;
+    else if(std::strcmp(arg, "--pipeline-cache") == 0)
+      a_pConfig->pipelineCachePath = value;
+    else if(std::strcmp(arg, "--width") == 0)
+      a_pConfig->kernel.width = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--height") == 0)
+      a_pConfig->kernel.height = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--tile") == 0)
+      a_pConfig->kernel.tileX = a_pConfig->kernel.tileY = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--tile-x") == 0)
+      a_pConfig->kernel.tileX = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--tile-y") == 0)
+      a_pConfig->kernel.tileY = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--workgroup") == 0)
+      a_pConfig->kernel.workgroupSize = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--iterations") == 0)
+      a_pConfig->kernel.iterations = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--simd") == 0)
+    {
+      if(std::strcmp(value, "auto") == 0 || std::strcmp(value, "avx2") == 0)
+        a_pConfig->simdLimit = SimdPath::AVX2;
+      else if(std::strcmp(value, "sse2") == 0)
+        a_pConfig->simdLimit = SimdPath::SSE2;
+      else if(std::strcmp(value, "scalar") == 0)
+        a_pConfig->simdLimit = SimdPath::SCALAR;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--backend") == 0)
+    {
+      if(std::strcmp(value, "gpu") == 0)
+        a_pConfig->backend = Backend::GPU;
+      else if(std::strcmp(value, "cpu") == 0)
+        a_pConfig->backend = Backend::CPU;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--cpu-isa") == 0)
+    {
+      if(std::strcmp(value, "auto") == 0 || std::strcmp(value, "avx512") == 0)
+        a_pConfig->cpuIsaLimit = CpuIsa::AVX512;
+      else if(std::strcmp(value, "avx2") == 0)
+        a_pConfig->cpuIsaLimit = CpuIsa::AVX2;
+      else if(std::strcmp(value, "neon") == 0)
+        a_pConfig->cpuIsaLimit = CpuIsa::NEON;
+      else if(std::strcmp(value, "scalar") == 0)
+        a_pConfig->cpuIsaLimit = CpuIsa::SCALAR;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--cpu-threads") == 0)
+      a_pConfig->cpuThreads = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--readback-threads") == 0)
+      a_pConfig->readbackThreads = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--tile-cache") == 0)
+    {
+      a_pConfig->tileCache    = true;
+      a_pConfig->tileCacheMiB = ParseUInt(arg, value);
+    }
+    else if(std::strcmp(arg, "--tile-cache-dir") == 0)
+    {
+      a_pConfig->tileCache    = true;
+      a_pConfig->tileCacheDir = value;
+    }
+    else if(std::strcmp(arg, "--pan") == 0)
+      a_pConfig->panPixels = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--stream") == 0)
+      a_pConfig->streamRows = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--ring") == 0)
+      a_pConfig->ringSize = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--animate") == 0)
+      a_pConfig->animateFrames = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--zoom") == 0)
+      a_pConfig->zoomPerFrame = ParseFloat(arg, value);
+    else if(std::strcmp(arg, "--in-flight") == 0)
+      a_pConfig->inFlight = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--iterations-per-octave") == 0)
+      a_pConfig->iterationsPerOctave = ParseUInt(arg, value);
+    else if(std::strcmp(arg, "--view") == 0)
+      a_pConfig->view = ParseView(arg, value);
+    else if(std::strcmp(arg, "--precision") == 0)
+    {
+      if(std::strcmp(value, "float") == 0)
+        a_pConfig->precision = Precision::FLOAT;
+      else if(std::strcmp(value, "float-float") == 0)
+        a_pConfig->precision = Precision::FLOAT_FLOAT;
+      else if(std::strcmp(value, "double") == 0)
+        a_pConfig->precision = Precision::DOUBLE;
+      else if(std::strcmp(value, "perturbation") == 0)
+        a_pConfig->precision = Precision::PERTURBATION;
+      else if(std::strcmp(value, "auto") == 0)
+        a_pConfig->precision = Precision::AUTO;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else if(std::strcmp(arg, "--format") == 0)
+    {
+      if(std::strcmp(value, "rgba32f") == 0)
+        a_pConfig->kernel.outputFormat = OUTPUT_FORMAT_RGBA32F;
+      else if(std::strcmp(value, "rgba8") == 0)
+        a_pConfig->kernel.outputFormat = OUTPUT_FORMAT_RGBA8;
+      else if(std::strcmp(value, "iter16") == 0)
+        a_pConfig->kernel.outputFormat = OUTPUT_FORMAT_ITER16;
+      else if(std::strcmp(value, "smooth") == 0)
+        a_pConfig->kernel.outputFormat = OUTPUT_FORMAT_SMOOTH32F;
+      else
+        throw std::runtime_error(std::string("bad value for ") + arg + ": " + value);
+    }
+    else
+      throw std::runtime_error(std::string("unknown option ") + arg);
+  }
+
+  if(a_pConfig->marianiSilver && a_pConfig->schedule == Schedule::PERSISTENT)
+    throw std::runtime_error("--mariani-silver dispatches tiles, it does not work with --schedule persistent");
+  if(a_pConfig->hybrid && a_pConfig->schedule == Schedule::PERSISTENT)
+    throw std::runtime_error("--hybrid needs the dynamic schedule, not --schedule persistent");
+  // the CPU backend only implements shader.comp (--kernel optimized gives the same pixels), other kernels would leave
+  // a patchwork of two images
+  if(a_pConfig->hybrid && (a_pConfig->marianiSilver || (!a_pConfig->optimizedKernel && a_pConfig->shaderPath != AppConfig().shaderPath)))
+    throw std::runtime_error("--hybrid renders host tiles with the shader.comp algorithm, it does not work with --shader or --mariani-silver");
+  if(a_pConfig->hybrid)
+    a_pConfig->schedule = Schedule::DYNAMIC;
+
+  if(a_pConfig->supersample != 0)
+  {
+    if(a_pConfig->supersample < 2 || a_pConfig->supersample > 16)
+      throw std::runtime_error("--supersample takes 2 to 16 samples per axis");
+    if(!(a_pConfig->edgeThreshold >= 0.0f))
+      throw std::runtime_error("--edge-threshold must not be negative");
+    // shader_edge_detect.comp sizes its prefix sum for 32 x 32 invocations
+    if(a_pConfig->kernel.workgroupSize > 32)
+      throw std::runtime_error("--supersample takes a workgroup of at most 32");
+    a_pConfig->colorize = true;
+  }
+
+  if(a_pConfig->equalize && !a_pConfig->colorize)
+    throw std::runtime_error("--equalize changes the palette of --colorize, add --colorize");
+  if(a_pConfig->equalize)
+    a_pConfig->stats = true;
+
+  if(a_pConfig->colorize || a_pConfig->stats)
+  {
+    const uint32_t format = a_pConfig->kernel.outputFormat;
+    if(format != OUTPUT_FORMAT_ITER16 && format != OUTPUT_FORMAT_SMOOTH32F)
+      throw std::runtime_error("--colorize and --stats need iteration counts, use --format iter16 or --format smooth");
+    if(a_pConfig->backend == Backend::CPU || a_pConfig->streamRows != 0)
+      throw std::runtime_error("--colorize and --stats run on the GPU over the whole image, they do not work with --backend cpu or --stream");
+  }
+
+  if(a_pConfig->tileCache && (a_pConfig->backend == Backend::CPU || a_pConfig->streamRows != 0))
+    throw std::runtime_error("--tile-cache fills the GPU fractal buffer, it does not work with --backend cpu or --stream");
+  if(a_pConfig->tileCache && a_pConfig->schedule != Schedule::STATIC)
+    throw std::runtime_error("--tile-cache dispatches the missing tiles with the static schedule, drop --schedule and --hybrid");
+
+  if(a_pConfig->progressive && (a_pConfig->backend == Backend::CPU || a_pConfig->streamRows != 0 || a_pConfig->animateFrames != 0))
+    throw std::runtime_error("--progressive renders the whole frame on the GPU, it does not work with --backend cpu, --stream or --animate");
+  if(a_pConfig->progressive && (a_pConfig->marianiSilver || a_pConfig->tileCache))
+    throw std::runtime_error("--progressive is compared with the brute-force frame, drop --mariani-silver and --tile-cache");
+
+  if(a_pConfig->animateFrames != 0)
+  {
+    if(a_pConfig->backend == Backend::CPU || a_pConfig->streamRows != 0 || a_pConfig->tileCache)
+      throw std::runtime_error("--animate renders whole frames on the GPU, it does not work with --backend cpu, --stream or --tile-cache");
+    if(a_pConfig->colorize || a_pConfig->stats || a_pConfig->marianiSilver || a_pConfig->schedule != Schedule::STATIC)
+      throw std::runtime_error("--animate renders every frame with the plain kernel, drop --colorize, --stats, --mariani-silver and --schedule");
+    if(!(a_pConfig->zoomPerFrame > 0.0f))
+      throw std::runtime_error("--zoom must be positive");
+    if(a_pConfig->inFlight == 0)
+      throw std::runtime_error("--in-flight must be positive");
+  }
+
+  // the deep-zoom kernels replace shader.comp in the tile dispatches; the other kernels and the CPU are float only
+  if(a_pConfig->precision != Precision::FLOAT)
+  {
+    if(a_pConfig->backend == Backend::CPU || a_pConfig->hybrid || a_pConfig->streamRows != 0 || a_pConfig->animateFrames != 0)
+      throw std::runtime_error("--precision renders on the GPU, it does not work with --backend cpu, --hybrid, --stream or --animate");
+    if(a_pConfig->schedule == Schedule::PERSISTENT || a_pConfig->marianiSilver || a_pConfig->progressive ||
+       a_pConfig->tileCache || a_pConfig->supersample != 0)
+      throw std::runtime_error("--precision only changes the tile kernel, drop --schedule persistent, --mariani-silver, --progressive, "
+                               "--tile-cache and --supersample");
+  }
+
+  if(a_pConfig->optimizedKernel && (a_pConfig->precision == Precision::FLOAT_FLOAT || a_pConfig->precision == Precision::DOUBLE ||
+                                    a_pConfig->precision == Precision::PERTURBATION))
+    throw std::runtime_error("--kernel optimized is a float kernel, use --precision float or auto");
+  if(a_pConfig->optimizedKernel && (a_pConfig->marianiSilver || a_pConfig->schedule == Schedule::PERSISTENT))
+    throw std::runtime_error("--kernel optimized replaces shader.comp, --mariani-silver and --schedule persistent have their own kernels");
+
+  if(a_pConfig->runs == 0)
+    throw std::runtime_error("--runs must be positive");
+  if(a_pConfig->batchSize == 0)
+    throw std::runtime_error("--batch must be positive");
+  if(a_pConfig->ringSize == 0)
+    throw std::runtime_error("--ring must be positive");
+
+  const KernelParams& kernel = a_pConfig->kernel;
+  if(kernel.width == 0 || kernel.height == 0 || kernel.tileX == 0 || kernel.tileY == 0 || kernel.workgroupSize == 0 || kernel.iterations == 0)
+    throw std::runtime_error("image, tile and workgroup sizes and the iteration limit must be positive");
+
+  return true;
+}
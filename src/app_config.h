@@ -0,0 +1,100 @@
+#ifndef VK_ASYNC_COMPUTE_APP_CONFIG_H
+#define VK_ASYNC_COMPUTE_APP_CONFIG_H
+
+#include <cstdint>
+#include <string>
+
+#include "kernel_params.h"
+#include "readback.h"
+#include "cpu_backend.h"
+#include "palette.h"
+#include "precision.h"
+
+enum class Schedule
+{
+  STATIC,  // tiles are assigned to queues up front
+  DYNAMIC, // queues claim batches of tiles from a shared counter as they finish the previous ones
+  LPT,     // tiles are assigned up front by estimated cost, longest processing time first
+  PERSISTENT, // one dispatch of persistent workgroups that claim tiles from a counter in device memory
+};
+
+enum class Backend
+{
+  GPU, // Vulkan compute queues
+  CPU, // CpuTileBackend only, no Vulkan device is created
+};
+
+// Runtime knobs of the demo, filled from the command line.
+struct AppConfig
+{
+  unsigned deviceId    = 0;
+  uint32_t runs        = 8;
+  uint32_t tilesPerCmd = 1; // tiles recorded into one command buffer; 1 is the per-tile baseline, 0 means all tiles of a queue
+  uint32_t maxQueues   = 0; // compute queues to use across all families, 0 means all of them
+  Schedule schedule    = Schedule::STATIC;
+  uint32_t batchSize   = 4; // tiles claimed at once by a queue in the dynamic schedule
+  uint32_t persistentGroups = 0; // workgroups of the persistent schedule, 0 means enough to fill the device
+
+  KernelParams kernel;      // image size, tile and workgroup sizes, iteration limit
+  bool         sweep = false; // benchmark a range of tile and workgroup sizes and render with the fastest one
+
+  SimdPath simdLimit       = SimdPath::AVX2; // best instruction set the readback conversion may use
+  unsigned readbackThreads = 0;              // threads converting the readback, 0 means all hardware threads
+  bool     pipelinedReadback = false;        // also render with band readback overlapping compute and compare end-to-end time
+  bool     zeroCopy = true;                  // rgba8: let the GPU copy into the imported pages of the mapped file when possible
+
+  Backend  backend     = Backend::GPU;
+  CpuIsa   cpuIsaLimit = CpuIsa::AVX512; // best instruction set the CPU backend may use
+  unsigned cpuThreads  = 0;              // CPU backend threads, 0 means all hardware threads
+  bool     validate    = false;          // compare the GPU image against the CPU backend
+  bool     marianiSilver = false;        // render tiles by border tracing and compare with brute force
+  bool     hybrid      = false;          // CPU backend joins the GPU queues in the dynamic schedule (implies --schedule dynamic)
+
+  bool        colorize = false;               // iter16/smooth: color the counts on the GPU in a second pass and save rgba8
+  PaletteKind palette  = PaletteKind::COSINE; // palette of the colorize pass
+  bool        stats    = false;               // iter16/smooth: histogram and min/max/mean/in-set reduced on the GPU
+  bool        equalize = false;               // --colorize with a histogram-equalized palette (implies --stats)
+  uint32_t    supersample   = 0;              // --colorize anti-aliased with n x n samples per edge pixel, 0 means off
+  float       edgeThreshold = 0.5f;           // neighbour counts differing by more than this make an edge pixel
+
+  bool        tileCache    = false; // render frames through the tile cache (--tile-cache or --tile-cache-dir)
+  uint32_t    tileCacheMiB = 256;   // memory tier of the tile cache
+  std::string tileCacheDir;         // disk tier of the tile cache, empty means memory only
+  uint32_t    panPixels    = 0;     // the view moves this many pixels to the right every cached frame
+
+  bool     progressive = false; // also render the frame coarse to fine and time every pass against the single-pass replay
+
+  uint32_t streamRows = 0; // out-of-core mode: render in bands of this many rows (rounded up to tiles), 0 means off
+  uint32_t ringSize   = 3; // band buffers in flight in the out-of-core mode
+
+  uint32_t animateFrames       = 0;     // zoom animation: frames to render, 0 means off
+  float    zoomPerFrame        = 1.05f; // scale divisor between two frames of the animation
+  uint32_t inFlight            = 3;     // animation frames in flight, each with its own buffers
+  uint32_t iterationsPerOctave = 64;    // iteration limit added per halving of the scale
+
+  DeepView  view      = {-0.445, 0.0, 2.0 + 1.7 * 0.2}; // center and width of the frame; float kernels get it rounded
+  Precision precision = Precision::FLOAT;               // arithmetic of the tile kernel
+  bool      optimizedKernel = false; // tile kernel with the interior shortcuts, compared feature by feature first
+
+  std::string shaderPath = "shaders/comp.spv";
+  std::string persistentShaderPath = "shaders/shader_persistent.spv"; // kernel of the persistent schedule
+  std::string marianiShaderPath = "shaders/shader_mariani_silver.spv";
+  std::string progressiveShaderPath = "shaders/shader_progressive.spv";
+  std::string floatFloatShaderPath = "shaders/shader_float_float.spv"; // --precision float-float
+  std::string fp64ShaderPath = "shaders/shader_fp64.spv";               // --precision double
+  std::string perturbationShaderPath = "shaders/shader_perturbation.spv"; // --precision perturbation
+  std::string optimizedShaderPath = "shaders/shader_optimized.spv";     // --kernel optimized
+  std::string colorizeShaderPath = "shaders/shader_colorize.spv";
+  std::string histogramShaderPath = "shaders/shader_histogram.spv";
+  std::string edgeShaderPath = "shaders/shader_edge_detect.spv";
+  std::string supersampleShaderPath = "shaders/shader_supersample.spv";
+  std::string tracePath;    // Chrome trace of GPU timestamps of the last run, empty means no instrumentation
+  std::string pipelineCachePath = "pipeline_cache.bin"; // empty means the pipeline cache is not persisted
+};
+
+// Returns false if the application should exit (e.g. after --help).
+// Throws std::runtime_error on malformed arguments.
+bool ParseCommandLine(int argc, const char** argv, AppConfig* a_pConfig);
+void PrintUsage(const char* a_appName);
+
+#endif //VK_ASYNC_COMPUTE_APP_CONFIG_H
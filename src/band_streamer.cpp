@@ -0,0 +1,217 @@
+#include "band_streamer.h"
+
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+
+#include "Bitmap.h"
+#include "mapped_file.h"
+#include "render_plan.h"
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float msBetween(Clock::time_point a_start, Clock::time_point a_end)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(a_end - a_start).count() / 1000.f;
+}
+
+BandStreamer::BandStreamer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, const KernelParams& a_kernel,
+                           uint32_t a_bandRows, vk_utils::FencePool* a_pFences) :
+                           device(a_device), pipeline(a_pipeline), pipelineLayout(a_layout), kernel(a_kernel),
+                           bandRows(a_bandRows), pFences(a_pFences)
+{
+  assert(bandRows > 0 && bandRows % kernel.tileY == 0);
+}
+
+BandStreamer::~BandStreamer()
+{
+  for(auto& slot : slots)
+  {
+    if(slot.fence != VK_NULL_HANDLE)
+    {
+      vkWaitForFences(device, 1, &slot.fence, VK_TRUE, FENCE_TIMEOUT);
+      pFences->Release(slot.fence);
+    }
+
+    for(size_t q = 0; q < queues.size(); ++q)
+    {
+      vkFreeCommandBuffers(device, queues[q].pool, 1, &slot.cmds[q]);
+      vkDestroySemaphore(device, slot.computeDone[q], nullptr);
+    }
+    vkFreeCommandBuffers(device, queues[0].pool, 1, &slot.copyCmd);
+  }
+}
+
+size_t BandStreamer::BandBytes(const KernelParams& a_kernel, uint32_t a_bandRows)
+{
+  KernelParams band = a_kernel;
+  band.height = std::min(a_bandRows, a_kernel.height);
+  return band.ImageBytes();
+}
+
+void BandStreamer::AddQueue(VkQueue a_queue, VkCommandPool a_pool)
+{
+  assert(slots.empty());
+  queues.push_back({a_queue, a_pool});
+}
+
+void BandStreamer::AddSlot(const StreamSlot& a_slot)
+{
+  assert(!queues.empty());
+
+  Slot slot;
+  slot.res = a_slot;
+  slot.cmds.resize(queues.size());
+  slot.computeDone.resize(queues.size());
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+  semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  for(size_t q = 0; q < queues.size(); ++q)
+  {
+    commandBufferAllocateInfo.commandPool = queues[q].pool;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &slot.cmds[q]));
+    VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &slot.computeDone[q]));
+  }
+
+  commandBufferAllocateInfo.commandPool = queues[0].pool;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &slot.copyCmd));
+
+  slots.push_back(slot);
+}
+
+// Bands change with every use of a slot, so its command buffers are re-recorded here; that costs a few
+// microseconds per band against milliseconds of compute.
+void BandStreamer::submitBand(Slot& a_slot, uint32_t a_band)
+{
+  const uint32_t nQueues  = uint32_t(queues.size());
+  const uint32_t rowBegin = a_band * bandRows;
+  const uint32_t rowEnd   = std::min(rowBegin + bandRows, kernel.height);
+
+  std::vector<std::vector<TileRect>> queueTiles(nQueues);
+  for(uint32_t i = rowBegin / kernel.tileY; i * kernel.tileY < rowEnd; ++i)
+  {
+    for(uint32_t j = 0; j < kernel.TilesX(); ++j)
+    {
+      const TileRect tile = {kernel.tileX * j, kernel.tileY * i, std::min(kernel.tileX, kernel.width  - kernel.tileX * j),
+                             std::min(kernel.tileY, kernel.height - kernel.tileY * i), i * kernel.TilesX() + j};
+      queueTiles[(i + j) % nQueues].push_back(tile);
+    }
+  }
+
+  std::vector<VkSemaphore> waitFor;
+  for(uint32_t q = 0; q < nQueues; ++q)
+  {
+    if(queueTiles[q].empty())
+      continue;
+
+    RenderPlan::recordTilesTo(a_slot.cmds[q], pipeline, pipelineLayout, a_slot.res.descriptorSet, kernel.workgroupSize,
+                              queueTiles[q].data(), queueTiles[q].size(), nullptr, rowBegin);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &a_slot.cmds[q];
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &a_slot.computeDone[q];
+    VK_CHECK_RESULT(vkQueueSubmit(queues[q].queue, 1, &submitInfo, VK_NULL_HANDLE));
+    waitFor.push_back(a_slot.computeDone[q]);
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(a_slot.copyCmd, &beginInfo));
+
+  VkBufferCopy region = {};
+  region.size = BandBytes(kernel, rowEnd - rowBegin);
+  vkCmdCopyBuffer(a_slot.copyCmd, a_slot.res.buffer, a_slot.res.staging, 1, &region);
+
+  VkBufferMemoryBarrier toHost = {};
+  toHost.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  toHost.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toHost.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+  toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.buffer              = a_slot.res.staging;
+  toHost.offset              = 0;
+  toHost.size                = region.size;
+  vkCmdPipelineBarrier(a_slot.copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                       0, nullptr, 1, &toHost, 0, nullptr);
+  VK_CHECK_RESULT(vkEndCommandBuffer(a_slot.copyCmd));
+
+  const std::vector<VkPipelineStageFlags> waitStages(waitFor.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  VkSubmitInfo copySubmit = {};
+  copySubmit.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  copySubmit.waitSemaphoreCount = uint32_t(waitFor.size());
+  copySubmit.pWaitSemaphores    = waitFor.data();
+  copySubmit.pWaitDstStageMask  = waitStages.data();
+  copySubmit.commandBufferCount = 1;
+  copySubmit.pCommandBuffers    = &a_slot.copyCmd;
+
+  a_slot.band  = a_band;
+  a_slot.fence = pFences->Acquire();
+  VK_CHECK_RESULT(vkQueueSubmit(queues[0].queue, 1, &copySubmit, a_slot.fence));
+}
+
+StreamStats BandStreamer::Run(const char* a_fileName, unsigned a_threads, SimdPath a_simd)
+{
+  assert(!slots.empty());
+
+  const size_t fileSize = BMPFileSize(int(kernel.width), int(kernel.height));
+  if(fileSize > size_t(0xFFFFFFFFu))
+    RUN_TIME_ERROR("BandStreamer: the image does not fit into a BMP file (4 GiB)");
+
+  StreamStats stats;
+  const auto start = Clock::now();
+
+  // the file is mapped at its final size and bands are converted into it in place; only the pages being written
+  // need to be resident, the OS writes them back as it goes
+  MappedFile file(a_fileName, fileSize);
+  WriteBMPHeader(file.Data(), int(kernel.width), int(kernel.height));
+  const size_t dstStride = BMPRowStride(int(kernel.width));
+
+  auto consume = [&](Slot& a_slot)
+  {
+    const auto waitStart = Clock::now();
+    VK_CHECK_RESULT(vkWaitForFences(device, 1, &a_slot.fence, VK_TRUE, FENCE_TIMEOUT));
+    pFences->Release(a_slot.fence);
+    a_slot.fence = VK_NULL_HANDLE;
+    const auto waitEnd = Clock::now();
+
+    KernelParams band = kernel;
+    band.height = std::min(bandRows, kernel.height - a_slot.band * bandRows);
+    unsigned char* dst = file.Data() + BMP_HEADER_SIZE + dstStride * a_slot.band * bandRows;
+    ConvertToBMPPixels(a_slot.res.stagingMapped, band, dst, a_threads, a_simd);
+
+    stats.gpuWaitMs += msBetween(waitStart, waitEnd);
+    stats.convertMs += msBetween(waitEnd, Clock::now());
+  };
+
+  // slots are reused round robin, so the slot to fill next always holds the oldest band
+  const uint32_t bandsNum = BandsNum();
+  for(uint32_t band = 0; band < bandsNum; ++band)
+  {
+    Slot& slot = slots[band % slots.size()];
+    if(slot.fence != VK_NULL_HANDLE)
+      consume(slot);
+    submitBand(slot, band);
+  }
+
+  for(uint32_t band = (bandsNum > slots.size()) ? bandsNum - uint32_t(slots.size()) : 0; band < bandsNum; ++band)
+    consume(slots[band % slots.size()]);
+
+  const auto closeStart = Clock::now();
+  file.Close();
+  stats.writeMs = msBetween(closeStart, Clock::now());
+  stats.totalMs = msBetween(start, Clock::now());
+  return stats;
+}
@@ -0,0 +1,84 @@
+#ifndef VK_ASYNC_COMPUTE_BAND_STREAMER_H
+#define VK_ASYNC_COMPUTE_BAND_STREAMER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+#include "readback.h"
+
+// Buffers of one ring slot, owned by the caller. 'buffer' holds one band (BandStreamer::BandBytes()) and is bound
+// at binding 0 of 'descriptorSet'; 'staging' is host visible, coherent and mapped at 'stagingMapped'.
+struct StreamSlot
+{
+  VkBuffer        buffer;
+  VkDescriptorSet descriptorSet;
+  VkBuffer        staging;
+  const void*     stagingMapped;
+};
+
+struct StreamStats
+{
+  float totalMs   = 0.0f;
+  float gpuWaitMs = 0.0f; // host blocked on band fences
+  float convertMs = 0.0f;
+  float writeMs   = 0.0f; // unmapping and closing the output file
+};
+
+// Out-of-core rendering: the image is rendered in horizontal bands of a_bandRows rows through a ring of slots,
+// so device and host memory stay at (ring size x band size) whatever the image size. A band is split over all
+// queues like the static schedule, its tiles write relative to the band (push constant baseY), the first queue
+// copies it into the slot's staging buffer once the others signal their semaphores, and the host converts it
+// into its place in the memory-mapped output file while the next slots are being computed.
+class BandStreamer
+{
+public:
+  BandStreamer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, const KernelParams& a_kernel,
+               uint32_t a_bandRows, vk_utils::FencePool* a_pFences);
+  ~BandStreamer();
+
+  BandStreamer(const BandStreamer&) = delete;
+  BandStreamer& operator=(const BandStreamer&) = delete;
+
+  // all queues must be added before the first slot; the first queue also records the copies
+  void AddQueue(VkQueue a_queue, VkCommandPool a_pool);
+  void AddSlot(const StreamSlot& a_slot);
+
+  StreamStats Run(const char* a_fileName, unsigned a_threads, SimdPath a_simd);
+
+  uint32_t BandsNum() const { return (kernel.height + bandRows - 1) / bandRows; }
+
+  static size_t BandBytes(const KernelParams& a_kernel, uint32_t a_bandRows);
+
+private:
+  struct Queue
+  {
+    VkQueue       queue;
+    VkCommandPool pool;
+  };
+
+  struct Slot
+  {
+    StreamSlot                   res;
+    std::vector<VkCommandBuffer> cmds;        // per queue
+    std::vector<VkSemaphore>     computeDone; // per queue, waited by the copy
+    VkCommandBuffer              copyCmd;
+    VkFence                      fence = VK_NULL_HANDLE; // signaled when the band is in staging, null if the slot is idle
+    uint32_t                     band  = 0;
+  };
+
+  void submitBand(Slot& a_slot, uint32_t a_band);
+
+  VkDevice         device;
+  VkPipeline       pipeline;
+  VkPipelineLayout pipelineLayout;
+  KernelParams     kernel;
+  uint32_t         bandRows;
+
+  vk_utils::FencePool* pFences;
+  std::vector<Queue>   queues;
+  std::vector<Slot>    slots;
+};
+
+#endif //VK_ASYNC_COMPUTE_BAND_STREAMER_H
@@ -0,0 +1,65 @@
+#include "colorizer.h"
+
+#include <cassert>
+#include <chrono>
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+Colorizer::Colorizer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                     const KernelParams& a_kernel, VkQueue a_queue, VkCommandPool a_pool, vk_utils::FencePool* a_pFences)
+  : device(a_device), queue(a_queue), pool(a_pool), pFences(a_pFences)
+{
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = pool;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &cmd));
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(cmd, &beginInfo));
+
+  // the counts were written by the render (compute, or transfer for tiles of the host backend)
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_layout, 0, 1, &a_ds, 0, nullptr);
+  vkCmdDispatch(cmd, (a_kernel.width  + a_kernel.workgroupSize - 1) / a_kernel.workgroupSize,
+                     (a_kernel.height + a_kernel.workgroupSize - 1) / a_kernel.workgroupSize, 1);
+
+  // colors are read back by a copy
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VK_CHECK_RESULT(vkEndCommandBuffer(cmd));
+}
+
+Colorizer::~Colorizer()
+{
+  vkFreeCommandBuffers(device, pool, 1, &cmd);
+}
+
+float Colorizer::Run()
+{
+  VkFence fence = pFences->Acquire();
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cmd;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+  VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+  const auto end = std::chrono::high_resolution_clock::now();
+  pFences->Release(fence);
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.f;
+}
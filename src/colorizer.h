@@ -0,0 +1,33 @@
+#ifndef VK_ASYNC_COMPUTE_COLORIZER_H
+#define VK_ASYNC_COMPUTE_COLORIZER_H
+
+#include <vulkan/vulkan.h>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+
+// The colorize pass of --colorize: one dispatch of shader_colorize.comp over the image, recorded once. The descriptor
+// set binds the iteration buffer (a_kernel.outputFormat, OUTPUT_FORMAT_ITER16 or OUTPUT_FORMAT_SMOOTH32F), the RGBA8
+// color buffer and the palette uniform buffer. The palette may be rewritten between runs, nothing is re-recorded.
+class Colorizer
+{
+public:
+  Colorizer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+            const KernelParams& a_kernel, VkQueue a_queue, VkCommandPool a_pool, vk_utils::FencePool* a_pFences);
+  ~Colorizer();
+
+  Colorizer(const Colorizer&) = delete;
+  Colorizer& operator=(const Colorizer&) = delete;
+
+  // colors the iteration buffer and waits; returns the time from submit to the fence in ms
+  float Run();
+
+private:
+  VkDevice             device;
+  VkQueue              queue;
+  VkCommandPool        pool;
+  VkCommandBuffer      cmd;
+  vk_utils::FencePool* pFences;
+};
+
+#endif //VK_ASYNC_COMPUTE_COLORIZER_H
@@ -0,0 +1,78 @@
+#include "cost_estimate.h"
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <functional>
+
+std::vector<double> EstimateTileCosts(const KernelParams& a_kernel, const RenderParams& a_params, unsigned a_threads, CpuIsa a_isa)
+{
+  // the low resolution frame covers the same view, so its pixel (x, y) lies at about (x, y) * COST_SAMPLE_STEP
+  KernelParams lowRes = a_kernel;
+  lowRes.width        = (a_kernel.width  + COST_SAMPLE_STEP - 1) / COST_SAMPLE_STEP;
+  lowRes.height       = (a_kernel.height + COST_SAMPLE_STEP - 1) / COST_SAMPLE_STEP;
+  lowRes.tileX        = std::max(a_kernel.tileX / COST_SAMPLE_STEP, 16u);
+  lowRes.tileY        = std::max(a_kernel.tileY / COST_SAMPLE_STEP, 16u);
+  lowRes.iterations   = std::min(a_kernel.iterations, COST_MAX_ITERATIONS);
+  lowRes.outputFormat = OUTPUT_FORMAT_ITER16;
+
+  std::vector<TileRect> lowResTiles;
+  for(uint32_t i = 0; i < lowRes.TilesY(); ++i)
+  {
+    for(uint32_t j = 0; j < lowRes.TilesX(); ++j)
+    {
+      lowResTiles.push_back({lowRes.tileX * j, lowRes.tileY * i, std::min(lowRes.tileX, lowRes.width - lowRes.tileX * j),
+                             std::min(lowRes.tileY, lowRes.height - lowRes.tileY * i), i * lowRes.TilesX() + j});
+    }
+  }
+
+  std::vector<uint16_t> counts(lowRes.ImageBytes() / sizeof(uint16_t));
+  CpuTileBackend backend(lowRes, a_threads, a_isa);
+  backend.RenderTiles(lowResTiles.data(), lowResTiles.size(), a_params, counts.data());
+
+  std::vector<double> costs(size_t(a_kernel.TilesX()) * a_kernel.TilesY(), 0.0);
+  for(uint32_t y = 0; y < lowRes.height; ++y)
+  {
+    const uint32_t tileY = std::min(y * COST_SAMPLE_STEP, a_kernel.height - 1) / a_kernel.tileY;
+    for(uint32_t x = 0; x < lowRes.width; ++x)
+    {
+      const uint32_t tileX = std::min(x * COST_SAMPLE_STEP, a_kernel.width - 1) / a_kernel.tileX;
+      const uint32_t n     = counts[size_t(y) * lowRes.width + x];
+      // + 1 for the work of a pixel besides its iterations
+      costs[size_t(tileY) * a_kernel.TilesX() + tileX] += ((n < lowRes.iterations) ? n : a_kernel.iterations) + 1.0;
+    }
+  }
+  return costs;
+}
+
+std::vector<std::vector<TileRect> > AssignLongestFirst(const std::vector<TileRect>& a_tiles, const std::vector<double>& a_costs,
+                                                       size_t a_binsNum, std::vector<double>* a_pLoads)
+{
+  std::vector<size_t> order(a_tiles.size());
+  std::iota(order.begin(), order.end(), size_t(0));
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return a_costs[a_tiles[a].id] > a_costs[a_tiles[b].id];
+  });
+
+  // (load, bin) with the least loaded bin on top
+  typedef std::pair<double, size_t> BinLoad;
+  std::priority_queue<BinLoad, std::vector<BinLoad>, std::greater<BinLoad> > bins;
+  for(size_t b = 0; b < a_binsNum; ++b)
+    bins.push({0.0, b});
+
+  std::vector<std::vector<TileRect> > res(a_binsNum);
+  std::vector<double> loads(a_binsNum, 0.0);
+  for(size_t i : order)
+  {
+    BinLoad bin = bins.top();
+    bins.pop();
+    res[bin.second].push_back(a_tiles[i]);
+    bin.first += a_costs[a_tiles[i].id];
+    loads[bin.second] = bin.first;
+    bins.push(bin);
+  }
+
+  if(a_pLoads != nullptr)
+    *a_pLoads = loads;
+  return res;
+}
@@ -0,0 +1,25 @@
+#ifndef VK_ASYNC_COMPUTE_COST_ESTIMATE_H
+#define VK_ASYNC_COMPUTE_COST_ESTIMATE_H
+
+#include <vector>
+
+#include "render_plan.h"
+#include "kernel_params.h"
+#include "cpu_backend.h"
+
+// The pre-pass samples one pixel per COST_SAMPLE_STEP x COST_SAMPLE_STEP block and iterates it at most
+// COST_MAX_ITERATIONS times; a sample still bounded at that point is counted at the full iteration limit.
+static constexpr uint32_t COST_SAMPLE_STEP    = 8;
+static constexpr uint32_t COST_MAX_ITERATIONS = 64;
+
+// Estimated cost of every tile of a_kernel (indexed by TileRect::id) in iterations, from a low resolution render
+// of the same view on the CPU backend. Only the content of the frame is modelled: the random skew of
+// shader_varying_work.comp is invisible to it.
+std::vector<double> EstimateTileCosts(const KernelParams& a_kernel, const RenderParams& a_params, unsigned a_threads, CpuIsa a_isa);
+
+// Longest processing time first: tiles are taken in order of decreasing cost and every one goes to the bin with
+// the least cost so far. Each bin comes out ordered longest first; a_pLoads, when given, gets the cost of every bin.
+std::vector<std::vector<TileRect> > AssignLongestFirst(const std::vector<TileRect>& a_tiles, const std::vector<double>& a_costs,
+                                                       size_t a_binsNum, std::vector<double>* a_pLoads = nullptr);
+
+#endif //VK_ASYNC_COMPUTE_COST_ESTIMATE_H
@@ -0,0 +1,466 @@
+#include "cpu_backend.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "readback.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define CPU_BACKEND_X86
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+  // like the readback, wider code is compiled for these functions only and selected at run time
+  #if defined(__GNUC__) || defined(__clang__)
+    #define CPU_AVX2_FUNC   __attribute__((target("avx2")))
+    #define CPU_AVX512_FUNC __attribute__((target("avx512f")))
+  #else
+    #define CPU_AVX2_FUNC
+    #define CPU_AVX512_FUNC
+  #endif
+#endif
+
+// GCC fuses a * b + c into an FMA wherever the target has one (AVX-512 and AArch64 do), which would make the
+// kernels disagree in the last bit and move iteration counts; every kernel is compiled without that
+#if defined(__GNUC__) && !defined(__clang__)
+  #define CPU_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+  #define CPU_NO_FP_CONTRACT
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #define CPU_BACKEND_NEON
+  #include <arm_neon.h>
+#endif
+
+// One row of a tile: pixels [x0, x0 + count) of the row whose imaginary part is cy.
+struct EscapeRow
+{
+  uint32_t x0;
+  uint32_t count;
+  float    cy;
+  float    width;
+  float    centerX;
+  float    scale;
+  uint32_t iterations;
+  float    bailout;
+};
+
+// Writes the iteration count of every pixel of the row to a_counts and |z|^2 of its first point past the bailout to
+// a_norms (undefined where the count reached the limit). Vector versions may write up to one vector past count, the
+// caller leaves room for that.
+typedef void (*EscapeKernel)(const EscapeRow& a_row, uint32_t* a_counts, float* a_norms);
+
+static constexpr uint32_t MAX_LANES = 16;
+
+// the operations are those of shader.comp in the same order; all kernels give the same counts
+CPU_NO_FP_CONTRACT static void EscapeCountsScalar(const EscapeRow& a_row, uint32_t* a_counts, float* a_norms)
+{
+  for(uint32_t i = 0; i < a_row.count; ++i)
+  {
+    const float x  = float(a_row.x0 + i) / a_row.width;
+    const float cx = a_row.centerX + (x - 0.5f) * a_row.scale;
+
+    float    zx = 0.0f, zy = 0.0f, norm = 0.0f;
+    uint32_t n  = 0;
+    for(uint32_t it = 0; it < a_row.iterations; ++it)
+    {
+      const float nx = zx * zx - zy * zy + cx;
+      const float ny = 2.0f * zx * zy + a_row.cy;
+      zx = nx;
+      zy = ny;
+      norm = zx * zx + zy * zy;
+      if(norm > a_row.bailout)
+        break;
+      n++;
+    }
+    a_counts[i] = n;
+    a_norms[i]  = norm;
+  }
+}
+
+#ifdef CPU_BACKEND_X86
+CPU_AVX2_FUNC CPU_NO_FP_CONTRACT static void EscapeCountsAVX2(const EscapeRow& a_row, uint32_t* a_counts, float* a_norms)
+{
+  const __m256  width   = _mm256_set1_ps(a_row.width);
+  const __m256  half    = _mm256_set1_ps(0.5f);
+  const __m256  two     = _mm256_set1_ps(2.0f);
+  const __m256  bailout = _mm256_set1_ps(a_row.bailout);
+  const __m256  scale   = _mm256_set1_ps(a_row.scale);
+  const __m256  centerX = _mm256_set1_ps(a_row.centerX);
+  const __m256  cy      = _mm256_set1_ps(a_row.cy);
+  const __m256i lanes   = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  for(uint32_t i = 0; i < a_row.count; i += 8)
+  {
+    const __m256i px = _mm256_add_epi32(_mm256_set1_epi32(int(a_row.x0 + i)), lanes);
+    const __m256  x  = _mm256_div_ps(_mm256_cvtepi32_ps(px), width);
+    const __m256  cx = _mm256_add_ps(centerX, _mm256_mul_ps(_mm256_sub_ps(x, half), scale));
+
+    __m256  zx     = _mm256_setzero_ps();
+    __m256  zy     = _mm256_setzero_ps();
+    __m256  norms  = _mm256_setzero_ps();
+    __m256  active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256i n      = _mm256_setzero_si256();
+    for(uint32_t it = 0; it < a_row.iterations; ++it)
+    {
+      const __m256 nx = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy)), cx);
+      const __m256 ny = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(two, zx), zy), cy);
+      zx = nx;
+      zy = ny;
+
+      // escaped lanes keep iterating (towards inf/NaN) but no longer count
+      const __m256 norm    = _mm256_add_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+      const __m256 escaped = _mm256_cmp_ps(norm, bailout, _CMP_GT_OQ);
+      norms  = _mm256_blendv_ps(norms, norm, _mm256_and_ps(escaped, active));
+      active = _mm256_andnot_ps(escaped, active);
+      if(_mm256_movemask_ps(active) == 0)
+        break;
+      n = _mm256_sub_epi32(n, _mm256_castps_si256(active)); // active lanes are -1
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(a_counts + i), n);
+    _mm256_storeu_ps(a_norms + i, norms);
+  }
+}
+
+CPU_AVX512_FUNC CPU_NO_FP_CONTRACT static void EscapeCountsAVX512(const EscapeRow& a_row, uint32_t* a_counts, float* a_norms)
+{
+  const __m512  width   = _mm512_set1_ps(a_row.width);
+  const __m512  half    = _mm512_set1_ps(0.5f);
+  const __m512  two     = _mm512_set1_ps(2.0f);
+  const __m512  bailout = _mm512_set1_ps(a_row.bailout);
+  const __m512  scale   = _mm512_set1_ps(a_row.scale);
+  const __m512  centerX = _mm512_set1_ps(a_row.centerX);
+  const __m512  cy      = _mm512_set1_ps(a_row.cy);
+  const __m512i one     = _mm512_set1_epi32(1);
+  const __m512i lanes   = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+  for(uint32_t i = 0; i < a_row.count; i += 16)
+  {
+    const __m512i px = _mm512_add_epi32(_mm512_set1_epi32(int(a_row.x0 + i)), lanes);
+    const __m512  x  = _mm512_div_ps(_mm512_cvtepi32_ps(px), width);
+    const __m512  cx = _mm512_add_ps(centerX, _mm512_mul_ps(_mm512_sub_ps(x, half), scale));
+
+    __m512    zx     = _mm512_setzero_ps();
+    __m512    zy     = _mm512_setzero_ps();
+    __m512    norms  = _mm512_setzero_ps();
+    __mmask16 active = 0xFFFF;
+    __m512i   n      = _mm512_setzero_si512();
+    for(uint32_t it = 0; it < a_row.iterations; ++it)
+    {
+      const __m512 nx = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy)), cx);
+      const __m512 ny = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(two, zx), zy), cy);
+      zx = nx;
+      zy = ny;
+
+      const __m512    norm    = _mm512_add_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+      const __mmask16 escaped = _mm512_cmp_ps_mask(norm, bailout, _CMP_GT_OQ);
+      norms  = _mm512_mask_mov_ps(norms, __mmask16(active & escaped), norm);
+      active = __mmask16(active & ~escaped);
+      if(active == 0)
+        break;
+      n = _mm512_mask_add_epi32(n, active, n, one);
+    }
+    _mm512_storeu_si512(a_counts + i, n);
+    _mm512_storeu_ps(a_norms + i, norms);
+  }
+}
+#endif
+
+#ifdef CPU_BACKEND_NEON
+CPU_NO_FP_CONTRACT static void EscapeCountsNEON(const EscapeRow& a_row, uint32_t* a_counts, float* a_norms)
+{
+  static const uint32_t laneIds[4] = {0, 1, 2, 3};
+
+  const float32x4_t width   = vdupq_n_f32(a_row.width);
+  const float32x4_t half    = vdupq_n_f32(0.5f);
+  const float32x4_t two     = vdupq_n_f32(2.0f);
+  const float32x4_t bailout = vdupq_n_f32(a_row.bailout);
+  const float32x4_t scale   = vdupq_n_f32(a_row.scale);
+  const float32x4_t centerX = vdupq_n_f32(a_row.centerX);
+  const float32x4_t cy      = vdupq_n_f32(a_row.cy);
+  const uint32x4_t  lanes   = vld1q_u32(laneIds);
+
+  for(uint32_t i = 0; i < a_row.count; i += 4)
+  {
+    const uint32x4_t  px = vaddq_u32(vdupq_n_u32(a_row.x0 + i), lanes);
+    const float32x4_t x  = vdivq_f32(vcvtq_f32_u32(px), width);
+    const float32x4_t cx = vaddq_f32(centerX, vmulq_f32(vsubq_f32(x, half), scale));
+
+    float32x4_t zx     = vdupq_n_f32(0.0f);
+    float32x4_t zy     = vdupq_n_f32(0.0f);
+    float32x4_t norms  = vdupq_n_f32(0.0f);
+    uint32x4_t  active = vdupq_n_u32(0xFFFFFFFFu);
+    uint32x4_t  n      = vdupq_n_u32(0);
+    for(uint32_t it = 0; it < a_row.iterations; ++it)
+    {
+      const float32x4_t nx = vaddq_f32(vsubq_f32(vmulq_f32(zx, zx), vmulq_f32(zy, zy)), cx);
+      const float32x4_t ny = vaddq_f32(vmulq_f32(vmulq_f32(two, zx), zy), cy);
+      zx = nx;
+      zy = ny;
+
+      const float32x4_t norm    = vaddq_f32(vmulq_f32(zx, zx), vmulq_f32(zy, zy));
+      const uint32x4_t  escaped = vcgtq_f32(norm, bailout);
+      norms  = vbslq_f32(vandq_u32(escaped, active), norm, norms);
+      active = vbicq_u32(active, escaped);
+      if(vmaxvq_u32(active) == 0)
+        break;
+      n = vsubq_u32(n, active);
+    }
+    vst1q_u32(a_counts + i, n);
+    vst1q_f32(a_norms + i, norms);
+  }
+}
+#endif
+
+static EscapeKernel SelectEscapeKernel(CpuIsa a_isa)
+{
+#ifdef CPU_BACKEND_X86
+  if(a_isa == CpuIsa::AVX512)
+    return &EscapeCountsAVX512;
+  if(a_isa == CpuIsa::AVX2)
+    return &EscapeCountsAVX2;
+#endif
+#ifdef CPU_BACKEND_NEON
+  if(a_isa == CpuIsa::NEON)
+    return &EscapeCountsNEON;
+#endif
+  return &EscapeCountsScalar;
+}
+
+static bool CpuHasAVX512()
+{
+#if defined(CPU_BACKEND_X86) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512f");
+#elif defined(CPU_BACKEND_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  if((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 0xE6) != 0xE6) // the OS must save zmm and mask registers
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 16)) != 0;
+#else
+  return false;
+#endif
+}
+
+CpuIsa DetectCpuIsa(CpuIsa a_limit)
+{
+  CpuIsa best = CpuIsa::SCALAR;
+#ifdef CPU_BACKEND_NEON
+  best = CpuIsa::NEON;
+#endif
+#ifdef CPU_BACKEND_X86
+  if(DetectSimdPath(SimdPath::AVX2) == SimdPath::AVX2)
+    best = CpuIsa::AVX2;
+  if(CpuHasAVX512())
+    best = CpuIsa::AVX512;
+#endif
+  return std::min(best, a_limit);
+}
+
+const char* CpuIsaName(CpuIsa a_isa)
+{
+  switch(a_isa)
+  {
+    case CpuIsa::AVX512: return "avx512";
+    case CpuIsa::AVX2:   return "avx2";
+    case CpuIsa::NEON:   return "neon";
+    default:             return "scalar";
+  }
+}
+
+CpuTileBackend::CpuTileBackend(const KernelParams& a_kernel, unsigned a_threads, CpuIsa a_isa) : kernel(a_kernel), isa(a_isa)
+{
+  // the cosine palette of shader.comp depends on the iteration count only
+  static const float d[3] = { 0.3f,  0.3f,  0.5f};
+  static const float e[3] = {-0.2f, -0.3f, -0.5f};
+  static const float f[3] = { 2.1f,  2.0f,  3.0f};
+  static const float g[3] = { 0.0f,  0.1f,  0.0f};
+
+  paletteRGBA32F.resize(size_t(kernel.iterations + 1) * 4);
+  paletteRGBA8.resize(kernel.iterations + 1);
+  for(uint32_t n = 0; n <= kernel.iterations; ++n)
+  {
+    const float t     = float(n) / float(kernel.iterations);
+    float*      color = paletteRGBA32F.data() + size_t(n) * 4;
+    for(int k = 0; k < 3; ++k)
+      color[k] = std::max(d[k] + e[k] * std::cos(6.28318f * (f[k] * t + g[k])), 0.0f);
+    color[3] = 1.0f;
+
+    uint32_t packed = 0;
+    for(int k = 0; k < 4; ++k)
+      packed |= uint32_t(std::round(std::min(color[k], 1.0f) * 255.0f)) << (8 * k);
+    paletteRGBA8[n] = packed;
+  }
+
+  const unsigned threads = (a_threads != 0) ? a_threads : std::max(1u, std::thread::hardware_concurrency());
+  for(unsigned t = 1; t < threads; ++t)
+    workers.emplace_back(&CpuTileBackend::workerLoop, this);
+}
+
+CpuTileBackend::~CpuTileBackend()
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    quit = true;
+  }
+  wake.notify_all();
+  for(auto& worker : workers)
+    worker.join();
+}
+
+void CpuTileBackend::RenderTiles(const TileRect* a_tiles, size_t a_tilesNum, const RenderParams& a_params, void* a_dst)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    jobTiles    = a_tiles;
+    jobTilesNum = a_tilesNum;
+    jobParams   = a_params;
+    jobDst      = a_dst;
+    nextTile.store(0);
+    busyWorkers = unsigned(workers.size());
+    ++generation;
+  }
+  wake.notify_all();
+
+  // the calling thread is one of the pool
+  renderClaimedTiles();
+
+  std::unique_lock<std::mutex> guard(lock);
+  done.wait(guard, [this]{ return busyWorkers == 0; });
+}
+
+void CpuTileBackend::workerLoop()
+{
+  uint64_t seen = 0;
+  for(;;)
+  {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait(guard, [&]{ return quit || generation != seen; });
+      if(quit)
+        return;
+      seen = generation;
+    }
+
+    renderClaimedTiles();
+
+    std::lock_guard<std::mutex> guard(lock);
+    if(--busyWorkers == 0)
+      done.notify_one();
+  }
+}
+
+void CpuTileBackend::renderClaimedTiles()
+{
+  std::vector<uint32_t> counts(kernel.tileX + MAX_LANES);
+  std::vector<float>    norms(kernel.tileX + MAX_LANES);
+  for(size_t i = nextTile.fetch_add(1); i < jobTilesNum; i = nextTile.fetch_add(1))
+    renderTile(jobTiles[i], counts, norms);
+}
+
+void CpuTileBackend::renderTile(const TileRect& a_tile, std::vector<uint32_t>& a_counts, std::vector<float>& a_norms) const
+{
+  const EscapeKernel escapeCounts = SelectEscapeKernel(isa);
+
+  EscapeRow row;
+  row.x0         = a_tile.offsetX;
+  row.count      = a_tile.sizeX;
+  row.width      = float(kernel.width);
+  row.centerX    = jobParams.centerX;
+  row.scale      = jobParams.scale;
+  row.iterations = kernel.iterations;
+  row.bailout    = (kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F) ? SMOOTH_BAILOUT : DEFAULT_BAILOUT;
+
+  for(uint32_t y = a_tile.offsetY; y < a_tile.offsetY + a_tile.sizeY; ++y)
+  {
+    const float fy = float(y) / float(kernel.height);
+    row.cy = jobParams.centerY + (fy - 0.5f) * jobParams.scale;
+    escapeCounts(row, a_counts.data(), a_norms.data());
+
+    const size_t first = size_t(y) * kernel.width + a_tile.offsetX;
+    switch(kernel.outputFormat)
+    {
+      case OUTPUT_FORMAT_RGBA8:
+        for(uint32_t i = 0; i < row.count; ++i)
+          static_cast<uint32_t*>(jobDst)[first + i] = paletteRGBA8[a_counts[i]];
+        break;
+      case OUTPUT_FORMAT_ITER16:
+        for(uint32_t i = 0; i < row.count; ++i)
+          static_cast<uint16_t*>(jobDst)[first + i] = uint16_t(std::min<uint32_t>(a_counts[i], 0xFFFF));
+        break;
+      case OUTPUT_FORMAT_SMOOTH32F: // smoothCount() of shaders/shaderCommon.h
+      {
+        const float iterations = float(kernel.iterations);
+        const float logBailout = std::log2(row.bailout);
+        for(uint32_t i = 0; i < row.count; ++i)
+        {
+          float smoothN = float(a_counts[i]);
+          if(a_counts[i] < kernel.iterations)
+            smoothN = std::min(std::max(smoothN + 1.0f - std::log2(std::log2(a_norms[i]) / logBailout), 0.0f), iterations);
+          static_cast<float*>(jobDst)[first + i] = smoothN;
+        }
+        break;
+      }
+      default:
+        for(uint32_t i = 0; i < row.count; ++i)
+          std::memcpy(static_cast<float*>(jobDst) + (first + i) * 4, paletteRGBA32F.data() + size_t(a_counts[i]) * 4, 4 * sizeof(float));
+        break;
+    }
+  }
+}
+
+ImageDiff CompareFractalBuffers(const void* a_test, const void* a_reference, const KernelParams& a_kernel)
+{
+  static const float COLOR_TOLERANCE  = 2.0f / 255.0f;
+  // both sides compute smoothCount(); with the large bailout it barely moves where rounding shifts n by one, the FMAs
+  // and log2 of the GPU leave a few thousandths away from the set border
+  static const float SMOOTH_TOLERANCE = 1e-2f;
+
+  ImageDiff diff;
+  diff.pixels = size_t(a_kernel.width) * a_kernel.height;
+
+  for(size_t i = 0; i < diff.pixels; ++i)
+  {
+    float pixelDiff = 0.0f;
+    switch(a_kernel.outputFormat)
+    {
+      case OUTPUT_FORMAT_RGBA8:
+        for(int k = 0; k < 4; ++k)
+        {
+          const int a = static_cast<const unsigned char*>(a_test)[i * 4 + k];
+          const int b = static_cast<const unsigned char*>(a_reference)[i * 4 + k];
+          pixelDiff = std::max(pixelDiff, float(std::abs(a - b)) / 255.0f);
+        }
+        break;
+      case OUTPUT_FORMAT_ITER16:
+        pixelDiff = float(std::abs(int(static_cast<const uint16_t*>(a_test)[i]) - int(static_cast<const uint16_t*>(a_reference)[i])));
+        break;
+      case OUTPUT_FORMAT_SMOOTH32F:
+        pixelDiff = std::fabs(static_cast<const float*>(a_test)[i] - static_cast<const float*>(a_reference)[i]);
+        break;
+      default:
+        for(int k = 0; k < 4; ++k)
+          pixelDiff = std::max(pixelDiff, std::fabs(static_cast<const float*>(a_test)[i * 4 + k] - static_cast<const float*>(a_reference)[i * 4 + k]));
+        break;
+    }
+
+    float tolerance = COLOR_TOLERANCE;
+    if(a_kernel.outputFormat == OUTPUT_FORMAT_ITER16)
+      tolerance = 0.0f;
+    else if(a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F)
+      tolerance = SMOOTH_TOLERANCE;
+    if(pixelDiff > tolerance)
+      diff.mismatched++;
+    diff.maxDiff = std::max(diff.maxDiff, pixelDiff);
+  }
+
+  return diff;
+}
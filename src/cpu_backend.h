@@ -0,0 +1,82 @@
+#ifndef VK_ASYNC_COMPUTE_CPU_BACKEND_H
+#define VK_ASYNC_COMPUTE_CPU_BACKEND_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "tile_backend.h"
+
+// Instruction set of the CPU tile kernel.
+enum class CpuIsa
+{
+  SCALAR,
+  NEON,   // 4 pixels per vector, AArch64 only
+  AVX2,   // 8 pixels
+  AVX512, // 16 pixels
+};
+
+// The best kernel supported by this CPU (and build), never above a_limit.
+CpuIsa      DetectCpuIsa(CpuIsa a_limit = CpuIsa::AVX512);
+const char* CpuIsaName(CpuIsa a_isa);
+
+// The kernel of shaders/shader.comp on the CPU: the escape-time loop runs over a vector of pixels of a tile row
+// (lanes that escaped stop counting and the vector leaves the loop when all have), the cosine palette is a table
+// per iteration count, and tiles are claimed by a pool of threads from a shared counter.
+// Results match the GPU up to float rounding, which moves the iteration count of a few pixels on the set border.
+class CpuTileBackend : public TileBackend
+{
+public:
+  // a_threads == 0 means all hardware threads
+  CpuTileBackend(const KernelParams& a_kernel, unsigned a_threads, CpuIsa a_isa);
+  ~CpuTileBackend() override;
+
+  CpuTileBackend(const CpuTileBackend&) = delete;
+  CpuTileBackend& operator=(const CpuTileBackend&) = delete;
+
+  const char* Name() const override { return "cpu"; }
+  void        RenderTiles(const TileRect* a_tiles, size_t a_tilesNum, const RenderParams& a_params, void* a_dst) override;
+
+  CpuIsa   Isa()        const { return isa; }
+  unsigned ThreadsNum() const { return unsigned(workers.size()) + 1; }
+
+private:
+  void workerLoop();
+  void renderClaimedTiles();
+  void renderTile(const TileRect& a_tile, std::vector<uint32_t>& a_counts, std::vector<float>& a_norms) const;
+
+  KernelParams kernel;
+  CpuIsa       isa;
+
+  std::vector<float>    paletteRGBA32F; // 4 floats per iteration count
+  std::vector<uint32_t> paletteRGBA8;   // packUnorm4x8 per iteration count
+
+  // the job of the current RenderTiles() call, read by the workers after they see a new generation
+  const TileRect*     jobTiles    = nullptr;
+  size_t              jobTilesNum = 0;
+  RenderParams        jobParams   = {};
+  void*               jobDst      = nullptr;
+  std::atomic<size_t> nextTile{0};
+
+  std::vector<std::thread> workers;
+  std::mutex               lock;
+  std::condition_variable  wake;
+  std::condition_variable  done;
+  uint64_t                 generation  = 0;
+  unsigned                 busyWorkers = 0;
+  bool                     quit        = false;
+};
+
+struct ImageDiff
+{
+  size_t pixels     = 0;
+  size_t mismatched = 0;    // pixels whose iteration count (or color, beyond 2/255) differs
+  float  maxDiff    = 0.0f; // largest channel difference in [0, 1], or in iterations for iter16
+};
+
+// Compares two fractal buffers of a_kernel, e.g. a GPU readback against the CpuTileBackend reference.
+ImageDiff CompareFractalBuffers(const void* a_test, const void* a_reference, const KernelParams& a_kernel);
+
+#endif //VK_ASYNC_COMPUTE_CPU_BACKEND_H
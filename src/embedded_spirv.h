@@ -0,0 +1,18 @@
+#ifndef VK_ASYNC_COMPUTE_EMBEDDED_SPIRV_H
+#define VK_ASYNC_COMPUTE_EMBEDDED_SPIRV_H
+
+#include <cstddef>
+
+// SPIR-V modules compiled into the executable when it is built with -DEMBED_SPIRV=ON
+// (the table is generated from shaders/*.spv by cmake/embed_spirv.cmake).
+struct EmbeddedSpirv
+{
+  const char*          name; // file name without directory, e.g. "comp.spv"
+  const unsigned char* code; // 4-byte aligned
+  size_t               size; // in bytes
+};
+
+// Looks the module up by the file name part of a_path; returns nullptr if it was not embedded.
+const EmbeddedSpirv* FindEmbeddedSpirv(const char* a_path);
+
+#endif //VK_ASYNC_COMPUTE_EMBEDDED_SPIRV_H
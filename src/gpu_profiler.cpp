@@ -0,0 +1,283 @@
+#include "gpu_profiler.h"
+
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+
+#include "vk_utils.h"
+#include "render_plan.h"
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+static constexpr int CALIBRATION_ATTEMPTS = 8;
+
+GpuProfiler::GpuProfiler(VkDevice a_device, VkPhysicalDevice a_physicalDevice, uint32_t a_tilesNum) : device(a_device), tilesNum(a_tilesNum)
+{
+  epoch = Clock::now();
+
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(a_physicalDevice, &props);
+  timestampPeriod = props.limits.timestampPeriod;
+
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+  bool anySupported = false;
+  familyValidBits.resize(queueFamilyCount);
+  for(uint32_t i = 0; i < queueFamilyCount; ++i)
+  {
+    familyValidBits[i] = queueFamilies[i].timestampValidBits;
+    anySupported = anySupported || (familyValidBits[i] != 0);
+  }
+
+  if(!anySupported || timestampPeriod <= 0.0f)
+  {
+    std::cout << "GpuProfiler: device does not support timestamps, profiling disabled" << std::endl;
+    return;
+  }
+
+  VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+  queryPoolCreateInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  queryPoolCreateInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+  queryPoolCreateInfo.queryCount = 2 * tilesNum + 1; // the last one is used for calibration
+  VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool));
+}
+
+GpuProfiler::~GpuProfiler()
+{
+  if(queryPool != VK_NULL_HANDLE)
+    vkDestroyQueryPool(device, queryPool, nullptr);
+}
+
+bool GpuProfiler::FamilySupported(uint32_t a_family) const
+{
+  return Enabled() && a_family < familyValidBits.size() && familyValidBits[a_family] != 0;
+}
+
+void GpuProfiler::CmdTileBegin(VkCommandBuffer a_cmdBuff, uint32_t a_tileId) const
+{
+  assert(a_tileId < tilesNum);
+  vkCmdResetQueryPool(a_cmdBuff, queryPool, 2 * a_tileId, 2);
+  vkCmdWriteTimestamp(a_cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 2 * a_tileId);
+}
+
+void GpuProfiler::CmdTileEnd(VkCommandBuffer a_cmdBuff, uint32_t a_tileId) const
+{
+  vkCmdWriteTimestamp(a_cmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 2 * a_tileId + 1);
+}
+
+void GpuProfiler::AddQueue(const std::string& a_name, VkQueue a_queue, uint32_t a_family, VkCommandPool a_pool)
+{
+  QueueInfo info = {};
+  info.name      = a_name;
+  info.family    = a_family;
+  info.supported = FamilySupported(a_family);
+  info.offsetNs  = 0.0;
+
+  if(!info.supported)
+  {
+    if(Enabled())
+      std::cout << "GpuProfiler: " << a_name << " has timestampValidBits = 0, its tiles are not traced" << std::endl;
+    queues.push_back(info);
+    return;
+  }
+
+  const uint32_t validBits = familyValidBits[a_family];
+  info.validMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+
+  const uint32_t calibrationQuery = 2 * tilesNum;
+
+  VkCommandBuffer cmdBuff;
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = a_pool;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &cmdBuff));
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuff, &beginInfo));
+  vkCmdResetQueryPool(cmdBuff, queryPool, calibrationQuery, 1);
+  vkCmdWriteTimestamp(cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, calibrationQuery);
+  VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuff));
+
+  VkFence fence;
+  VkFenceCreateInfo fenceCreateInfo = {};
+  fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
+
+  double bestLatency = -1.0;
+  for(int attempt = 0; attempt < CALIBRATION_ATTEMPTS; ++attempt)
+  {
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuff;
+
+    const auto before = Clock::now();
+    VK_CHECK_RESULT(vkQueueSubmit(a_queue, 1, &submitInfo, fence));
+    VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+    const auto after = Clock::now();
+    VK_CHECK_RESULT(vkResetFences(device, 1, &fence));
+
+    uint64_t ticks = 0;
+    VK_CHECK_RESULT(vkGetQueryPoolResults(device, queryPool, calibrationQuery, 1, sizeof(ticks), &ticks, sizeof(ticks),
+                                          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+    ticks &= info.validMask;
+
+    const double beforeNs = std::chrono::duration<double, std::nano>(before - epoch).count();
+    const double afterNs  = std::chrono::duration<double, std::nano>(after  - epoch).count();
+    const double latency  = afterNs - beforeNs;
+    if(bestLatency < 0.0 || latency < bestLatency)
+    {
+      bestLatency   = latency;
+      info.offsetNs = 0.5 * (beforeNs + afterNs) - double(ticks) * timestampPeriod;
+    }
+  }
+
+  vkDestroyFence(device, fence, nullptr);
+  vkFreeCommandBuffers(device, a_pool, 1, &cmdBuff);
+
+  std::cout << "GpuProfiler: " << a_name << " calibrated, uncertainty +-" << bestLatency / 2000.0 << " us" << std::endl;
+  queues.push_back(info);
+}
+
+void GpuProfiler::Collect(const std::vector<TileRect>& a_tiles, const std::vector<uint32_t>& a_tileQueues,
+                          Clock::time_point a_hostStart, Clock::time_point a_hostEnd)
+{
+  events.clear();
+  if(!Enabled())
+    return;
+
+  const double hostStartNs = std::chrono::duration<double, std::nano>(a_hostStart - epoch).count();
+  hostSpanUs = std::chrono::duration<double, std::micro>(a_hostEnd - a_hostStart).count();
+
+  for(const auto& tile : a_tiles)
+  {
+    const uint32_t q = a_tileQueues[tile.id];
+    if(q >= queues.size() || !queues[q].supported)
+      continue;
+
+    // value + availability for begin and end
+    uint64_t data[4] = {};
+    VkResult res = vkGetQueryPoolResults(device, queryPool, 2 * tile.id, 2, sizeof(data), data, 2 * sizeof(uint64_t),
+                                         VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if((res != VK_SUCCESS && res != VK_NOT_READY) || data[1] == 0 || data[3] == 0)
+      continue;
+
+    const uint64_t beginTicks = data[0] & queues[q].validMask;
+    const uint64_t endTicks   = data[2] & queues[q].validMask;
+
+    TileEvent ev = {};
+    ev.tileId  = tile.id;
+    ev.queue   = q;
+    ev.x       = tile.offsetX;
+    ev.y       = tile.offsetY;
+    ev.beginUs = (double(beginTicks) * timestampPeriod + queues[q].offsetNs - hostStartNs) / 1000.0;
+    ev.endUs   = (double(endTicks)   * timestampPeriod + queues[q].offsetNs - hostStartNs) / 1000.0;
+    events.push_back(ev);
+  }
+
+  std::sort(events.begin(), events.end(), [](const TileEvent& a, const TileEvent& b) { return a.beginUs < b.beginUs; });
+}
+
+void GpuProfiler::PrintSummary() const
+{
+  if(events.empty())
+  {
+    std::cout << "GpuProfiler: no timestamps collected" << std::endl;
+    return;
+  }
+
+  double frameBegin = events.front().beginUs;
+  double frameEnd   = events.front().endUs;
+  double busySum    = 0.0;
+
+  std::cout << "GPU timeline of the last run (host time, us):" << std::endl;
+  for(uint32_t q = 0; q < queues.size(); ++q)
+  {
+    if(!queues[q].supported)
+      continue;
+
+    // union of tile intervals; events are sorted by begin
+    double busy = 0.0, curBegin = 0.0, curEnd = -1.0, first = -1.0, last = 0.0;
+    uint32_t count = 0;
+    for(const auto& ev : events)
+    {
+      if(ev.queue != q)
+        continue;
+      if(count == 0)
+        first = ev.beginUs;
+      last = std::max(last, ev.endUs);
+      count++;
+
+      if(ev.beginUs > curEnd)
+      {
+        if(curEnd > curBegin)
+          busy += curEnd - curBegin;
+        curBegin = ev.beginUs;
+        curEnd   = ev.endUs;
+      }
+      else
+        curEnd = std::max(curEnd, ev.endUs);
+    }
+    if(curEnd > curBegin)
+      busy += curEnd - curBegin;
+
+    if(count == 0)
+      continue;
+
+    frameBegin = std::min(frameBegin, first);
+    frameEnd   = std::max(frameEnd, last);
+    busySum   += busy;
+    std::cout << "  " << queues[q].name << ": " << count << " tiles, first start " << first << ", last end " << last
+              << ", busy " << busy << std::endl;
+  }
+
+  std::vector<double> durations;
+  for(const auto& ev : events)
+    durations.push_back(ev.endUs - ev.beginUs);
+  std::sort(durations.begin(), durations.end());
+
+  const double span = frameEnd - frameBegin;
+  std::cout << "  GPU span " << span << " us, host submit-to-wait " << hostSpanUs << " us" << std::endl;
+  std::cout << "  queue overlap (sum of busy / span) " << (span > 0.0 ? busySum / span : 0.0) << std::endl;
+  std::cout << "  tile duration p50 " << durations[durations.size() / 2] << " us, p99 "
+            << durations[std::min(durations.size() - 1, durations.size() * 99 / 100)] << " us, max " << durations.back() << " us" << std::endl;
+}
+
+bool GpuProfiler::WriteChromeTrace(const char* a_fileName) const
+{
+  FILE* fp = fopen(a_fileName, "w");
+  if(fp == nullptr)
+  {
+    std::cout << "GpuProfiler: can't open " << a_fileName << std::endl;
+    return false;
+  }
+
+  fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  fprintf(fp, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"vk_async_compute\"}},\n");
+  fprintf(fp, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"host\"}},\n");
+  for(uint32_t q = 0; q < queues.size(); ++q)
+  {
+    fprintf(fp, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s%s\"}},\n",
+            q + 1, queues[q].name.c_str(), queues[q].supported ? "" : " (no timestamps)");
+  }
+
+  fprintf(fp, "  {\"name\": \"submit and wait\", \"cat\": \"host\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0, \"ts\": 0.0, \"dur\": %.3f}",
+          hostSpanUs);
+  for(const auto& ev : events)
+  {
+    fprintf(fp, ",\n  {\"name\": \"tile %u\", \"cat\": \"tile\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, "
+                "\"args\": {\"x\": %u, \"y\": %u}}",
+            ev.tileId, ev.queue + 1, ev.beginUs, ev.endUs - ev.beginUs, ev.x, ev.y);
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+
+  std::cout << "GpuProfiler: trace with " << events.size() << " tiles written to " << a_fileName << std::endl;
+  return true;
+}
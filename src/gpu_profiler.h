@@ -0,0 +1,74 @@
+#ifndef VK_ASYNC_COMPUTE_GPU_PROFILER_H
+#define VK_ASYNC_COMPUTE_GPU_PROFILER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <chrono>
+
+struct TileRect;
+
+// Per-tile GPU timestamps (VK_QUERY_TYPE_TIMESTAMP, two queries per tile) converted to host time.
+// Families with timestampValidBits == 0 are simply not instrumented; if no family supports timestamps
+// the profiler stays disabled and every call is a no-op.
+class GpuProfiler
+{
+public:
+  using Clock = std::chrono::high_resolution_clock;
+
+  GpuProfiler(VkDevice a_device, VkPhysicalDevice a_physicalDevice, uint32_t a_tilesNum);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+  bool Enabled() const { return queryPool != VK_NULL_HANDLE; }
+  bool FamilySupported(uint32_t a_family) const;
+
+  // record around the dispatch of a tile; the queries are reset inside the same command buffer,
+  // so a recorded plan can be replayed without any host side reset
+  void CmdTileBegin(VkCommandBuffer a_cmdBuff, uint32_t a_tileId) const;
+  void CmdTileEnd(VkCommandBuffer a_cmdBuff, uint32_t a_tileId) const;
+
+  // Finds the offset between GPU ticks of a queue and the host clock. A command buffer with a single timestamp
+  // is submitted a few times and the GPU value is matched with the middle of the shortest submit-to-signal interval.
+  void AddQueue(const std::string& a_name, VkQueue a_queue, uint32_t a_family, VkCommandPool a_pool);
+
+  // Reads the timestamps written by the last replay. a_tileQueues[i] is the queue (in AddQueue order) that executed tile i.
+  void Collect(const std::vector<TileRect>& a_tiles, const std::vector<uint32_t>& a_tileQueues,
+               Clock::time_point a_hostStart, Clock::time_point a_hostEnd);
+
+  void PrintSummary() const;
+  bool WriteChromeTrace(const char* a_fileName) const;
+
+private:
+  struct QueueInfo
+  {
+    std::string name;
+    uint32_t    family;
+    bool        supported;
+    uint64_t    validMask;
+    double      offsetNs; // host_ns = ticks * period + offset
+  };
+
+  struct TileEvent
+  {
+    uint32_t tileId;
+    uint32_t queue;
+    uint32_t x, y;
+    double   beginUs, endUs; // relative to hostStart
+  };
+
+  VkDevice    device;
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  uint32_t    tilesNum;
+  float       timestampPeriod; // ns per tick
+
+  std::vector<uint32_t>  familyValidBits;
+  std::vector<QueueInfo> queues;
+  std::vector<TileEvent> events;
+  Clock::time_point      epoch;
+  double                 hostSpanUs = 0.0;
+};
+
+#endif //VK_ASYNC_COMPUTE_GPU_PROFILER_H
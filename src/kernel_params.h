@@ -0,0 +1,84 @@
+#ifndef VK_ASYNC_COMPUTE_KERNEL_PARAMS_H
+#define VK_ASYNC_COMPUTE_KERNEL_PARAMS_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <tuple>
+
+#include "../shaders/shaderCommon.h"
+
+// Render parameters that are baked into a pipeline as specialization constants (ids in shaderCommon.h).
+struct KernelParams
+{
+  uint32_t width         = DEFAULT_WIDTH;
+  uint32_t height        = DEFAULT_HEIGHT;
+  uint32_t workgroupSize = DEFAULT_WORKGROUP_SIZE;
+  uint32_t tileX         = DEFAULT_TILE_X;
+  uint32_t tileY         = DEFAULT_TILE_Y;
+  uint32_t iterations    = DEFAULT_MANDELBROT_ITERATIONS;
+  uint32_t outputFormat  = DEFAULT_OUTPUT_FORMAT; // OUTPUT_FORMAT_* from shaderCommon.h
+  uint32_t features      = DEFAULT_KERNEL_FEATURES; // KERNEL_FEATURE_* from shaderCommon.h
+
+  uint32_t TilesX() const { return (width  + tileX - 1) / tileX; }
+  uint32_t TilesY() const { return (height + tileY - 1) / tileY; }
+
+  uint32_t BytesPerPixel() const
+  {
+    switch(outputFormat)
+    {
+      case OUTPUT_FORMAT_RGBA8:     return 4;
+      case OUTPUT_FORMAT_ITER16:    return 2;
+      case OUTPUT_FORMAT_SMOOTH32F: return 4;
+      default:                      return 16;
+    }
+  }
+
+  // size of the fractal buffer; the shader addresses it in words, so it is rounded up to 4 bytes
+  size_t ImageBytes() const { return (size_t(width) * height * BytesPerPixel() + 3) & ~size_t(3); }
+
+  bool operator<(const KernelParams& rhs) const
+  {
+    return std::tie(width, height, workgroupSize, tileX, tileY, iterations, outputFormat, features) <
+           std::tie(rhs.width, rhs.height, rhs.workgroupSize, rhs.tileX, rhs.tileY, rhs.iterations, rhs.outputFormat, rhs.features);
+  }
+};
+
+// VkSpecializationInfo for KernelParams; keep the object alive until the pipeline is created.
+struct KernelSpecialization
+{
+  explicit KernelSpecialization(const KernelParams& a_params)
+  {
+    data[SPEC_ID_WIDTH]                 = a_params.width;
+    data[SPEC_ID_HEIGHT]                = a_params.height;
+    data[SPEC_ID_WORKGROUP_SIZE_X]      = a_params.workgroupSize;
+    data[SPEC_ID_WORKGROUP_SIZE_Y]      = a_params.workgroupSize;
+    data[SPEC_ID_TILE_X]                = a_params.tileX;
+    data[SPEC_ID_TILE_Y]                = a_params.tileY;
+    data[SPEC_ID_MANDELBROT_ITERATIONS] = a_params.iterations;
+    data[SPEC_ID_OUTPUT_FORMAT]         = a_params.outputFormat;
+    data[SPEC_ID_KERNEL_FEATURES]       = a_params.features;
+
+    for(uint32_t i = 0; i < COUNT; ++i)
+    {
+      entries[i].constantID = i;
+      entries[i].offset     = i * sizeof(uint32_t);
+      entries[i].size       = sizeof(uint32_t);
+    }
+
+    info.mapEntryCount = COUNT;
+    info.pMapEntries   = entries;
+    info.dataSize      = sizeof(data);
+    info.pData         = data;
+  }
+
+  KernelSpecialization(const KernelSpecialization&) = delete;
+  KernelSpecialization& operator=(const KernelSpecialization&) = delete;
+
+  static constexpr uint32_t COUNT = SPEC_ID_KERNEL_FEATURES + 1;
+
+  uint32_t                 data[COUNT];
+  VkSpecializationMapEntry entries[COUNT];
+  VkSpecializationInfo     info;
+};
+
+#endif //VK_ASYNC_COMPUTE_KERNEL_PARAMS_H
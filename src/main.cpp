@@ -2,36 +2,89 @@
 
 #include <vector>
 #include <cstring>
+#include <cstdio>
 #include <cassert>
 #include <stdexcept>
 #include <cmath>
 #include <thread>
 #include <iostream>
 #include <chrono>
+#include <memory>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <cstdint>
 
 // #define MULTITHREADED_SUBMIT
 
+#ifdef MULTITHREADED_SUBMIT
+constexpr bool multithreadedSubmit = true;
+#else
+constexpr bool multithreadedSubmit = false;
+#endif
+
 #ifdef NDEBUG
 constexpr bool enableValidationLayers = false;
 #else
 constexpr bool enableValidationLayers = true;
 #endif
 
-#include "../shaders/shaderCommon.h"
 #include "vk_utils.h"
 #include "Bitmap.h" // Save bmp file
+#include "render_plan.h"
+#include "app_config.h"
+#include "gpu_profiler.h"
+#include "kernel_params.h"
+#include "shader_interface.h"
+#include "pipeline_cache.h"
+#include "readback.h"
+#include "pipelined_readback.h"
+#include "band_streamer.h"
+#include "mapped_file.h"
+#include "cpu_backend.h"
+#include "cost_estimate.h"
+#include "palette.h"
+#include "colorizer.h"
+#include "render_stats.h"
+#include "tile_cache.h"
+#include "animation.h"
+#include "progressive.h"
+#include "supersampler.h"
+#include "precision.h"
+
+#ifdef EMBED_SPIRV
+#include "embedded_spirv.h"
+#endif
 
 
 class ComputeApplication
 {
 private:
-  struct Pixel
-  {
-      float r, g, b, a;
-  };
-
   static constexpr unsigned SUBMIT_ITERS = 1;
-  static constexpr uint32_t N_RUNS = 8;
+  static constexpr uint32_t BATCHES_IN_FLIGHT = 2; // per queue, dynamic schedule
+  // Vulkan does not tell how many invocations the device runs at once; this is above the resident capacity of current
+  // desktop GPUs, and workgroups launched past it only find fewer tiles left
+  static constexpr uint32_t PERSISTENT_INVOCATIONS = 65536;
+  static constexpr uint32_t PROGRESSIVE_STRIDE = 8; // sample stride of the first --progressive pass
+
+  // what a module must declare to be used (CheckShaderInterface): the tile kernels and the passes over the image are
+  // specialized by KernelParams, shader_supersample.comp has a fixed workgroup size. The tile kernels also store in the
+  // --format the fractal buffer is sized for, a kernel without OUTPUT_FORMAT writes 16 bytes per pixel past its end, and
+  // all but the persistent one offset their rows by pushConstants::baseY, which --stream needs to stay in its band.
+  static inline const ShaderRequirements TILE_KERNEL_INTERFACE  = {{SPEC_ID_WIDTH, SPEC_ID_HEIGHT, SPEC_ID_WORKGROUP_SIZE_X,
+                                                                    SPEC_ID_OUTPUT_FORMAT}, uint32_t(offsetof(pushConstants, sizeX))};
+  static inline const ShaderRequirements PERSISTENT_INTERFACE   = {{SPEC_ID_WIDTH, SPEC_ID_HEIGHT, SPEC_ID_WORKGROUP_SIZE_X,
+                                                                    SPEC_ID_OUTPUT_FORMAT}};
+  // --kernel optimized also switches its shortcuts, without KERNEL_FEATURES the feature benchmark would time one loop
+  static inline const ShaderRequirements OPTIMIZED_INTERFACE    = {{SPEC_ID_WIDTH, SPEC_ID_HEIGHT, SPEC_ID_WORKGROUP_SIZE_X,
+                                                                    SPEC_ID_OUTPUT_FORMAT, SPEC_ID_KERNEL_FEATURES},
+                                                                   uint32_t(offsetof(pushConstants, sizeX))};
+  // --tile-cache specializes the kernel with KERNEL_FEATURE_TILE_ORIGIN, which reads the whole push constant range
+  static inline const ShaderRequirements TILE_CACHE_INTERFACE   = {{SPEC_ID_WIDTH, SPEC_ID_HEIGHT, SPEC_ID_WORKGROUP_SIZE_X,
+                                                                    SPEC_ID_OUTPUT_FORMAT, SPEC_ID_KERNEL_FEATURES},
+                                                                   uint32_t(sizeof(pushConstants))};
+  static inline const ShaderRequirements PASS_INTERFACE         = {{SPEC_ID_WIDTH, SPEC_ID_HEIGHT, SPEC_ID_WORKGROUP_SIZE_X}};
+  static inline const ShaderRequirements SUPERSAMPLE_INTERFACE  = {{SPEC_ID_WIDTH, SPEC_ID_HEIGHT}};
 
   VkInstance instance;
 
@@ -39,38 +92,131 @@ private:
   VkPhysicalDevice physicalDevice;
   VkDevice device;
 
-  VkPipeline       pipeline;
+  std::map<KernelParams, VkPipeline> pipelineVariants;
+  std::map<KernelParams, VkPipeline> persistentVariants; // --schedule persistent
+  std::map<KernelParams, VkPipeline> marianiVariants;    // --mariani-silver
+  std::map<KernelParams, VkPipeline> progressiveVariants; // --progressive
   VkPipelineLayout pipelineLayout;
-  VkShaderModule   computeShaderModule;
+  VkShaderModule   computeShaderModule;   // shader.comp or the deep-zoom kernel of --precision
+  Precision        precision = Precision::FLOAT; // arithmetic of computeShaderModule
+  VkShaderModule   persistentShaderModule = VK_NULL_HANDLE;
+  VkShaderModule   marianiShaderModule    = VK_NULL_HANDLE;
+  VkShaderModule   progressiveShaderModule = VK_NULL_HANDLE;
+  uint64_t         tileKernelHash         = 0; // SPIR-V of the kernel rendering tiles, part of the tile cache keys
 
-  VkCommandPool   commandPool1;
-  VkCommandPool   commandPool2;
+  std::vector<VkCommandPool> commandPools; // one per queue
 
-  VkDescriptorPool      descriptorPool;
-  VkDescriptorSet       descriptorSet;
+  VkDescriptorPool      descriptorPool = VK_NULL_HANDLE;
+  VkDescriptorSet       descriptorSet  = VK_NULL_HANDLE;
   VkDescriptorSetLayout descriptorSetLayout;
 
-  VkBuffer       fractalBuffer;
-  VkDeviceMemory bufferMemory;
-
-  struct pushConstants
-  {
-    uint32_t offX;
-    uint32_t offY;
-  };
+  VkBuffer       fractalBuffer = VK_NULL_HANDLE; // not allocated in the out-of-core mode
+  VkDeviceMemory bufferMemory  = VK_NULL_HANDLE;
+
+  VkBuffer       tileCounterBuffer = VK_NULL_HANDLE; // tile queue of the persistent schedule (binding 2)
+  VkDeviceMemory tileCounterMemory = VK_NULL_HANDLE;
+
+  // --precision: view and reference orbit of the deep-zoom kernels (binding 3), host visible
+  VkBuffer       precisionBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory precisionMemory = VK_NULL_HANDLE;
+  void*          precisionMapped = nullptr;
+
+  // --colorize: a second pass turns the counts of fractalBuffer into RGBA8 colors in colorBuffer
+  VkDescriptorSetLayout colorizeSetLayout    = VK_NULL_HANDLE;
+  VkPipelineLayout      colorizeLayout       = VK_NULL_HANDLE;
+  VkShaderModule        colorizeShaderModule = VK_NULL_HANDLE;
+  VkPipeline            colorizePipeline     = VK_NULL_HANDLE;
+  VkDescriptorPool      colorizePool         = VK_NULL_HANDLE;
+  VkDescriptorSet       colorizeSet          = VK_NULL_HANDLE;
+  VkBuffer       colorBuffer   = VK_NULL_HANDLE;
+  VkDeviceMemory colorMemory   = VK_NULL_HANDLE;
+  VkBuffer       paletteBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory paletteMemory = VK_NULL_HANDLE;
+
+  // --stats: the reduction pass of the same counts into statsBuffer, copied into the small statsReadback buffer
+  VkDescriptorSetLayout histogramSetLayout    = VK_NULL_HANDLE;
+  VkPipelineLayout      histogramLayout       = VK_NULL_HANDLE;
+  VkShaderModule        histogramShaderModule = VK_NULL_HANDLE;
+  VkPipeline            histogramPipeline     = VK_NULL_HANDLE;
+  VkDescriptorPool      histogramPool         = VK_NULL_HANDLE;
+  VkDescriptorSet       histogramSet          = VK_NULL_HANDLE;
+  VkBuffer       statsBuffer         = VK_NULL_HANDLE;
+  VkDeviceMemory statsMemory         = VK_NULL_HANDLE;
+  VkBuffer       statsReadback       = VK_NULL_HANDLE;
+  VkDeviceMemory statsReadbackMemory = VK_NULL_HANDLE;
+  void*          statsReadbackMapped = nullptr;
+
+  // --supersample: edge detection into edgeListBuffer and the indirect supersample pass over it, after the colorize pass
+  VkDescriptorSetLayout edgeSetLayout           = VK_NULL_HANDLE;
+  VkPipelineLayout      edgeLayout              = VK_NULL_HANDLE;
+  VkShaderModule        edgeShaderModule        = VK_NULL_HANDLE;
+  VkPipeline            edgePipeline            = VK_NULL_HANDLE;
+  VkDescriptorPool      edgePool                = VK_NULL_HANDLE;
+  VkDescriptorSet       edgeSet                 = VK_NULL_HANDLE;
+  VkDescriptorSetLayout supersampleSetLayout    = VK_NULL_HANDLE;
+  VkPipelineLayout      supersampleLayout       = VK_NULL_HANDLE;
+  VkShaderModule        supersampleShaderModule = VK_NULL_HANDLE;
+  VkPipeline            supersamplePipeline     = VK_NULL_HANDLE;
+  VkDescriptorPool      supersamplePool         = VK_NULL_HANDLE;
+  VkDescriptorSet       supersampleSet          = VK_NULL_HANDLE;
+  VkBuffer       edgeListBuffer     = VK_NULL_HANDLE;
+  VkDeviceMemory edgeListMemory     = VK_NULL_HANDLE;
+  VkBuffer       edgeReadback       = VK_NULL_HANDLE;
+  VkDeviceMemory edgeReadbackMemory = VK_NULL_HANDLE;
+  void*          edgeReadbackMapped = nullptr;
+
+  VkBuffer       paramsBuffer;
+  VkDeviceMemory paramsMemory;
+  void*          paramsMapped = nullptr;
+
+  RenderParams renderParams = {}; // the view of the configuration rounded to float, set by run()
+
+  std::unique_ptr<vk_utils::FencePool> fencePool;
+  std::unique_ptr<RenderPlan>          plan;
+  std::unique_ptr<GpuProfiler>         profiler;
+
+  // --hybrid: the CPU backend renders its tiles into this host buffer, the plan uploads them into fractalBuffer
+  std::unique_ptr<CpuTileBackend> hostBackend;
+  VkBuffer       hostImageBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory hostImageMemory = VK_NULL_HANDLE;
+  void*          hostImageMapped = nullptr;
+
+  std::unique_ptr<PersistentPipelineCache> pipelineCache;
+
+  // the application object is created first thing in main(), so this is close enough to process start
+  const std::chrono::high_resolution_clock::time_point startupBegin = std::chrono::high_resolution_clock::now();
+  float pipelineCreationMs = 0.0f;
+  bool  firstDispatchDone  = false;
 
   std::vector<const char *> enabledLayers;
 
-  VkQueue queue1;
-  VkQueue queue2;
+  std::vector<vk_utils::QueueSlot> queueSlots;
+  std::vector<VkQueue>             queues;
+
+  VkQueue       transferQueue = VK_NULL_HANDLE; // dedicated transfer queue of the pipelined readback, if any
+  VkCommandPool transferPool  = VK_NULL_HANDLE;
+
+  VkDeviceSize hostImportAlignment = 0; // minImportedHostPointerAlignment, 0 without VK_EXT_external_memory_host
 
   static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
 
+  // share of pixels --validate lets differ from the CPU reference; float rounding on the GPU (fused multiply-adds,
+  // its own division) moves the iteration count of pixels right on the set border
+  static constexpr double VALIDATE_MAX_MISMATCH_PERCENT = 1.0;
+
 public:
 
-  void run(unsigned deviceId = 0, const std::vector<uint32_t> &queueFamilyIndices = {0, 2})
+  void run(const AppConfig& a_config)
   {
-    assert(queueFamilyIndices.size() == 2);
+    renderParams = {float(a_config.view.centerX), float(a_config.view.centerY), float(a_config.view.scale), 0.0f};
+
+    if(a_config.backend == Backend::CPU)
+    {
+      runCpu(a_config);
+      return;
+    }
+
+    const unsigned deviceId = a_config.deviceId;
 
     std::cout << "init vulkan for device " << deviceId << " ... " << std::endl;
 
@@ -83,174 +229,1463 @@ public:
 
     physicalDevice = vk_utils::FindPhysicalDevice(instance, true, deviceId);
 
-    device = vk_utils::CreateLogicalDevice(queueFamilyIndices, physicalDevice, enabledLayers);
+    queueSlots = vk_utils::FindComputeQueues(physicalDevice, a_config.maxQueues);
+
+    // the pipelined readback copies on a transfer-only family when there is one
+    std::vector<vk_utils::QueueSlot> deviceSlots = queueSlots;
+    const uint32_t transferFamily = a_config.pipelinedReadback ? vk_utils::FindDedicatedTransferFamily(physicalDevice) : uint32_t(-1);
+    if(transferFamily != uint32_t(-1))
+      deviceSlots.push_back({transferFamily, 0});
+    const std::vector<uint32_t> queueFamilyIndices = vk_utils::UniqueFamilies(deviceSlots);
 
-    vkGetDeviceQueue(device, queueFamilyIndices[0], 0, &queue1);
-    vkGetDeviceQueue(device, queueFamilyIndices[1], 0, &queue2);
+    // importing the mapped output file as staging memory lets the GPU copy land in the file directly
+    std::vector<const char*> deviceExtensions;
+    if(a_config.zeroCopy && vk_utils::DeviceExtensionSupported(physicalDevice, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME))
+      deviceExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
 
-    size_t bufferSize = sizeof(Pixel) * WIDTH * HEIGHT;
+    // native doubles are enabled only for the modes that may use them
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    VkPhysicalDeviceFeatures features = {};
+    if(a_config.precision == Precision::DOUBLE || a_config.precision == Precision::AUTO)
+      features.shaderFloat64 = supportedFeatures.shaderFloat64;
+    const bool fp64Supported = (features.shaderFloat64 == VK_TRUE);
+
+    device = vk_utils::CreateLogicalDevice(deviceSlots, physicalDevice, enabledLayers, deviceExtensions, &features);
+
+    precision = a_config.precision;
+    if(precision == Precision::DOUBLE && !fp64Supported)
+    {
+      std::cout << "the device has no shaderFloat64, --precision double falls back to float-float" << std::endl;
+      precision = Precision::FLOAT_FLOAT;
+    }
+
+    if(!deviceExtensions.empty())
+    {
+      VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostMemoryProps = {};
+      hostMemoryProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+      VkPhysicalDeviceProperties2 props = {};
+      props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+      props.pNext = &hostMemoryProps;
+      vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+      hostImportAlignment = hostMemoryProps.minImportedHostPointerAlignment;
+    }
+
+    queues.resize(queueSlots.size());
+    std::cout << "using " << queues.size() << " compute queue(s): { ";
+    for(size_t i = 0; i < queueSlots.size(); ++i)
+    {
+      vkGetDeviceQueue(device, queueSlots[i].family, queueSlots[i].index, &queues[i]);
+      std::cout << "(family " << queueSlots[i].family << ", index " << queueSlots[i].index << ") ";
+    }
+    std::cout << "}" << std::endl;
 
     std::cout << "creating resources ... " << std::endl;
-    createBuffer(device, physicalDevice, bufferSize, &fractalBuffer, &bufferMemory, queueFamilyIndices);
+    createUniformBuffer(device, physicalDevice, sizeof(RenderParams), &paramsBuffer, &paramsMemory);
+    VK_CHECK_RESULT(vkMapMemory(device, paramsMemory, 0, sizeof(RenderParams), 0, &paramsMapped));
 
     createDescriptorSetLayout(device, &descriptorSetLayout);
-    createDescriptorSetForOurBuffer(device, fractalBuffer, bufferSize, &descriptorSetLayout,
-                                    &descriptorPool, &descriptorSet);
 
     std::cout << "compiling shaders  ... " << std::endl;
-    createComputePipeline(device, descriptorSetLayout,
-                          &computeShaderModule, &pipeline, &pipelineLayout);
+    // auto starts with the float kernel and switches after benchmarking the modes
+    createShaderModule(device, tileShaderPath(a_config, (precision == Precision::AUTO) ? Precision::FLOAT : precision).c_str(),
+                       a_config.tileCache ? TILE_CACHE_INTERFACE : (a_config.optimizedKernel ? OPTIMIZED_INTERFACE : TILE_KERNEL_INTERFACE),
+                       &computeShaderModule, &tileKernelHash);
+    if(a_config.schedule == Schedule::PERSISTENT)
+      createShaderModule(device, a_config.persistentShaderPath.c_str(), PERSISTENT_INTERFACE, &persistentShaderModule);
+    if(a_config.marianiSilver)
+      createShaderModule(device, a_config.marianiShaderPath.c_str(), a_config.tileCache ? TILE_CACHE_INTERFACE : TILE_KERNEL_INTERFACE,
+                         &marianiShaderModule, &tileKernelHash);
+    if(a_config.progressive)
+      createShaderModule(device, a_config.progressiveShaderPath.c_str(), TILE_KERNEL_INTERFACE, &progressiveShaderModule);
+    if(a_config.colorize)
+      createShaderModule(device, a_config.colorizeShaderPath.c_str(), PASS_INTERFACE, &colorizeShaderModule);
+    if(a_config.stats)
+      createShaderModule(device, a_config.histogramShaderPath.c_str(), PASS_INTERFACE, &histogramShaderModule);
+    if(a_config.supersample != 0)
+    {
+      createShaderModule(device, a_config.edgeShaderPath.c_str(), PASS_INTERFACE, &edgeShaderModule);
+      createShaderModule(device, a_config.supersampleShaderPath.c_str(), SUPERSAMPLE_INTERFACE, &supersampleShaderModule);
+    }
+    createPipelineLayout(device, descriptorSetLayout, &pipelineLayout);
+
+    pipelineCache = std::make_unique<PersistentPipelineCache>(device, physicalDevice, a_config.pipelineCachePath);
+    if(pipelineCache->Loaded())
+      std::cout << "pipeline cache: " << pipelineCache->LoadedBytes() << " bytes loaded from " << a_config.pipelineCachePath << std::endl;
+
+    commandPools.resize(queues.size());
+    for(size_t i = 0; i < queues.size(); ++i)
+    {
+      VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+      commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+      commandPoolCreateInfo.queueFamilyIndex = queueSlots[i].family;
+      VK_CHECK_RESULT(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPools[i]));
+    }
+
+    if(transferFamily != uint32_t(-1))
+    {
+      vkGetDeviceQueue(device, transferFamily, 0, &transferQueue);
+
+      VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+      commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+      commandPoolCreateInfo.queueFamilyIndex = transferFamily;
+      VK_CHECK_RESULT(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &transferPool));
+    }
+
+    fencePool = std::make_unique<vk_utils::FencePool>(device);
+
+    // out-of-core mode: nothing image sized is allocated
+    if(a_config.streamRows != 0)
+    {
+      streamToFile(a_config, queueFamilyIndices);
+      std::cout << "destroying all     ... " << std::endl;
+      cleanup();
+      return;
+    }
+
+    // zoom animation: every frame in flight has its own buffers
+    if(a_config.animateFrames != 0)
+    {
+      animate(a_config, queueFamilyIndices);
+      std::cout << "destroying all     ... " << std::endl;
+      cleanup();
+      return;
+    }
+
+    size_t bufferSize = a_config.kernel.ImageBytes();
+
+    createBuffer(device, physicalDevice, bufferSize, &fractalBuffer, &bufferMemory, queueFamilyIndices);
+    if(a_config.schedule == Schedule::PERSISTENT)
+      createBuffer(device, physicalDevice, sizeof(uint32_t), &tileCounterBuffer, &tileCounterMemory, queueFamilyIndices);
+    if(precision != Precision::FLOAT)
+    {
+      const size_t precisionBytes = PrecisionBufferBytes(a_config.kernel.iterations);
+      createUniformBuffer(device, physicalDevice, precisionBytes, &precisionBuffer, &precisionMemory, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+      VK_CHECK_RESULT(vkMapMemory(device, precisionMemory, 0, precisionBytes, 0, &precisionMapped));
+      const uint32_t orbitLength = FillPrecisionBuffer(a_config.view, a_config.kernel, precisionMapped);
+      std::cout << "reference orbit    " << orbitLength << " points at the center of the view" << std::endl;
+    }
+    createDescriptorSetForOurBuffer(device, fractalBuffer, bufferSize, paramsBuffer, tileCounterBuffer, precisionBuffer,
+                                    &descriptorSetLayout, &descriptorPool, &descriptorSet);
+
+    // --colorize reads back RGBA8 colors through the same staging buffer, iter16 counts are half their size
+    const size_t colorBytes  = size_t(a_config.kernel.width) * a_config.kernel.height * 4;
+    const size_t stagingSize = a_config.colorize ? std::max(bufferSize, colorBytes) : bufferSize;
 
     VkBuffer stagingBuf;
     VkDeviceMemory stagingMem;
-    createStagingBuffer(device, physicalDevice, bufferSize, &stagingBuf, &stagingMem);
+    createStagingBuffer(device, physicalDevice, stagingSize, &stagingBuf, &stagingMem, queueFamilyIndices);
 
-    constexpr unsigned total = WIDTH * HEIGHT;
-    constexpr unsigned perTileX = TILE_X;
-    constexpr unsigned perTileY = TILE_Y;
-    constexpr unsigned perTile = perTileX * perTileY;
-    constexpr unsigned nTilesX  = WIDTH / perTileX;
-    constexpr unsigned nTilesY  = HEIGHT / perTileY;
-    constexpr unsigned nTiles  = nTilesX * nTilesY;
+    // mapped once for the whole run, the readback only reads through this pointer
+    void* stagingMapped = nullptr;
+    VK_CHECK_RESULT(vkMapMemory(device, stagingMem, 0, VK_WHOLE_SIZE, 0, &stagingMapped));
 
-    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
-    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndices[0];
-    VK_CHECK_RESULT(vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool1));
+    if(a_config.hybrid)
+    {
+      createStagingBuffer(device, physicalDevice, bufferSize, &hostImageBuffer, &hostImageMemory, queueFamilyIndices);
+      VK_CHECK_RESULT(vkMapMemory(device, hostImageMemory, 0, VK_WHOLE_SIZE, 0, &hostImageMapped));
+    }
 
-    VkCommandPoolCreateInfo commandPoolCreateInfo2 = {};
-    commandPoolCreateInfo2.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    commandPoolCreateInfo2.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    commandPoolCreateInfo2.queueFamilyIndex = queueFamilyIndices[1];
-    VK_CHECK_RESULT(vkCreateCommandPool(device, &commandPoolCreateInfo2, nullptr, &commandPool2));
+    if(precision == Precision::AUTO)
+      precision = selectPrecision(a_config, fp64Supported);
+    else
+      reportPrecision(a_config);
+
+    KernelParams kernel = a_config.kernel;
+    if(a_config.sweep)
+      kernel = sweepKernelParams(a_config);
+    // the whole run renders the view the tile cache ends on, so the benchmark, the saved image and --validate agree
+    if(a_config.tileCache)
+      renderParams = SnapToPixelGrid(renderParams, kernel);
+
+    float computeTime = 0.0f;
+    if(a_config.marianiSilver)
+      computeTime = compareMarianiSilver(a_config, kernel, stagingBuf, stagingMapped);
+    else if(a_config.optimizedKernel && precision == Precision::FLOAT)
+      computeTime = compareKernelFeatures(a_config, kernel, stagingBuf, stagingMapped);
+    else
+      computeTime = benchmark(a_config, kernel, true);
+    if(a_config.tileCache)
+      computeTime = renderCached(a_config, kernel, stagingBuf, stagingMapped, computeTime);
+    if(a_config.progressive)
+      renderProgressive(a_config, kernel, stagingBuf, stagingMapped, computeTime);
+
+    RenderStats stats;
+    if(a_config.stats)
+      stats = reduceStats(a_config, kernel, stagingBuf, stagingMapped, queueFamilyIndices);
 
+    std::cout << "saving image       ... " << std::endl;
+    if(a_config.colorize)
+    {
+      // the colors take the staging buffer, so the counts are validated before the colorize pass
+      if(a_config.validate)
+      {
+        copyToStaging(stagingBuf, kernel.ImageBytes());
+        validateAgainstCpu(a_config, kernel, stagingMapped);
+      }
+      colorizeAndSave(a_config, kernel, a_config.equalize ? &stats : nullptr, stagingBuf, stagingMapped, queueFamilyIndices, computeTime);
+    }
+    else
+    {
+      // validation reads the image back through staging, so it takes the staging path
+      const bool savedZeroCopy = (hostImportAlignment != 0 && kernel.outputFormat == OUTPUT_FORMAT_RGBA8 && !a_config.validate) &&
+                                 saveZeroCopy(a_config, kernel, queueFamilyIndices, computeTime);
+      if(!savedZeroCopy)
+        readbackAndSave(device, fractalBuffer, stagingBuf, stagingMapped, commandPools[0], queues[0], fencePool.get(), kernel, a_config,
+                        computeTime);
+
+      if(a_config.validate)
+        validateAgainstCpu(a_config, kernel, stagingMapped);
+    }
+
+    if(a_config.pipelinedReadback)
+      pipelinedRender(a_config, kernel, stagingBuf, stagingMapped, transferFamily);
+    std::cout << "destroying all     ... " << std::endl;
+
+    vkUnmapMemory(device, stagingMem);
+    vkDestroyBuffer(device, stagingBuf, nullptr);
+    vkFreeMemory(device, stagingMem, nullptr);
+    cleanup();
+  }
+
+  // Records a plan for the given parameters, replays it a_config.runs times and returns the average replay time in ms.
+  float benchmark(const AppConfig& a_config, const KernelParams& a_kernel, bool a_verbose)
+  {
+    const uint32_t N_RUNS   = a_config.runs;
+    const uint32_t perTileX = a_kernel.tileX;
+    const uint32_t perTileY = a_kernel.tileY;
+    const uint32_t nTilesX  = a_kernel.TilesX();
+    const uint32_t nTilesY  = a_kernel.TilesY();
+
+    const bool dynamicSchedule    = (a_config.schedule == Schedule::DYNAMIC);
+    const bool persistentSchedule = (a_config.schedule == Schedule::PERSISTENT);
+    const bool lptSchedule        = (a_config.schedule == Schedule::LPT);
+
+    plan.reset();
+    profiler.reset();
+    VkPipeline pipeline = getPipeline(a_kernel);
+    if(persistentSchedule)
+      pipeline = getPersistentPipeline(a_kernel);
+    else if(a_config.marianiSilver)
+      pipeline = getMarianiPipeline(a_kernel);
+
+    plan = std::make_unique<RenderPlan>(device, pipeline, pipelineLayout, descriptorSet, a_kernel.workgroupSize, fencePool.get());
+    plan->SetWorkgroupPerTile(a_config.marianiSilver);
+
+    for(size_t i = 0; i < queues.size(); ++i)
+      plan->AddQueue(queues[i], queueSlots[i].family, commandPools[i]);
+
+    // the persistent kernel has no per-tile dispatch to put timestamps around
+    if(a_verbose && !a_config.tracePath.empty() && persistentSchedule)
+      std::cout << "--trace is not supported with --schedule persistent, no trace is written" << std::endl;
+    else if(a_verbose && !a_config.tracePath.empty())
+    {
+      profiler = std::make_unique<GpuProfiler>(device, physicalDevice, nTilesX * nTilesY);
+      for(size_t i = 0; i < queues.size(); ++i)
+      {
+        std::stringstream name;
+        name << "queue " << i << " (family " << queueSlots[i].family << ", index " << queueSlots[i].index << ")";
+        profiler->AddQueue(name.str(), queues[i], queueSlots[i].family, commandPools[i]);
+      }
+      plan->SetProfiler(profiler.get());
+    }
+
+    if(a_config.hybrid)
+    {
+      hostBackend = std::make_unique<CpuTileBackend>(a_kernel, a_config.cpuThreads, DetectCpuIsa(a_config.cpuIsaLimit));
+      plan->SetHostBackend(hostBackend.get(), hostBackend->ThreadsNum(), a_kernel, &renderParams,
+                           hostImageMapped, hostImageBuffer, fractalBuffer);
+    }
+
+    // static: diagonal stripes over N queues, for two queues this is the checkerboard
+    const uint32_t nQueues = uint32_t(queues.size());
+    const std::vector<TileRect> frameTiles = makeFrameTiles(a_kernel);
+    // persistent: the kernel walks the tiles itself
+    for(const TileRect& tile : frameTiles)
+    {
+      if(dynamicSchedule)
+        plan->AddSharedTile(tile);
+      else if(!persistentSchedule && !lptSchedule)
+        plan->AddTile((tile.id / nTilesX + tile.id % nTilesX) % nQueues, tile);
+    }
+
+    // lpt: a low resolution pre-pass on the CPU estimates the tiles, which are packed onto queues longest first
+    std::vector<double> predictedLoads;
+    float prepassMs = 0.0f;
+    if(lptSchedule)
+    {
+      const auto prepassStart = std::chrono::high_resolution_clock::now();
+      const std::vector<double> costs = EstimateTileCosts(a_kernel, renderParams, a_config.cpuThreads, DetectCpuIsa(a_config.cpuIsaLimit));
+      const auto bins = AssignLongestFirst(frameTiles, costs, queues.size(), &predictedLoads);
+      prepassMs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - prepassStart).count()/1000.f;
+      for(size_t q = 0; q < bins.size(); ++q)
+      {
+        for(const TileRect& tile : bins[q])
+          plan->AddTile(q, tile);
+      }
+    }
+    const uint32_t persistentGroups = persistentSchedule ? persistentWorkgroups(a_config, a_kernel) : 0;
+
+    if(a_verbose)
+      std::cout << "recording commands ... " << std::endl;
+    auto recordStart = std::chrono::high_resolution_clock::now();
+    if(persistentSchedule)
+      plan->RecordPersistent(tileCounterBuffer, persistentGroups, uint32_t(frameTiles.size()));
+    else if(dynamicSchedule)
+      plan->RecordShared(a_config.batchSize);
+    else
+      plan->Record(a_config.tilesPerCmd);
+    auto recordEnd = std::chrono::high_resolution_clock::now();
+    float record_time = std::chrono::duration_cast<std::chrono::microseconds>(recordEnd - recordStart).count()/1000.f;
+
+    std::vector<QueueStats> queueStats;
 
     float average_time = 0.0f;
 
-    std::cout << "doing " << N_RUNS << " runs of computations ... " << std::endl;
+    if(a_verbose)
+      std::cout << "doing " << N_RUNS << " runs of computations ... " << std::endl;
     for (size_t RUN = 0; RUN < N_RUNS; ++RUN)
     {
-      std::vector<VkCommandBuffer> cmds1(nTiles / 2);
-      std::vector<VkCommandBuffer> cmds2(nTiles / 2);
+      // only uniform data is touched between runs, command buffers are reused as is
+      updateRenderParams(renderParams);
 
-      createCommandBuffers(device, commandPool1, cmds1, cmds1.size());
-      createCommandBuffers(device, commandPool2, cmds2, cmds2.size());
+      auto start = std::chrono::high_resolution_clock::now();
 
-      size_t idx1 = 0;
-      size_t idx2 = 0;
-      for(size_t i = 0; i < nTilesY; ++i)
+      if(!firstDispatchDone)
       {
-        for(size_t j = 0; j < nTilesX; ++j)
-        {
-          if((i + j) % 2 == 0)
-          {
-            recordCommandsTo(cmds1[idx1], pipeline, pipelineLayout, descriptorSet,
-                             perTileX, perTileX * j, perTileY, perTileY * i);
-            idx1++;
-          }
-          else
-          {
-            recordCommandsTo(cmds2[idx2], pipeline, pipelineLayout, descriptorSet,
-                             perTileX, perTileX * j, perTileY, perTileY * i);
-            idx2++;
-          }
-        }
+        firstDispatchDone = true;
+        float startup_time = std::chrono::duration_cast<std::chrono::microseconds>(start - startupBegin).count()/1000.f;
+        std::cout << "startup to first dispatch " << startup_time << " milliseconds (pipeline creation "
+                  << pipelineCreationMs << " ms, pipeline cache " << (pipelineCache->Loaded() ? "warm" : "cold") << ")" << std::endl;
       }
 
+      if(persistentSchedule)
+        plan->ReplayPersistent(&queueStats);
+      else if(dynamicSchedule)
+        plan->ReplayDynamic(BATCHES_IN_FLIGHT, &queueStats);
+      else
+        plan->Replay(SUBMIT_ITERS, multithreadedSubmit, &queueStats);
+
+      auto end = std::chrono::high_resolution_clock::now();
+
+      float ms_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()/1000.f;
+
+      average_time += ms_elapsed;
+
+      if(profiler && RUN + 1 == N_RUNS)
+        profiler->Collect(frameTiles, plan->TileQueues(), start, end);
+    }
+
+    if(!a_verbose)
+      return average_time / N_RUNS;
+
+    std::cout << "image " << a_kernel.width << "x" << a_kernel.height << ", tile " << perTileX << "x" << perTileY
+              << ", workgroup " << a_kernel.workgroupSize << "x" << a_kernel.workgroupSize
+              << ", " << a_kernel.iterations << " iterations" << std::endl;
+    if(lptSchedule)
+      std::cout << "lpt schedule        cost pre-pass " << prepassMs << " ms (1 sample per " << COST_SAMPLE_STEP << "x"
+                << COST_SAMPLE_STEP << " pixels, at most " << COST_MAX_ITERATIONS << " iterations)" << std::endl;
+    if(persistentSchedule)
+      std::cout << "persistent schedule " << persistentGroups << " workgroups claim " << frameTiles.size()
+                << " tiles in one dispatch on queue 0" << std::endl;
+    else if(dynamicSchedule)
+      std::cout << "dynamic schedule    " << plan->SharedBatchesNum() << " batches of " << a_config.batchSize << " tile(s)" << std::endl;
+    else
+    {
+      std::cout << "command buffers     " << plan->CommandBuffersNum() << " (tiles per buffer: ";
+      if(a_config.tilesPerCmd == 0)
+        std::cout << "all";
+      else
+        std::cout << a_config.tilesPerCmd;
+      std::cout << ")" << std::endl;
+    }
+    std::cout << "record time (once)  " << record_time << " milliseconds" << std::endl;
+    std::cout << "average replay time " << average_time / N_RUNS << " milliseconds" << std::endl;
+    std::cout << "throughput          " << megapixelsPerSecond(a_kernel, average_time / N_RUNS) << " MPix/s" << std::endl;
+    std::cout << "fences in pool      " << fencePool->Size() << std::endl;
+    // lpt: how well the estimate predicted the split of the work
+    double totalPredicted = 0.0, totalBusy = 0.0;
+    for(double load : predictedLoads)
+      totalPredicted += load;
+    for(const auto& stats : queueStats)
+      totalBusy += stats.busyMs;
+    totalPredicted = std::max(totalPredicted, 1e-9);
+    totalBusy      = std::max(totalBusy, 1e-9);
+
+    for(size_t q = 0; q < queueStats.size(); ++q)
+    {
+      if(q < plan->QueuesNum())
+        std::cout << "  queue " << q << ": ";
+      else
+        std::cout << "  host (cpu " << CpuIsaName(hostBackend->Isa()) << ", " << hostBackend->ThreadsNum() << " threads): ";
+      std::cout << queueStats[q].tiles / N_RUNS << " tiles in "
+                << queueStats[q].batches / N_RUNS << " submissions, busy " << queueStats[q].busyMs / N_RUNS
+                << " ms, idle " << queueStats[q].idleMs / N_RUNS << " ms (per run)";
+      if(plan->HasHostBackend())
+        std::cout << ", " << plan->MsPerTile()[q] << " ms/tile";
+      if(lptSchedule)
+        std::cout << ", " << 100.0 * predictedLoads[q] / totalPredicted << "% of the estimated cost, "
+                  << 100.0 * queueStats[q].busyMs / totalBusy << "% of the busy time";
+      std::cout << std::endl;
+    }
+
+    if(profiler)
+    {
+      profiler->PrintSummary();
+      profiler->WriteChromeTrace(a_config.tracePath.c_str());
+    }
+
+    return average_time / N_RUNS;
+  }
+
+  // The CPU backend on its own: no Vulkan object is created, so this also runs on hosts without a GPU. The frame is
+  // rendered a_config.runs times with the same tiles as the GPU benchmark and saved like the readback.
+  void runCpu(const AppConfig& a_config)
+  {
+    const KernelParams&         kernel = a_config.kernel;
+    const std::vector<TileRect> tiles  = makeFrameTiles(kernel);
+
+    CpuTileBackend        backend(kernel, a_config.cpuThreads, DetectCpuIsa(a_config.cpuIsaLimit));
+    std::vector<uint32_t> image(kernel.ImageBytes() / sizeof(uint32_t));
+
+    std::cout << "rendering on the CPU (" << CpuIsaName(backend.Isa()) << ", " << backend.ThreadsNum() << " threads), "
+              << a_config.runs << " runs ... " << std::endl;
+
+    float average_time = 0.0f;
+    for(uint32_t run = 0; run < a_config.runs; ++run)
+    {
+      auto start = std::chrono::high_resolution_clock::now();
+      backend.RenderTiles(tiles.data(), tiles.size(), renderParams, image.data());
+      auto end = std::chrono::high_resolution_clock::now();
+      average_time += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()/1000.f;
+    }
+    average_time /= a_config.runs;
+
+    std::cout << "image " << kernel.width << "x" << kernel.height << ", tile " << kernel.tileX << "x" << kernel.tileY
+              << ", " << kernel.iterations << " iterations, " << tiles.size() << " tiles" << std::endl;
+    std::cout << "average render time " << average_time << " milliseconds" << std::endl;
+    std::cout << "throughput          " << megapixelsPerSecond(kernel, average_time) << " MPix/s" << std::endl;
+
+    std::cout << "saving image       ... " << std::endl;
+    MappedFile file("mandelbrot.bmp", BMPFileSize(int(kernel.width), int(kernel.height)));
+    WriteBMPHeader(file.Data(), int(kernel.width), int(kernel.height));
+    ConvertToBMPPixels(image.data(), kernel, file.Data() + BMP_HEADER_SIZE, a_config.readbackThreads, DetectSimdPath(a_config.simdLimit));
+  }
+
+  // Renders the frame with the CPU backend and compares a_gpuImage (the readback of the same frame) against it.
+  // Only meaningful for shaders/comp.spv, the kernel the CPU backend implements.
+  void validateAgainstCpu(const AppConfig& a_config, const KernelParams& a_kernel, const void* a_gpuImage)
+  {
+    const std::vector<TileRect> tiles = makeFrameTiles(a_kernel);
+
+    CpuTileBackend        backend(a_kernel, a_config.cpuThreads, DetectCpuIsa(a_config.cpuIsaLimit));
+    std::vector<uint32_t> reference(a_kernel.ImageBytes() / sizeof(uint32_t));
+    backend.RenderTiles(tiles.data(), tiles.size(), renderParams, reference.data());
+
+    const ImageDiff diff    = CompareFractalBuffers(a_gpuImage, reference.data(), a_kernel);
+    const double    percent = 100.0 * double(diff.mismatched) / double(std::max<size_t>(diff.pixels, 1));
+    std::cout << "validation against the CPU backend (" << CpuIsaName(backend.Isa()) << "): " << diff.mismatched << " of "
+              << diff.pixels << " pixels differ (" << percent << "%), max difference " << diff.maxDiff
+              << (a_kernel.outputFormat == OUTPUT_FORMAT_ITER16 || a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F ? " iterations" : "")
+              << std::endl;
+
+    if(percent > VALIDATE_MAX_MISMATCH_PERCENT)
+      RUN_TIME_ERROR("the GPU image does not match the CPU reference");
+  }
+
+  // --mariani-silver: benchmarks the brute-force kernel and keeps its image, then benchmarks the Mariani-Silver kernel
+  // (whose image stays in the fractal buffer) and reports the speedup and the pixels the fill got wrong.
+  float compareMarianiSilver(const AppConfig& a_config, const KernelParams& a_kernel, VkBuffer a_stagingBuf, const void* a_stagingMapped)
+  {
+    AppConfig bruteForce = a_config;
+    bruteForce.marianiSilver = false;
+
+    std::cout << "brute force runs   ... " << std::endl;
+    const float bruteForceMs = benchmark(bruteForce, a_kernel, false);
+    copyToStaging(a_stagingBuf, a_kernel.ImageBytes());
+    const uint8_t* staged = static_cast<const uint8_t*>(a_stagingMapped);
+    const std::vector<uint8_t> reference(staged, staged + a_kernel.ImageBytes());
+
+    const float marianiMs = benchmark(a_config, a_kernel, true);
+    copyToStaging(a_stagingBuf, a_kernel.ImageBytes());
+
+    const ImageDiff diff    = CompareFractalBuffers(a_stagingMapped, reference.data(), a_kernel);
+    const double    percent = 100.0 * double(diff.mismatched) / double(std::max<size_t>(diff.pixels, 1));
+    std::cout << "mariani-silver      " << marianiMs << " ms against " << bruteForceMs << " ms brute force, speedup "
+              << bruteForceMs / std::max(marianiMs, 0.001f) << "x" << std::endl;
+    std::cout << "                    " << diff.mismatched << " of " << diff.pixels << " pixels differ from brute force ("
+              << percent << "%), max difference " << diff.maxDiff
+              << (a_kernel.outputFormat == OUTPUT_FORMAT_ITER16 || a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F ? " iterations" : "")
+              << std::endl;
+    return marianiMs;
+  }
+
+  // --kernel optimized: benchmarks the kernel with no interior shortcut (the loop of shader.comp), with each one alone
+  // and, last and verbose, with both, reporting the speedup and the pixels that differ against no shortcut.
+  float compareKernelFeatures(const AppConfig& a_config, const KernelParams& a_kernel, VkBuffer a_stagingBuf, const void* a_stagingMapped)
+  {
+    struct Variant
+    {
+      const char* name;
+      uint32_t    features;
+    };
+    const Variant variants[] = {{"none", 0}, {"interior test", KERNEL_FEATURE_INTERIOR_TEST}, {"periodicity", KERNEL_FEATURE_PERIODICITY},
+                                {"both", KERNEL_FEATURE_INTERIOR_TEST | KERNEL_FEATURE_PERIODICITY}};
+    const size_t variantsNum = sizeof(variants) / sizeof(variants[0]);
+
+    std::cout << "benchmarking the interior shortcuts ... " << std::endl;
+    std::vector<uint8_t> reference;
+    std::vector<float>   times;
+    std::vector<size_t>  mismatched;
+    for(size_t i = 0; i < variantsNum; ++i)
+    {
+      KernelParams params = a_kernel;
+      params.features = variants[i].features;
+      times.push_back(benchmark(a_config, params, i + 1 == variantsNum));
+      copyToStaging(a_stagingBuf, a_kernel.ImageBytes());
+
+      const uint8_t* staged = static_cast<const uint8_t*>(a_stagingMapped);
+      if(i == 0)
+        reference.assign(staged, staged + a_kernel.ImageBytes());
+      mismatched.push_back(CompareFractalBuffers(staged, reference.data(), a_kernel).mismatched);
+    }
+
+    // the last benchmark left the image with both shortcuts in the fractal buffer
+    std::cout << "interior shortcuts against none:" << std::endl;
+    std::cout << "  shortcuts       replay ms  speedup  pixels differing" << std::endl;
+    for(size_t i = 0; i < variantsNum; ++i)
+      std::cout << "  " << variants[i].name << std::string(16 - std::strlen(variants[i].name), ' ') << times[i] << "\t     "
+                << times[0] / std::max(times[i], 0.001f) << "x\t      " << mismatched[i] << std::endl;
+    return times.back();
+  }
+
+  // --colorize: colors the counts the benchmark left in the fractal buffer a_config.runs times and saves the colors.
+  // The counts are not recomputed, so this is the whole cost of showing the same render with another palette.
+  // a_pStats, when given, equalizes the palette over its histogram.
+  void colorizeAndSave(const AppConfig& a_config, const KernelParams& a_kernel, const RenderStats* a_pStats, VkBuffer a_stagingBuf,
+                       const void* a_stagingMapped, const std::vector<uint32_t>& a_queueFamilyIndices, float a_computeTime)
+  {
+    KernelParams colorKernel = a_kernel;
+    colorKernel.outputFormat = OUTPUT_FORMAT_RGBA8;
+    createColorizeResources(a_config, a_kernel, a_pStats, colorKernel.ImageBytes(), a_queueFamilyIndices);
+
+    float colorizeMs = 0.0f;
+    {
+      Colorizer colorizer(device, colorizePipeline, colorizeLayout, colorizeSet, a_kernel, queues[0], commandPools[0], fencePool.get());
+      for(uint32_t run = 0; run < a_config.runs; ++run)
+        colorizeMs += colorizer.Run();
+    }
+    colorizeMs /= a_config.runs;
+
+    std::cout << "colorize pass       " << colorizeMs << " milliseconds (" << PaletteName(a_config.palette)
+              << (a_pStats != nullptr ? " palette equalized, " : " palette, ")
+              << 100.0f * colorizeMs / std::max(a_computeTime, 0.001f) << "% of the " << a_computeTime << " ms replay)" << std::endl;
+
+    float supersampleMs = 0.0f;
+    if(a_config.supersample != 0)
+      supersampleMs = supersampleEdges(a_config, a_kernel, colorKernel.ImageBytes(), a_stagingBuf, a_stagingMapped, a_queueFamilyIndices);
+
+    readbackAndSave(device, colorBuffer, a_stagingBuf, a_stagingMapped, commandPools[0], queues[0], fencePool.get(), colorKernel,
+                    a_config, a_computeTime + colorizeMs + supersampleMs);
+  }
+
+  // --supersample: anti-aliases the colors of the colorize pass a_config.runs times, recoloring only the pixels on
+  // count boundaries from a_config.supersample^2 samples each, and returns the average time in ms. With --validate the
+  // number of edge pixels is checked against the host count on a readback of the counts.
+  float supersampleEdges(const AppConfig& a_config, const KernelParams& a_kernel, size_t a_colorBytes, VkBuffer a_stagingBuf,
+                         const void* a_stagingMapped, const std::vector<uint32_t>& a_queueFamilyIndices)
+  {
+    const size_t edgeListBytes = EdgeListBytes(a_kernel);
+    createBuffer(device, physicalDevice, edgeListBytes, &edgeListBuffer, &edgeListMemory, a_queueFamilyIndices,
+                 VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    createStagingBuffer(device, physicalDevice, sizeof(EdgeListHeader), &edgeReadback, &edgeReadbackMemory, a_queueFamilyIndices);
+    VK_CHECK_RESULT(vkMapMemory(device, edgeReadbackMemory, 0, VK_WHOLE_SIZE, 0, &edgeReadbackMapped));
+
+    const VkDescriptorType edgeTypes[2] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+    const VkDescriptorBufferInfo edgeBuffers[2] = {{fractalBuffer,  0, a_kernel.ImageBytes()},
+                                                   {edgeListBuffer, 0, edgeListBytes}};
+    createPassDescriptors(edgeTypes, edgeBuffers, 2, &edgeSetLayout, &edgeLayout, &edgePool, &edgeSet);
+
+    const VkDescriptorType sampleTypes[4] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                             VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+    const VkDescriptorBufferInfo sampleBuffers[4] = {{edgeListBuffer, 0, edgeListBytes},
+                                                     {colorBuffer,    0, a_colorBytes},
+                                                     {paletteBuffer,  0, sizeof(PaletteUniforms)},
+                                                     {paramsBuffer,   0, sizeof(RenderParams)}};
+    createPassDescriptors(sampleTypes, sampleBuffers, 4, &supersampleSetLayout, &supersampleLayout, &supersamplePool, &supersampleSet);
+
+    auto createStart = std::chrono::high_resolution_clock::now();
+    createComputePipeline(device, edgeLayout, edgeShaderModule, pipelineCache->Handle(), a_kernel, &edgePipeline);
+    createComputePipeline(device, supersampleLayout, supersampleShaderModule, pipelineCache->Handle(), a_kernel, &supersamplePipeline);
+    pipelineCreationMs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - createStart).count()/1000.f;
+
+    const uint32_t grid = a_config.supersample;
+    uint32_t edgePixels = 0;
+    float    supersampleMs = 0.0f;
+    {
+      EdgeSupersampler supersampler(device, edgePipeline, edgeLayout, edgeSet, supersamplePipeline, supersampleLayout, supersampleSet,
+                                    a_kernel, edgeListBuffer, grid, a_config.edgeThreshold, edgeReadback, edgeReadbackMapped,
+                                    queues[0], commandPools[0], fencePool.get());
+      for(uint32_t run = 0; run < a_config.runs; ++run)
+        supersampleMs += supersampler.Run(&edgePixels);
+    }
+    supersampleMs /= a_config.runs;
+
+    const size_t pixels = size_t(a_kernel.width) * a_kernel.height;
+    std::cout << "edge supersampling  " << supersampleMs << " milliseconds, " << grid << "x" << grid << " samples for " << edgePixels
+              << " edge pixels (" << 100.0 * edgePixels / double(pixels) << "% of the image, threshold " << a_config.edgeThreshold << ")" << std::endl;
+    std::cout << "  extra samples     " << size_t(edgePixels) * grid * grid << " against " << pixels * grid * grid
+              << " for uniform supersampling" << std::endl;
+
+    if(a_config.validate)
+    {
+      copyToStaging(a_stagingBuf, a_kernel.ImageBytes());
+      if(CountEdgePixels(a_stagingMapped, a_kernel, a_config.edgeThreshold) != edgePixels)
+        RUN_TIME_ERROR("the GPU edge list does not match the host edge detection on the counts");
+      std::cout << "  edge pixels match the host edge detection on the counts" << std::endl;
+    }
+    return supersampleMs;
+  }
+
+  // Everything the colorize pass needs besides the fractal buffer: its pipeline specialized for a_kernel, the color
+  // buffer and the palette, whose cdf is filled from a_pStats when the palette is equalized.
+  void createColorizeResources(const AppConfig& a_config, const KernelParams& a_kernel, const RenderStats* a_pStats,
+                               size_t a_colorBytes, const std::vector<uint32_t>& a_queueFamilyIndices)
+  {
+    createBuffer(device, physicalDevice, a_colorBytes, &colorBuffer, &colorMemory, a_queueFamilyIndices);
+
+    PaletteUniforms palette = MakePalette(a_config.palette);
+    if(a_pStats != nullptr)
+    {
+      palette.equalize = 1;
+      MakeEqualizationCdf(*a_pStats, palette.cdf);
+    }
+    createUniformBuffer(device, physicalDevice, sizeof(PaletteUniforms), &paletteBuffer, &paletteMemory);
+    void* paletteMapped = nullptr;
+    VK_CHECK_RESULT(vkMapMemory(device, paletteMemory, 0, sizeof(PaletteUniforms), 0, &paletteMapped));
+    memcpy(paletteMapped, &palette, sizeof(PaletteUniforms));
+    vkUnmapMemory(device, paletteMemory);
+
+    const VkDescriptorType types[3] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+    const VkDescriptorBufferInfo buffers[3] = {{fractalBuffer, 0, a_kernel.ImageBytes()},
+                                               {colorBuffer,   0, a_colorBytes},
+                                               {paletteBuffer, 0, sizeof(PaletteUniforms)}};
+    createPassDescriptors(types, buffers, 3, &colorizeSetLayout, &colorizeLayout, &colorizePool, &colorizeSet);
+
+    auto createStart = std::chrono::high_resolution_clock::now();
+    createComputePipeline(device, colorizeLayout, colorizeShaderModule, pipelineCache->Handle(), a_kernel, &colorizePipeline);
+    pipelineCreationMs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - createStart).count()/1000.f;
+  }
+
+  // --stats: reduces the counts the benchmark left in the fractal buffer on the GPU a_config.runs times and prints the
+  // statistics. With --validate they are checked against the host reduction of a full readback of the counts.
+  RenderStats reduceStats(const AppConfig& a_config, const KernelParams& a_kernel, VkBuffer a_stagingBuf, const void* a_stagingMapped,
+                          const std::vector<uint32_t>& a_queueFamilyIndices)
+  {
+    createBuffer(device, physicalDevice, sizeof(RenderStatsData), &statsBuffer, &statsMemory, a_queueFamilyIndices);
+    createStagingBuffer(device, physicalDevice, sizeof(RenderStatsData), &statsReadback, &statsReadbackMemory, a_queueFamilyIndices);
+    VK_CHECK_RESULT(vkMapMemory(device, statsReadbackMemory, 0, VK_WHOLE_SIZE, 0, &statsReadbackMapped));
+
+    const VkDescriptorType types[2] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+    const VkDescriptorBufferInfo buffers[2] = {{fractalBuffer, 0, a_kernel.ImageBytes()},
+                                               {statsBuffer,   0, sizeof(RenderStatsData)}};
+    createPassDescriptors(types, buffers, 2, &histogramSetLayout, &histogramLayout, &histogramPool, &histogramSet);
+
+    auto createStart = std::chrono::high_resolution_clock::now();
+    createComputePipeline(device, histogramLayout, histogramShaderModule, pipelineCache->Handle(), a_kernel, &histogramPipeline);
+    pipelineCreationMs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - createStart).count()/1000.f;
+
+    RenderStats stats;
+    float       statsMs = 0.0f;
+    {
+      StatsReducer reducer(device, histogramPipeline, histogramLayout, histogramSet, a_kernel, statsBuffer, statsReadback,
+                           statsReadbackMapped, queues[0], commandPools[0], fencePool.get());
+      for(uint32_t run = 0; run < a_config.runs; ++run)
+        statsMs += reducer.Run(&stats);
+    }
+    statsMs /= a_config.runs;
+
+    const size_t pixels = size_t(a_kernel.width) * a_kernel.height;
+    const size_t fullest = size_t(std::max_element(stats.histogram.begin(), stats.histogram.end()) - stats.histogram.begin());
+    std::cout << "statistics pass     " << statsMs << " milliseconds, " << sizeof(RenderStatsData) << " bytes read back instead of "
+              << float(a_kernel.ImageBytes()) / (1024.0f * 1024.0f) << " MiB of counts" << std::endl;
+    std::cout << "  iterations        min " << stats.minCount << ", max " << stats.maxCount << ", mean " << stats.Mean(a_kernel) << std::endl;
+    std::cout << "  inside the set    " << stats.inSet << " of " << pixels << " pixels (" << 100.0 * stats.inSet / double(pixels) << "%)" << std::endl;
+    std::cout << "  histogram         " << HISTOGRAM_BINS << " bins, fullest bin " << fullest << " with " << stats.histogram[fullest]
+              << " pixels" << std::endl;
+
+    if(a_config.validate)
+    {
+      copyToStaging(a_stagingBuf, a_kernel.ImageBytes());
+      if(!(ComputeRenderStats(a_stagingMapped, a_kernel) == stats))
+        RUN_TIME_ERROR("the GPU statistics do not match the host reduction of the counts");
+      std::cout << "  statistics match the host reduction of the counts" << std::endl;
+    }
+    return stats;
+  }
+
+  // Set layout, pipeline layout (no push constants) and descriptor set of a pass over whole buffers: binding i is
+  // a_buffers[i] of type a_types[i].
+  void createPassDescriptors(const VkDescriptorType* a_types, const VkDescriptorBufferInfo* a_buffers, uint32_t a_count,
+                             VkDescriptorSetLayout* a_pSetLayout, VkPipelineLayout* a_pLayout, VkDescriptorPool* a_pPool,
+                             VkDescriptorSet* a_pSet)
+  {
+    std::vector<VkDescriptorSetLayoutBinding> bindings(a_count);
+    std::vector<VkDescriptorPoolSize>         poolSizes(a_count);
+    std::vector<VkWriteDescriptorSet>         writes(a_count);
+    for(uint32_t i = 0; i < a_count; ++i)
+    {
+      bindings[i] = {};
+      bindings[i].binding         = i;
+      bindings[i].descriptorType  = a_types[i];
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+      poolSizes[i].type            = a_types[i];
+      poolSizes[i].descriptorCount = 1;
+    }
+
+    VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+    setLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutCreateInfo.bindingCount = a_count;
+    setLayoutCreateInfo.pBindings    = bindings.data();
+    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr, a_pSetLayout));
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+    pipelineLayoutCreateInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts    = a_pSetLayout;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, a_pLayout));
+
+    VkDescriptorPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCreateInfo.maxSets       = 1;
+    poolCreateInfo.poolSizeCount = a_count;
+    poolCreateInfo.pPoolSizes    = poolSizes.data();
+    VK_CHECK_RESULT(vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, a_pPool));
+
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool     = *a_pPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts        = a_pSetLayout;
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocateInfo, a_pSet));
+
+    for(uint32_t i = 0; i < a_count; ++i)
+    {
+      writes[i] = {};
+      writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet          = *a_pSet;
+      writes[i].dstBinding      = i;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType  = a_types[i];
+      writes[i].pBufferInfo     = &a_buffers[i];
+    }
+    vkUpdateDescriptorSets(device, a_count, writes.data(), 0, nullptr);
+  }
+
+  // --tile-cache: renders a_config.runs frames through the tile cache, the view moving a_config.panPixels to the right
+  // every frame and ending on renderParams, which run() snapped to the pixel grid. The tiles sit on that grid
+  // (MakeGridTiles) and the kernel is specialized with KERNEL_FEATURE_TILE_ORIGIN, so a tile's pixels follow from its
+  // key alone. Only the tiles the cache misses are dispatched (static schedule over all queues). Cached tiles are
+  // written into staging by the host and uploaded into the fractal buffer in the same submission that reads the new
+  // tiles back for the cache, so both buffers hold the frame. Returns the average frame time in ms.
+  float renderCached(const AppConfig& a_config, const KernelParams& a_kernel, VkBuffer a_stagingBuf, void* a_stagingMapped,
+                     float a_uncachedMs)
+  {
+    TileCache cache(size_t(a_config.tileCacheMiB) << 20, a_config.tileCacheDir);
+
+    KernelParams tileKernel = a_kernel;
+    tileKernel.features |= KERNEL_FEATURE_TILE_ORIGIN;
+    const VkPipeline pipeline = a_config.marianiSilver ? getMarianiPipeline(tileKernel) : getPipeline(tileKernel);
+    const uint32_t   nQueues  = uint32_t(queues.size());
+    const size_t     bpp      = a_kernel.BytesPerPixel();
+    uint8_t*         staged   = static_cast<uint8_t*>(a_stagingMapped);
+
+    auto renderTiles = [&](const std::vector<TileRect>& a_tiles)
+    {
+      plan.reset();
+      plan = std::make_unique<RenderPlan>(device, pipeline, pipelineLayout, descriptorSet, a_kernel.workgroupSize, fencePool.get());
+      plan->SetWorkgroupPerTile(a_config.marianiSilver);
+      for(size_t i = 0; i < queues.size(); ++i)
+        plan->AddQueue(queues[i], queueSlots[i].family, commandPools[i]);
+      for(size_t i = 0; i < a_tiles.size(); ++i)
+        plan->AddTile(i % nQueues, a_tiles[i]);
+      plan->Record(a_config.tilesPerCmd);
+      plan->Replay(SUBMIT_ITERS, multithreadedSubmit);
+    };
+
+    // the kernel reads only the scale of the view, the tiles carry their position
+    updateRenderParams(renderParams);
+    int64_t cornerX, cornerY;
+    GridCorner(renderParams, a_kernel, &cornerX, &cornerY);
+
+    std::cout << "cached frames      ... " << std::endl;
+    float  frameMs = 0.0f, lookupMs = 0.0f, renderMs = 0.0f, exchangeMs = 0.0f, insertMs = 0.0f;
+    size_t renderedTiles = 0;
+    std::vector<uint8_t> tileData;
+    for(uint32_t run = 0; run < a_config.runs; ++run)
+    {
+      const int64_t panX = (int64_t(run) - int64_t(a_config.runs - 1)) * a_config.panPixels;
+
       auto start = std::chrono::high_resolution_clock::now();
 
-      std::vector<VkFence> fences(2);
-      VkFenceCreateInfo fenceCreateInfo = {};
-      fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-      fenceCreateInfo.flags = 0;
-      VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fences[0]));
-      VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fences[1]));
-
-  #ifdef MULTITHREADED_SUBMIT
-      auto work = [](VkDevice d, VkQueue &q, VkFence fence, std::vector<VkCommandBuffer> &cmds, size_t nIters){
-        std::cout << "thread " << std::this_thread::get_id() << " : using queue " << q << std::endl;
-        auto perIter = cmds.size() / nIters;
-        for(size_t i = 0; i < nIters; ++i)
+      std::vector<TileRect> hits, misses;
+      std::vector<uint64_t> missKeys;
+      for(const TileRect& tile : MakeGridTiles(a_kernel, renderParams.scale, cornerX + panX, cornerY))
+      {
+        const uint64_t key = TileCacheKey(tileKernelHash, tileKernel, renderParams.scale, tile);
+        if(const std::vector<uint8_t>* data = cache.Find(key))
         {
-          VkSubmitInfo submitInfo = {};
-          submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-          submitInfo.commandBufferCount = perIter;
-          submitInfo.pCommandBuffers = cmds.data() + i * perIter;
-          VK_CHECK_RESULT(vkQueueSubmit(q, 1, &submitInfo, fence));
-          VK_CHECK_RESULT(vkWaitForFences(d, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
-          vkResetFences(d, 1, &fence);
+          for(uint32_t y = 0; y < tile.sizeY; ++y)
+            memcpy(staged + ((size_t(tile.offsetY) + y) * a_kernel.width + tile.offsetX) * bpp, data->data() + y * tile.sizeX * bpp, tile.sizeX * bpp);
+          hits.push_back(tile);
         }
+        else
+        {
+          misses.push_back(tile);
+          missKeys.push_back(key);
+        }
+      }
+      auto lookupEnd = std::chrono::high_resolution_clock::now();
+
+      if(!misses.empty())
+        renderTiles(misses);
+      auto renderEnd = std::chrono::high_resolution_clock::now();
+
+      exchangeTiles(a_stagingBuf, a_kernel, hits, misses);
+      auto exchangeEnd = std::chrono::high_resolution_clock::now();
+
+      for(size_t i = 0; i < misses.size(); ++i)
+      {
+        const TileRect& tile = misses[i];
+        tileData.resize(size_t(tile.sizeX) * tile.sizeY * bpp);
+        for(uint32_t y = 0; y < tile.sizeY; ++y)
+          memcpy(tileData.data() + y * tile.sizeX * bpp, staged + ((size_t(tile.offsetY) + y) * a_kernel.width + tile.offsetX) * bpp, tile.sizeX * bpp);
+        cache.Insert(missKeys[i], tileData.data(), tileData.size());
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+
+      renderedTiles += misses.size();
+      lookupMs   += std::chrono::duration_cast<std::chrono::microseconds>(lookupEnd - start).count()/1000.f;
+      renderMs   += std::chrono::duration_cast<std::chrono::microseconds>(renderEnd - lookupEnd).count()/1000.f;
+      exchangeMs += std::chrono::duration_cast<std::chrono::microseconds>(exchangeEnd - renderEnd).count()/1000.f;
+      insertMs   += std::chrono::duration_cast<std::chrono::microseconds>(end - exchangeEnd).count()/1000.f;
+      frameMs    += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()/1000.f;
+    }
+
+    const TileCache::Stats& stats   = cache.GetStats();
+    const size_t            lookups = std::max<size_t>(stats.memoryHits + stats.diskHits + stats.misses, 1);
+    const uint32_t          runs    = a_config.runs;
+    std::cout << "tile cache          " << a_config.tileCacheMiB << " MiB in memory";
+    if(!a_config.tileCacheDir.empty())
+      std::cout << ", tiles also kept in " << a_config.tileCacheDir;
+    std::cout << std::endl;
+    std::cout << "  frames            " << runs << ", view moved " << a_config.panPixels << " pixels per frame" << std::endl;
+    std::cout << "  lookups           " << stats.memoryHits << " memory hits, " << stats.diskHits << " disk hits, " << stats.misses
+              << " misses (hit rate " << 100.0 * double(stats.memoryHits + stats.diskHits) / double(lookups) << "%)" << std::endl;
+    std::cout << "  average frame     " << frameMs / runs << " milliseconds against " << a_uncachedMs << " uncached (lookup "
+              << lookupMs / runs << ", render of " << renderedTiles / runs << " missing tiles " << renderMs / runs << ", upload and readback "
+              << exchangeMs / runs << ", insert " << insertMs / runs << ")" << std::endl;
+    std::cout << "  time saved        " << a_uncachedMs * runs - frameMs << " milliseconds over " << runs << " frames" << std::endl;
+    std::cout << "  memory tier       " << cache.MemoryTiles() << " tiles, " << float(cache.MemoryBytes()) / (1024.0f * 1024.0f)
+              << " MiB, " << stats.evictions << " evictions" << std::endl;
+    return frameMs / runs;
+  }
+
+  // --progressive: renders the frame a_config.runs times in passes of sample stride PROGRESSIVE_STRIDE down to 1 and
+  // reports when every pass reached the host against the single-pass replay time a_singlePassMs. The passes of the
+  // last run are written as mandelbrot_pass<N>.bmp as they arrive, and its final pass is compared with the
+  // single-pass image, which it replaces in the fractal buffer.
+  void renderProgressive(const AppConfig& a_config, const KernelParams& a_kernel, VkBuffer a_stagingBuf, const void* a_stagingMapped,
+                         float a_singlePassMs)
+  {
+    const size_t imageBytes = a_kernel.ImageBytes();
+    copyToStaging(a_stagingBuf, imageBytes);
+    const std::vector<uint8_t> reference(static_cast<const uint8_t*>(a_stagingMapped),
+                                         static_cast<const uint8_t*>(a_stagingMapped) + imageBytes);
+
+    updateRenderParams(renderParams);
+
+    ProgressiveRenderer progressive(device, getProgressivePipeline(a_kernel), pipelineLayout, descriptorSet, a_kernel,
+                                    fractalBuffer, a_stagingBuf, a_stagingMapped, PROGRESSIVE_STRIDE, fencePool.get());
+    for(size_t i = 0; i < queues.size(); ++i)
+      progressive.AddQueue(queues[i], commandPools[i]);
+    progressive.Record();
+
+    const SimdPath simd     = DetectSimdPath(a_config.simdLimit);
+    const size_t   fileSize = BMPFileSize(int(a_kernel.width), int(a_kernel.height));
+
+    std::vector<ProgressivePass> total(progressive.PassesNum());
+    for(uint32_t run = 0; run < a_config.runs; ++run)
+    {
+      const bool last = (run + 1 == a_config.runs);
+      auto deliver = [&](uint32_t a_pass, uint32_t, const void* a_staging)
+      {
+        if(!last)
+          return;
+        const std::string fileName = "mandelbrot_pass" + std::to_string(a_pass) + ".bmp";
+        MappedFile file(fileName.c_str(), fileSize);
+        WriteBMPHeader(file.Data(), int(a_kernel.width), int(a_kernel.height));
+        ConvertToBMPPixels(a_staging, a_kernel, file.Data() + BMP_HEADER_SIZE, a_config.readbackThreads, simd);
+        file.Close();
       };
-      std::vector<std::thread> workers(2);
-      workers[0] = std::move(std::thread(work, device, std::ref(queue1), fences[0], std::ref(cmds1), SUBMIT_ITERS));
-      workers[1] = std::move(std::thread(work, device, std::ref(queue2), fences[1], std::ref(cmds2), SUBMIT_ITERS));
 
-      for(size_t i = 0; i < 2; ++i)
+      const std::vector<ProgressivePass> passes = progressive.Run(deliver);
+      for(size_t i = 0; i < passes.size(); ++i)
       {
-        if(workers[i].joinable())
-          workers[i].join();
+        total[i].stride       = passes[i].stride;
+        total[i].samples      = passes[i].samples;
+        total[i].readyMs     += passes[i].readyMs;
+        total[i].deliveredMs += passes[i].deliveredMs;
       }
-  #else
-      auto perIter = cmds1.size() / SUBMIT_ITERS;
-      for (size_t i = 0; i < SUBMIT_ITERS; ++i)
+    }
+
+    const size_t bpp     = a_kernel.BytesPerPixel();
+    const size_t pixels  = size_t(a_kernel.width) * a_kernel.height;
+    const uint8_t* image  = static_cast<const uint8_t*>(a_stagingMapped);
+    size_t differing = 0;
+    for(size_t i = 0; i < pixels; ++i)
+      differing += (memcmp(image + i * bpp, reference.data() + i * bpp, bpp) != 0) ? 1 : 0;
+
+    const uint32_t runs = a_config.runs;
+    std::cout << "progressive passes  (average of " << runs << " runs, files of the last run written while the next pass computes)" << std::endl;
+    for(size_t i = 0; i < total.size(); ++i)
+    {
+      std::cout << "  stride " << total[i].stride << "          " << total[i].samples << " samples, in staging at "
+                << total[i].readyMs / runs << " ms, delivered at " << total[i].deliveredMs / runs << " ms" << std::endl;
+    }
+    const float finalMs = total.back().readyMs / runs;
+    std::cout << "  time to first     " << total.front().readyMs / runs << " milliseconds against " << a_singlePassMs
+              << " for the single-pass replay" << std::endl;
+    std::cout << "  overhead          " << finalMs - a_singlePassMs << " milliseconds to the full image ("
+              << progressive.PassesNum() << " copies to staging and host deliveries included)" << std::endl;
+    std::cout << "  final pass        " << differing << " of " << pixels << " pixels differ from the single-pass image" << std::endl;
+  }
+
+  // One submission on the first queue that makes the fractal buffer and staging (both laid out like the image) agree:
+  // the rows of a_uploads go from staging into the fractal buffer, those of a_downloads the other way.
+  void exchangeTiles(VkBuffer a_stagingBuf, const KernelParams& a_kernel, const std::vector<TileRect>& a_uploads,
+                     const std::vector<TileRect>& a_downloads)
+  {
+    const VkDeviceSize bpp = a_kernel.BytesPerPixel();
+    auto tileRows = [&](const std::vector<TileRect>& a_tiles)
+    {
+      std::vector<VkBufferCopy> regions;
+      for(const auto& tile : a_tiles)
       {
+        for(uint32_t y = tile.offsetY; y < tile.offsetY + tile.sizeY; ++y)
         {
-          VkSubmitInfo submitInfo = {};
-          submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-          submitInfo.commandBufferCount = perIter;
-          submitInfo.pCommandBuffers = cmds1.data() + i * perIter;
-          VK_CHECK_RESULT(vkQueueSubmit(queue1, 1, &submitInfo, fences[0]));
-        }
-        {
-          VkSubmitInfo submitInfo = {};
-          submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-          submitInfo.commandBufferCount = perIter;
-          submitInfo.pCommandBuffers = cmds2.data() + i * perIter;
-          VK_CHECK_RESULT(vkQueueSubmit(queue2, 1, &submitInfo, fences[1]));
+          const VkDeviceSize offset = (VkDeviceSize(y) * a_kernel.width + tile.offsetX) * bpp;
+          regions.push_back({offset, offset, tile.sizeX * bpp});
         }
+      }
+      return regions;
+    };
+    const std::vector<VkBufferCopy> uploads   = tileRows(a_uploads);
+    const std::vector<VkBufferCopy> downloads = tileRows(a_downloads);
+
+    VkCommandBuffer copyBuf;
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = commandPools[0];
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &copyBuf));
 
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(copyBuf, &beginInfo));
+
+    // host writes to staging are made visible by the submission itself, the render still has to be waited for
+    VkMemoryBarrier fromCompute = {};
+    fromCompute.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fromCompute.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    fromCompute.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &fromCompute, 0, nullptr, 0, nullptr);
+
+    if(!uploads.empty())
+      vkCmdCopyBuffer(copyBuf, a_stagingBuf, fractalBuffer, uint32_t(uploads.size()), uploads.data());
+    if(!downloads.empty())
+      vkCmdCopyBuffer(copyBuf, fractalBuffer, a_stagingBuf, uint32_t(downloads.size()), downloads.data());
+
+    VkMemoryBarrier toHost = {};
+    toHost.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+    VK_CHECK_RESULT(vkEndCommandBuffer(copyBuf));
+
+    VkFence fence = fencePool->Acquire();
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &copyBuf;
+    VK_CHECK_RESULT(vkQueueSubmit(queues[0], 1, &submitInfo, fence));
+    VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+    fencePool->Release(fence);
+
+    vkFreeCommandBuffers(device, commandPools[0], 1, &copyBuf);
+  }
+
+  // Copies the first a_size bytes of the fractal buffer into the staging buffer on the first queue and waits.
+  void copyToStaging(VkBuffer a_stagingBuf, VkDeviceSize a_size)
+  {
+    VkCommandBuffer copyBuf;
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = commandPools[0];
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &copyBuf));
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(copyBuf, &beginInfo));
 
-        VK_CHECK_RESULT(vkWaitForFences(device, 2, fences.data(), VK_TRUE, FENCE_TIMEOUT));
-        vkResetFences(device, 2, fences.data());
+    // the last replay waited for its fences, but its writes still have to be made available to the copy
+    VkMemoryBarrier fromCompute = {};
+    fromCompute.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fromCompute.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    fromCompute.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &fromCompute, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region0 = {};
+    region0.size = a_size;
+    vkCmdCopyBuffer(copyBuf, fractalBuffer, a_stagingBuf, 1, &region0);
+
+    VkMemoryBarrier toHost = {};
+    toHost.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0, nullptr, 0, nullptr);
+    VK_CHECK_RESULT(vkEndCommandBuffer(copyBuf));
+
+    VkFence fence = fencePool->Acquire();
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &copyBuf;
+    VK_CHECK_RESULT(vkQueueSubmit(queues[0], 1, &submitInfo, fence));
+    VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+    fencePool->Release(fence);
+
+    vkFreeCommandBuffers(device, commandPools[0], 1, &copyBuf);
+  }
+
+  static std::vector<TileRect> makeFrameTiles(const KernelParams& a_kernel)
+  {
+    std::vector<TileRect> tiles;
+    for(uint32_t i = 0; i < a_kernel.TilesY(); ++i)
+    {
+      for(uint32_t j = 0; j < a_kernel.TilesX(); ++j)
+      {
+        TileRect tile = {a_kernel.tileX * j, a_kernel.tileY * i, std::min(a_kernel.tileX, a_kernel.width  - a_kernel.tileX * j),
+                         std::min(a_kernel.tileY, a_kernel.height - a_kernel.tileY * i), i * a_kernel.TilesX() + j};
+        tiles.push_back(tile);
       }
+    }
+    return tiles;
+  }
+
+  static double megapixelsPerSecond(const KernelParams& a_kernel, float a_ms)
+  {
+    return double(a_kernel.width) * a_kernel.height / 1e6 * 1000.0 / std::max(double(a_ms), 0.001);
+  }
 
-  #endif
+  // Renders and saves the image with band readback overlapping compute, a_config.runs times, and prints the
+  // end-to-end latency (first submit to the file on disk).
+  void pipelinedRender(const AppConfig& a_config, const KernelParams& a_kernel, VkBuffer a_stagingBuf,
+                       const void* a_stagingMapped, uint32_t a_transferFamily)
+  {
+    PipelinedReadback pipelined(device, getPipeline(a_kernel), pipelineLayout, descriptorSet, a_kernel, fencePool.get());
+    for(size_t i = 0; i < queues.size(); ++i)
+      pipelined.AddComputeQueue(queues[i], commandPools[i]);
 
+    // without a transfer-only family the copies go to the last compute queue, between its own bands
+    if(transferQueue != VK_NULL_HANDLE)
+      pipelined.SetTransferQueue(transferQueue, transferPool);
+    else
+      pipelined.SetTransferQueue(queues.back(), commandPools.back());
 
-      vkDestroyFence(device, fences[0], nullptr);
-      vkDestroyFence(device, fences[1], nullptr);
+    pipelined.Record(fractalBuffer, a_stagingBuf);
 
-      vkFreeCommandBuffers(device, commandPool1, cmds1.size(), cmds1.data());
-      vkFreeCommandBuffers(device, commandPool2, cmds2.size(), cmds2.data());
+    const SimdPath simd = DetectSimdPath(a_config.simdLimit);
+    PipelinedStats total;
+    for(uint32_t run = 0; run < a_config.runs; ++run)
+    {
+      updateRenderParams(renderParams);
+      const PipelinedStats stats = pipelined.Run(a_stagingMapped, "mandelbrot.bmp", a_config.readbackThreads, simd);
+      total.endToEndMs += stats.endToEndMs;
+      total.gpuWaitMs  += stats.gpuWaitMs;
+      total.convertMs  += stats.convertMs;
+      total.writeMs    += stats.writeMs;
+    }
 
-      auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "pipelined readback, " << pipelined.BandsNum() << " bands, copies on ";
+    if(transferQueue != VK_NULL_HANDLE)
+      std::cout << "transfer family " << a_transferFamily << std::endl;
+    else
+      std::cout << "the last compute queue (no transfer-only family)" << std::endl;
+    std::cout << "  end-to-end        " << total.endToEndMs / a_config.runs << " milliseconds (average of " << a_config.runs << " runs)" << std::endl;
+    std::cout << "  host waiting      " << total.gpuWaitMs / a_config.runs << " milliseconds" << std::endl;
+    std::cout << "  host conversion   " << total.convertMs / a_config.runs << " milliseconds" << std::endl;
+    std::cout << "  file write        " << total.writeMs / a_config.runs << " milliseconds" << std::endl;
+  }
 
-      float ms_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()/1000.f;
+  // Renders the image in bands of a_config.streamRows rows through a ring of a_config.ringSize band buffers and
+  // appends every finished band to the file, so memory use depends on the band size only.
+  void streamToFile(const AppConfig& a_config, const std::vector<uint32_t>& a_queueFamilyIndices)
+  {
+    const KernelParams& kernel = a_config.kernel;
 
-      average_time += ms_elapsed;
+    // whole tiles per band, so no tile crosses a band boundary
+    const uint32_t bandRows  = std::min(((a_config.streamRows + kernel.tileY - 1) / kernel.tileY) * kernel.tileY,
+                                        kernel.TilesY() * kernel.tileY);
+    const size_t   bandBytes = BandStreamer::BandBytes(kernel, bandRows);
+
+    struct RingSlot
+    {
+      VkBuffer         buffer;
+      VkDeviceMemory   memory;
+      VkBuffer         staging;
+      VkDeviceMemory   stagingMemory;
+      void*            stagingMapped;
+      VkDescriptorPool descriptorPool;
+      VkDescriptorSet  descriptorSet;
+    };
+
+    std::vector<RingSlot> ring(a_config.ringSize);
+    for(auto& slot : ring)
+    {
+      createBuffer(device, physicalDevice, bandBytes, &slot.buffer, &slot.memory, a_queueFamilyIndices);
+      createStagingBuffer(device, physicalDevice, bandBytes, &slot.staging, &slot.stagingMemory, a_queueFamilyIndices);
+      VK_CHECK_RESULT(vkMapMemory(device, slot.stagingMemory, 0, VK_WHOLE_SIZE, 0, &slot.stagingMapped));
+      createDescriptorSetForOurBuffer(device, slot.buffer, bandBytes, paramsBuffer, VK_NULL_HANDLE, VK_NULL_HANDLE, &descriptorSetLayout,
+                                      &slot.descriptorPool, &slot.descriptorSet);
     }
 
-    std::cout << "average computation time " << average_time / N_RUNS << " milliseconds" << std::endl;
+    updateRenderParams(renderParams);
 
-    std::cout << "saving image       ... " << std::endl;
-    saveRenderedImageFromDeviceMemory(device, fractalBuffer, stagingBuf, stagingMem, commandPool1, queue1, 0, WIDTH, HEIGHT);
-    std::cout << "destroying all     ... " << std::endl;
+    StreamStats stats;
+    uint32_t    bandsNum = 0;
+    {
+      BandStreamer streamer(device, getPipeline(kernel), pipelineLayout, kernel, bandRows, fencePool.get());
+      for(size_t i = 0; i < queues.size(); ++i)
+        streamer.AddQueue(queues[i], commandPools[i]);
+      for(const auto& slot : ring)
+        streamer.AddSlot({slot.buffer, slot.descriptorSet, slot.staging, slot.stagingMapped});
+
+      std::cout << "streaming " << kernel.width << "x" << kernel.height << " in bands of " << bandRows << " rows ... " << std::endl;
+      stats    = streamer.Run("mandelbrot.bmp", a_config.readbackThreads, DetectSimdPath(a_config.simdLimit));
+      bandsNum = streamer.BandsNum();
+    }
 
-    vkDestroyBuffer(device, stagingBuf, nullptr);
-    vkFreeMemory(device, stagingMem, nullptr);
-    cleanup();
+    for(auto& slot : ring)
+    {
+      vkDestroyDescriptorPool(device, slot.descriptorPool, nullptr);
+      vkUnmapMemory(device, slot.stagingMemory);
+      vkDestroyBuffer(device, slot.staging, nullptr);
+      vkFreeMemory(device, slot.stagingMemory, nullptr);
+      vkDestroyBuffer(device, slot.buffer, nullptr);
+      vkFreeMemory(device, slot.memory, nullptr);
+    }
+
+    const double mpix = double(kernel.width) * kernel.height / 1e6;
+    std::cout << "streamed " << bandsNum << " bands through " << ring.size() << " slots of "
+              << bandBytes / 1024 << " KiB (device and staging each)" << std::endl;
+    std::cout << "  total             " << stats.totalMs << " milliseconds, " << mpix * 1000.0 / std::max(stats.totalMs, 0.001f) << " MPix/s" << std::endl;
+    std::cout << "  host waiting      " << stats.gpuWaitMs << " milliseconds" << std::endl;
+    std::cout << "  host conversion   " << stats.convertMs << " milliseconds" << std::endl;
+    std::cout << "  file write        " << stats.writeMs << " milliseconds" << std::endl;
   }
 
+  // Renders a_config.animateFrames frames of a zoom into the seahorse valley with a_config.inFlight frames in flight
+  // and writes them as frame_NNNNN.bmp; reports the sustained frame rate and the latency of a frame from its
+  // submission until its file is written.
+  void animate(const AppConfig& a_config, const std::vector<uint32_t>& a_queueFamilyIndices)
+  {
+    static constexpr float TARGET_X = -0.743643887f;
+    static constexpr float TARGET_Y =  0.131825904f;
+
+    const KernelParams& kernel = a_config.kernel;
+    const std::vector<CameraFrame> path = MakeZoomPath(renderParams, TARGET_X, TARGET_Y, a_config.animateFrames, a_config.zoomPerFrame,
+                                                       kernel.iterations, a_config.iterationsPerOctave);
+
+    // every iteration limit of the path is compiled before the first frame, so no frame waits for a pipeline
+    std::map<uint32_t, VkPipeline> pipelines;
+    for(const auto& frame : path)
+    {
+      KernelParams frameKernel = kernel;
+      frameKernel.iterations   = frame.iterations;
+      pipelines[frame.iterations] = getPipeline(frameKernel);
+    }
+
+    struct FrameSlot
+    {
+      VkBuffer         buffer;
+      VkDeviceMemory   memory;
+      VkBuffer         params;
+      VkDeviceMemory   paramsMemory;
+      void*            paramsMapped;
+      VkBuffer         staging;
+      VkDeviceMemory   stagingMemory;
+      void*            stagingMapped;
+      VkDescriptorPool descriptorPool;
+      VkDescriptorSet  descriptorSet;
+    };
+
+    const size_t bufferSize = kernel.ImageBytes();
+
+    std::vector<FrameSlot> slots(a_config.inFlight);
+    for(auto& slot : slots)
+    {
+      createBuffer(device, physicalDevice, bufferSize, &slot.buffer, &slot.memory, a_queueFamilyIndices);
+      createUniformBuffer(device, physicalDevice, sizeof(RenderParams), &slot.params, &slot.paramsMemory);
+      VK_CHECK_RESULT(vkMapMemory(device, slot.paramsMemory, 0, sizeof(RenderParams), 0, &slot.paramsMapped));
+      createStagingBuffer(device, physicalDevice, bufferSize, &slot.staging, &slot.stagingMemory, a_queueFamilyIndices);
+      VK_CHECK_RESULT(vkMapMemory(device, slot.stagingMemory, 0, VK_WHOLE_SIZE, 0, &slot.stagingMapped));
+      createDescriptorSetForOurBuffer(device, slot.buffer, bufferSize, slot.params, VK_NULL_HANDLE, VK_NULL_HANDLE, &descriptorSetLayout,
+                                      &slot.descriptorPool, &slot.descriptorSet);
+    }
 
-  static void saveRenderedImageFromDeviceMemory(VkDevice a_device, VkBuffer a_srcBuf,
-                                                VkBuffer a_stagingBuf, VkDeviceMemory a_stagingBufferMemory,
-                                                VkCommandPool a_cmdPool, VkQueue a_queue,
-                                                size_t a_offset, int a_width, int a_height)
+    AnimationStats stats;
+    {
+      AnimationRenderer renderer(device, pipelineLayout, kernel, fencePool.get());
+      for(size_t i = 0; i < queues.size(); ++i)
+        renderer.AddQueue(queues[i], commandPools[i]);
+      for(const auto& slot : slots)
+        renderer.AddSlot({slot.buffer, slot.descriptorSet, slot.paramsMapped, slot.staging, slot.stagingMapped});
+
+      std::cout << "animating " << path.size() << " frames of " << kernel.width << "x" << kernel.height << ", zoom "
+                << a_config.zoomPerFrame << " per frame, iterations " << path.front().iterations << " to "
+                << path.back().iterations << " ... " << std::endl;
+      stats = renderer.Run(path, pipelines, "frame_%05u.bmp", a_config.readbackThreads, DetectSimdPath(a_config.simdLimit));
+    }
+
+    for(auto& slot : slots)
+    {
+      vkDestroyDescriptorPool(device, slot.descriptorPool, nullptr);
+      vkUnmapMemory(device, slot.stagingMemory);
+      vkDestroyBuffer(device, slot.staging, nullptr);
+      vkFreeMemory(device, slot.stagingMemory, nullptr);
+      vkUnmapMemory(device, slot.paramsMemory);
+      vkDestroyBuffer(device, slot.params, nullptr);
+      vkFreeMemory(device, slot.paramsMemory, nullptr);
+      vkDestroyBuffer(device, slot.buffer, nullptr);
+      vkFreeMemory(device, slot.memory, nullptr);
+    }
+
+    std::cout << "animated " << stats.frames << " frames with " << slots.size() << " in flight on " << queues.size()
+              << " queue(s), final scale " << path.back().params.scale << std::endl;
+    std::cout << "  total             " << stats.totalMs << " milliseconds, " << stats.Fps() << " frames/s sustained" << std::endl;
+    std::cout << "  frame latency     p50 " << stats.LatencyPercentile(50.0f) << ", p90 " << stats.LatencyPercentile(90.0f)
+              << ", p99 " << stats.LatencyPercentile(99.0f) << " milliseconds (submission to file written)" << std::endl;
+    std::cout << "  encoder waiting   " << stats.gpuWaitMs << " milliseconds" << std::endl;
+    std::cout << "  encoder convert   " << stats.encodeMs << " milliseconds" << std::endl;
+    std::cout << "  file write        " << stats.writeMs << " milliseconds" << std::endl;
+  }
+
+  static std::string tileShaderPath(const AppConfig& a_config, Precision a_mode)
   {
-    std::vector<unsigned char> image;
-    image.reserve(a_width * a_height * 4);
+    switch(a_mode)
+    {
+      case Precision::FLOAT_FLOAT:  return a_config.floatFloatShaderPath;
+      case Precision::DOUBLE:       return a_config.fp64ShaderPath;
+      case Precision::PERTURBATION: return a_config.perturbationShaderPath;
+      default:                      return a_config.optimizedKernel ? a_config.optimizedShaderPath : a_config.shaderPath;
+    }
+  }
+
+  // Replaces the tile kernel by the one of a_mode; its pipeline variants are compiled again on first use.
+  void useTileKernel(const AppConfig& a_config, Precision a_mode)
+  {
+    plan.reset(); // its command buffers bind the pipelines destroyed here
+    for(auto& variant : pipelineVariants)
+      vkDestroyPipeline(device, variant.second, nullptr);
+    pipelineVariants.clear();
+
+    vkDestroyShaderModule(device, computeShaderModule, nullptr);
+    createShaderModule(device, tileShaderPath(a_config, a_mode).c_str(),
+                       (a_config.optimizedKernel && a_mode == Precision::FLOAT) ? OPTIMIZED_INTERFACE : TILE_KERNEL_INTERFACE,
+                       &computeShaderModule, &tileKernelHash);
+    precision = a_mode;
+  }
+
+  void reportPrecision(const AppConfig& a_config) const
+  {
+    const uint32_t needed = RequiredMantissaBits(a_config.view, a_config.kernel);
+    std::cout << "precision          " << PrecisionName(precision) << ", " << needed << " significand bits needed at this view" << std::endl;
+    if(!PrecisionAccurate(precision, a_config.view, a_config.kernel))
+      std::cout << "  " << PrecisionName(precision) << " does not resolve the pixels of this view, --precision auto picks a mode that does"
+                << std::endl;
+  }
 
+  // --precision auto: benchmarks every mode the device runs at the configured view, reports its cost against the float
+  // kernel and keeps the fastest mode that resolves the pixels. There is no fixed ranking because the cost of doubles
+  // ranges from about that of floats on compute GPUs to 1/64 of it on consumer ones.
+  Precision selectPrecision(const AppConfig& a_config, bool a_fp64Supported)
+  {
+    static const Precision modes[] = {Precision::FLOAT, Precision::FLOAT_FLOAT, Precision::DOUBLE, Precision::PERTURBATION};
+
+    const uint32_t needed = RequiredMantissaBits(a_config.view, a_config.kernel);
+    std::cout << "benchmarking precision modes (" << needed << " significand bits needed at this view) ... " << std::endl;
+    std::cout << "  mode          bits  accurate  replay ms  MPix/s  cost" << std::endl;
+
+    Precision best     = Precision::AUTO;
+    float     bestTime = -1.0f;
+    float     floatTime = 0.0f;
+    for(Precision mode : modes)
+    {
+      if(mode == Precision::DOUBLE && !a_fp64Supported)
+      {
+        std::cout << "  double        the device has no shaderFloat64" << std::endl;
+        continue;
+      }
+
+      useTileKernel(a_config, mode);
+      const float ms = benchmark(a_config, a_config.kernel, false);
+      if(mode == Precision::FLOAT)
+        floatTime = ms;
+
+      const bool accurate = PrecisionAccurate(mode, a_config.view, a_config.kernel);
+      std::cout << "  " << PrecisionName(mode) << std::string(14 - std::strlen(PrecisionName(mode)), ' ')
+                << PrecisionMantissaBits(mode) << "\t" << (accurate ? "yes" : "no") << "\t  " << ms << "\t     "
+                << megapixelsPerSecond(a_config.kernel, ms) << "\t" << ms / floatTime << "x" << std::endl;
+      if(accurate && (bestTime < 0.0f || ms < bestTime))
+      {
+        bestTime = ms;
+        best     = mode;
+      }
+    }
+
+    if(best == Precision::AUTO)
+      throw std::runtime_error("no precision mode resolves the pixels of this view, zoom out or render fewer pixels");
+
+    useTileKernel(a_config, best);
+    std::cout << "fastest accurate: " << PrecisionName(best) << " (" << bestTime << " ms)" << std::endl;
+    return best;
+  }
+
+  // Benchmarks tile and workgroup sizes supported by the device for the configured image and returns the fastest set.
+  KernelParams sweepKernelParams(const AppConfig& a_config)
+  {
+    static const uint32_t tileSizes[]      = {32, 64, 128, 256};
+    static const uint32_t workgroupSizes[] = {4, 8, 16, 32};
+
+    std::cout << "sweeping tile and workgroup sizes ... " << std::endl;
+    std::cout << "  tile  workgroup  replay ms" << std::endl;
+
+    KernelParams best     = a_config.kernel;
+    float        bestTime = -1.0f;
+    for(uint32_t tile : tileSizes)
+    {
+      for(uint32_t wg : workgroupSizes)
+      {
+        if(wg > tile)
+          continue;
+
+        KernelParams params = a_config.kernel;
+        params.tileX = params.tileY = tile;
+        params.workgroupSize = wg;
+        if(!workgroupSupported(params.workgroupSize))
+          continue;
+
+        const float ms = benchmark(a_config, params, false);
+        std::cout << "  " << tile << "\t" << wg << "\t   " << ms << std::endl;
+        if(bestTime < 0.0f || ms < bestTime)
+        {
+          bestTime = ms;
+          best     = params;
+        }
+      }
+    }
+
+    std::cout << "fastest: tile " << best.tileX << ", workgroup " << best.workgroupSize << " (" << bestTime << " ms)" << std::endl;
+    return best;
+  }
+
+  bool workgroupSupported(uint32_t a_size) const
+  {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    return a_size * a_size <= props.limits.maxComputeWorkGroupInvocations &&
+           a_size <= props.limits.maxComputeWorkGroupSize[0] && a_size <= props.limits.maxComputeWorkGroupSize[1];
+  }
+
+  // Pipelines are specialized per KernelParams and kept until cleanup, so a sweep compiles every variant once.
+  VkPipeline getPipeline(const KernelParams& a_kernel)
+  {
+    return getPipelineVariant(pipelineVariants, computeShaderModule, a_kernel);
+  }
+
+  VkPipeline getPersistentPipeline(const KernelParams& a_kernel)
+  {
+    return getPipelineVariant(persistentVariants, persistentShaderModule, a_kernel);
+  }
+
+  VkPipeline getMarianiPipeline(const KernelParams& a_kernel)
+  {
+    return getPipelineVariant(marianiVariants, marianiShaderModule, a_kernel);
+  }
+
+  VkPipeline getProgressivePipeline(const KernelParams& a_kernel)
+  {
+    return getPipelineVariant(progressiveVariants, progressiveShaderModule, a_kernel);
+  }
+
+  VkPipeline getPipelineVariant(std::map<KernelParams, VkPipeline>& a_variants, VkShaderModule a_module, const KernelParams& a_kernel)
+  {
+    auto it = a_variants.find(a_kernel);
+    if(it != a_variants.end())
+      return it->second;
+
+    if(!workgroupSupported(a_kernel.workgroupSize))
+      RUN_TIME_ERROR("workgroup size is not supported by the device");
+
+    auto createStart = std::chrono::high_resolution_clock::now();
+    VkPipeline pipeline;
+    createComputePipeline(device, pipelineLayout, a_module, pipelineCache->Handle(), a_kernel, &pipeline);
+    auto createEnd = std::chrono::high_resolution_clock::now();
+    pipelineCreationMs += std::chrono::duration_cast<std::chrono::microseconds>(createEnd - createStart).count()/1000.f;
+    a_variants[a_kernel] = pipeline;
+    return pipeline;
+  }
+
+  // Workgroups of the persistent schedule: PERSISTENT_INVOCATIONS of them unless --persistent-groups says otherwise,
+  // never more than there are tiles (the surplus would only find the queue empty).
+  uint32_t persistentWorkgroups(const AppConfig& a_config, const KernelParams& a_kernel) const
+  {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+    uint32_t groups = a_config.persistentGroups;
+    if(groups == 0)
+      groups = std::max(PERSISTENT_INVOCATIONS / (a_kernel.workgroupSize * a_kernel.workgroupSize), 1u);
+    groups = std::min(groups, a_kernel.TilesX() * a_kernel.TilesY());
+    return std::min(groups, props.limits.maxComputeWorkGroupCount[0]);
+  }
+
+  void updateRenderParams(const RenderParams& a_params)
+  {
+    // memory is host coherent and no submission is in flight here
+    memcpy(paramsMapped, &a_params, sizeof(RenderParams));
+  }
+
+
+  // Copies the fractal buffer into the (persistently mapped) staging buffer and converts it straight into the
+  // memory-mapped BMP file. Both steps are repeated a_config.runs times and timed apart from the compute benchmark.
+  static void readbackAndSave(VkDevice a_device, VkBuffer a_srcBuf, VkBuffer a_stagingBuf, const void* a_stagingMapped,
+                              VkCommandPool a_cmdPool, VkQueue a_queue, vk_utils::FencePool* a_pFences,
+                              const KernelParams& a_kernel, const AppConfig& a_config, float a_computeTime)
+  {
     VkCommandBuffer copyBuf;
     VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
     commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -261,14 +1696,35 @@ public:
 
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     vkBeginCommandBuffer(copyBuf, &beginInfo);
+
+    // a_srcBuf was last written by a compute pass; the fence waits made it finish, the barrier makes its writes visible
+    // to the copy
+    VkMemoryBarrier fromCompute = {};
+    fromCompute.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fromCompute.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    fromCompute.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &fromCompute, 0, nullptr, 0, nullptr);
+
     VkBufferCopy region0 = {};
     region0.srcOffset    = 0;
     region0.dstOffset    = 0;
-    region0.size         = WIDTH * HEIGHT * sizeof(Pixel);
+    region0.size         = a_kernel.ImageBytes();
     vkCmdCopyBuffer(copyBuf, a_srcBuf, a_stagingBuf, 1, &region0);
+
+    VkBufferMemoryBarrier toHost = {};
+    toHost.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer              = a_stagingBuf;
+    toHost.offset              = 0;
+    toHost.size                = region0.size;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &toHost, 0, nullptr);
     vkEndCommandBuffer(copyBuf);
 
     VkSubmitInfo submitInfo       = {};
@@ -276,38 +1732,161 @@ public:
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers    = &copyBuf;
 
-    VkFence fence;
-    VkFenceCreateInfo fenceCreateInfo = {};
-    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCreateInfo.flags = 0;
+    VkFence fence = a_pFences->Acquire();
 
-    VK_CHECK_RESULT(vkCreateFence(a_device, &fenceCreateInfo, nullptr, &fence));
-    VK_CHECK_RESULT(vkQueueSubmit(a_queue, 1, &submitInfo, fence));
-    VK_CHECK_RESULT(vkWaitForFences(a_device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+    const int width  = int(a_kernel.width);
+    const int height = int(a_kernel.height);
 
-    vkDestroyFence(a_device, fence, nullptr);
+    auto createStart = std::chrono::high_resolution_clock::now();
+    MappedFile file("mandelbrot.bmp", BMPFileSize(width, height));
+    WriteBMPHeader(file.Data(), width, height);
+    auto createEnd = std::chrono::high_resolution_clock::now();
 
-    void* mappedMemory = nullptr;
-    for (int i = 0; i < a_height; i += 1)
+    const SimdPath simd = DetectSimdPath(a_config.simdLimit);
+
+    float copy_time = 0.0f, convert_time = 0.0f;
+    for(uint32_t run = 0; run < a_config.runs; ++run)
     {
-      size_t offset = a_offset + i * a_width * sizeof(Pixel);
+      auto copyStart = std::chrono::high_resolution_clock::now();
+      VK_CHECK_RESULT(vkQueueSubmit(a_queue, 1, &submitInfo, fence));
+      VK_CHECK_RESULT(vkWaitForFences(a_device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+      VK_CHECK_RESULT(vkResetFences(a_device, 1, &fence));
+      auto copyEnd = std::chrono::high_resolution_clock::now();
+
+      // staging memory is host coherent, the fence wait is all the synchronization needed
+      ConvertToBMPPixels(a_stagingMapped, a_kernel, file.Data() + BMP_HEADER_SIZE, a_config.readbackThreads, simd);
+      auto convertEnd = std::chrono::high_resolution_clock::now();
+
+      copy_time    += std::chrono::duration_cast<std::chrono::microseconds>(copyEnd - copyStart).count()/1000.f;
+      convert_time += std::chrono::duration_cast<std::chrono::microseconds>(convertEnd - copyEnd).count()/1000.f;
+    }
 
-      mappedMemory = nullptr;
-      vkMapMemory(a_device, a_stagingBufferMemory, offset, a_width * sizeof(Pixel), 0, &mappedMemory);
-      auto pmappedMemory = static_cast<Pixel*>(mappedMemory);
+    a_pFences->Release(fence);
+    vkFreeCommandBuffers(a_device, a_cmdPool, 1, &copyBuf);
+
+    auto closeStart = std::chrono::high_resolution_clock::now();
+    file.Close();
+    auto closeEnd = std::chrono::high_resolution_clock::now();
+
+    const float readbackMiB = float(a_kernel.ImageBytes()) / (1024.0f * 1024.0f);
+    copy_time    /= a_config.runs;
+    convert_time /= a_config.runs;
+    std::cout << "readback of " << readbackMiB << " MiB, average of " << a_config.runs << " runs:" << std::endl;
+    std::cout << "  copy to staging   " << copy_time << " milliseconds" << std::endl;
+    std::cout << "  host conversion   " << convert_time << " milliseconds (" << SimdPathName(simd) << ", "
+              << readbackMiB * 1000.0f / std::max(convert_time, 0.001f) << " MiB/s)" << std::endl;
+    const float write_time = std::chrono::duration_cast<std::chrono::microseconds>((createEnd - createStart) + (closeEnd - closeStart)).count()/1000.f;
+    std::cout << "  file map + close  " << write_time << " milliseconds (once)" << std::endl;
+    std::cout << "end-to-end, sequential (replay + copy + conversion + file) "
+              << a_computeTime + copy_time + convert_time + write_time << " milliseconds" << std::endl;
+  }
 
-      for (int j = 0; j < a_width; j += 1)
-      {
-        image.push_back((unsigned char)(255.0f * (pmappedMemory[j].r)));
-        image.push_back((unsigned char)(255.0f * (pmappedMemory[j].g)));
-        image.push_back((unsigned char)(255.0f * (pmappedMemory[j].b)));
-        image.push_back((unsigned char)(255.0f * (pmappedMemory[j].a)));
-      }
+  // Zero-copy save: the output file is mapped, its pages are imported as Vulkan memory (VK_EXT_external_memory_host)
+  // and the GPU copies the fractal buffer straight behind the BMP header, so the host touches no pixel at all.
+  // Only rgba8 has a BMP pixel layout (32-bit with bitfield masks). Returns false if the driver refuses the import.
+  bool saveZeroCopy(const AppConfig& a_config, const KernelParams& a_kernel, const std::vector<uint32_t>& a_queueFamilyIndices,
+                    float a_computeTime)
+  {
+    const int    width    = int(a_kernel.width);
+    const int    height   = int(a_kernel.height);
+    const size_t fileSize = BMP32FileSize(width, height);
+    if(fileSize > size_t(0xFFFFFFFFu))
+      return false;
+
+    // the import covers whole alignment units, the tail past the image is cut off when the file is closed
+    const size_t importSize = size_t((fileSize + hostImportAlignment - 1) / hostImportAlignment * hostImportAlignment);
+
+    auto createStart = std::chrono::high_resolution_clock::now();
+    MappedFile file("mandelbrot.bmp", fileSize, importSize);
+    WriteBMP32Header(file.Data(), width, height);
+
+    VkBuffer       importedBuf;
+    VkDeviceMemory importedMem;
+    if(uintptr_t(file.Data()) % hostImportAlignment != 0 ||
+       !createImportedBuffer(device, physicalDevice, file.Data(), importSize, a_queueFamilyIndices, &importedBuf, &importedMem))
+    {
+      std::cout << "mapped file can't be imported as Vulkan memory, reading back through staging" << std::endl;
+      return false;
+    }
+    auto createEnd = std::chrono::high_resolution_clock::now();
+
+    VkCommandBuffer copyBuf;
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = commandPools[0];
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &copyBuf));
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-      vkUnmapMemory(a_device, a_stagingBufferMemory);
+    vkBeginCommandBuffer(copyBuf, &beginInfo);
+
+    // the fractal buffer was last written by the benchmark's dispatches
+    VkMemoryBarrier fromCompute = {};
+    fromCompute.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fromCompute.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    fromCompute.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &fromCompute, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region0 = {};
+    region0.srcOffset    = 0;
+    region0.dstOffset    = BMP32_HEADER_SIZE;
+    region0.size         = a_kernel.ImageBytes();
+    vkCmdCopyBuffer(copyBuf, fractalBuffer, importedBuf, 1, &region0);
+
+    // makes the copy available to the host, whose page cache the OS writes the file back from
+    VkBufferMemoryBarrier toHost = {};
+    toHost.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer              = importedBuf;
+    toHost.offset              = region0.dstOffset;
+    toHost.size                = region0.size;
+    vkCmdPipelineBarrier(copyBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &toHost, 0, nullptr);
+    vkEndCommandBuffer(copyBuf);
+
+    VkSubmitInfo submitInfo       = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &copyBuf;
+
+    VkFence fence = fencePool->Acquire();
+
+    float copy_time = 0.0f;
+    for(uint32_t run = 0; run < a_config.runs; ++run)
+    {
+      auto copyStart = std::chrono::high_resolution_clock::now();
+      VK_CHECK_RESULT(vkQueueSubmit(queues[0], 1, &submitInfo, fence));
+      VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+      VK_CHECK_RESULT(vkResetFences(device, 1, &fence));
+      auto copyEnd = std::chrono::high_resolution_clock::now();
+      copy_time += std::chrono::duration_cast<std::chrono::microseconds>(copyEnd - copyStart).count()/1000.f;
     }
 
-    SaveBMP("mandelbrot.bmp", (const uint32_t*)image.data(), WIDTH, HEIGHT);
+    fencePool->Release(fence);
+    vkFreeCommandBuffers(device, commandPools[0], 1, &copyBuf);
+
+    // the driver dirties the pages when it releases them, so the import goes away before the file is closed
+    auto closeStart = std::chrono::high_resolution_clock::now();
+    vkDestroyBuffer(device, importedBuf, nullptr);
+    vkFreeMemory(device, importedMem, nullptr);
+    file.Close();
+    auto closeEnd = std::chrono::high_resolution_clock::now();
+
+    const float readbackMiB = float(a_kernel.ImageBytes()) / (1024.0f * 1024.0f);
+    copy_time /= a_config.runs;
+    const float file_time = std::chrono::duration_cast<std::chrono::microseconds>((createEnd - createStart) + (closeEnd - closeStart)).count()/1000.f;
+    std::cout << "zero-copy readback of " << readbackMiB << " MiB into the mapped file (32-bit BMP), average of " << a_config.runs << " runs:" << std::endl;
+    std::cout << "  copy to file pages " << copy_time << " milliseconds (" << readbackMiB * 1000.0f / std::max(copy_time, 0.001f) << " MiB/s)" << std::endl;
+    std::cout << "  file map, import and close " << file_time << " milliseconds (once)" << std::endl;
+    std::cout << "end-to-end, sequential (replay + copy + file) " << a_computeTime + copy_time + file_time << " milliseconds" << std::endl;
+    return true;
   }
 
   static VKAPI_ATTR VkBool32 VKAPI_CALL debugReportCallbackFn(
@@ -325,17 +1904,26 @@ public:
   }
 
 
+  // a_extraUsage is added to the storage and transfer usages, e.g. VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
   static void createBuffer(VkDevice a_device, VkPhysicalDevice a_physDevice, const size_t a_bufferSize,
-                           VkBuffer* a_pBuffer, VkDeviceMemory* a_pBufferMemory, const std::vector<uint32_t>& queueFamilyIndices)
+                           VkBuffer* a_pBuffer, VkDeviceMemory* a_pBufferMemory, const std::vector<uint32_t>& queueFamilyIndices,
+                           VkBufferUsageFlags a_extraUsage = 0)
   {
 
     VkBufferCreateInfo bufferCreateInfo = {};
     bufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferCreateInfo.size        = a_bufferSize;
-    bufferCreateInfo.usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
-    bufferCreateInfo.queueFamilyIndexCount = queueFamilyIndices.size();
-    bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+    bufferCreateInfo.usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | // destination of the host tiles of --hybrid
+                                   a_extraUsage;
+    if(queueFamilyIndices.size() > 1)
+    {
+      bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      bufferCreateInfo.queueFamilyIndexCount = queueFamilyIndices.size();
+      bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+    }
+    else
+      bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // all queues come from one family
 
     VK_CHECK_RESULT(vkCreateBuffer(a_device, &bufferCreateInfo, nullptr, a_pBuffer));
 
@@ -354,13 +1942,117 @@ public:
   }
 
   static void createStagingBuffer(VkDevice a_device, VkPhysicalDevice a_physDevice, const size_t a_bufferSize,
-                                  VkBuffer* a_pBuffer, VkDeviceMemory* a_pBufferMemory)
+                                  VkBuffer* a_pBuffer, VkDeviceMemory* a_pBufferMemory, const std::vector<uint32_t>& queueFamilyIndices)
   {
 
     VkBufferCreateInfo bufferCreateInfo = {};
     bufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferCreateInfo.size        = a_bufferSize;
     bufferCreateInfo.usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    if(queueFamilyIndices.size() > 1)
+    {
+      bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      bufferCreateInfo.queueFamilyIndexCount = queueFamilyIndices.size();
+      bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+    }
+    else
+      bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VK_CHECK_RESULT(vkCreateBuffer(a_device, &bufferCreateInfo, nullptr, a_pBuffer));
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(a_device, (*a_pBuffer), &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize  = memoryRequirements.size;
+    // the host reads this memory, uncached (write-combined) memory makes that several times slower
+    allocateInfo.memoryTypeIndex = vk_utils::FindMemoryType(memoryRequirements.memoryTypeBits,
+                                                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                            VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                                                            a_physDevice);
+    if(allocateInfo.memoryTypeIndex == uint32_t(-1))
+      allocateInfo.memoryTypeIndex = vk_utils::FindMemoryType(memoryRequirements.memoryTypeBits,
+                                                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                                              a_physDevice);
+
+    VK_CHECK_RESULT(vkAllocateMemory(a_device, &allocateInfo, nullptr, a_pBufferMemory));
+
+    VK_CHECK_RESULT(vkBindBufferMemory(a_device, (*a_pBuffer), (*a_pBufferMemory), 0));
+  }
+
+
+  // Wraps host memory (here the mapped output file) into a transfer destination through VK_EXT_external_memory_host.
+  // a_hostPtr and a_size must be multiples of minImportedHostPointerAlignment. Returns false, with nothing created,
+  // if the driver can't import this memory; some refuse file-backed pages.
+  static bool createImportedBuffer(VkDevice a_device, VkPhysicalDevice a_physDevice, void* a_hostPtr, const size_t a_size,
+                                   const std::vector<uint32_t>& queueFamilyIndices, VkBuffer* a_pBuffer, VkDeviceMemory* a_pBufferMemory)
+  {
+    auto getHostPointerProperties = (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(a_device, "vkGetMemoryHostPointerPropertiesEXT");
+    if(getHostPointerProperties == nullptr)
+      return false;
+
+    VkMemoryHostPointerPropertiesEXT hostPointerProps = {};
+    hostPointerProps.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    if(getHostPointerProperties(a_device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, a_hostPtr, &hostPointerProps) != VK_SUCCESS)
+      return false;
+
+    VkExternalMemoryBufferCreateInfo externalInfo = {};
+    externalInfo.sType       = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.pNext       = &externalInfo;
+    bufferCreateInfo.size        = a_size;
+    bufferCreateInfo.usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if(queueFamilyIndices.size() > 1)
+    {
+      bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      bufferCreateInfo.queueFamilyIndexCount = queueFamilyIndices.size();
+      bufferCreateInfo.pQueueFamilyIndices = queueFamilyIndices.data();
+    }
+    else
+      bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VK_CHECK_RESULT(vkCreateBuffer(a_device, &bufferCreateInfo, nullptr, a_pBuffer));
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(a_device, (*a_pBuffer), &memoryRequirements);
+
+    VkImportMemoryHostPointerInfoEXT importInfo = {};
+    importInfo.sType        = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    importInfo.handleType   = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    importInfo.pHostPointer = a_hostPtr;
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.pNext           = &importInfo;
+    allocateInfo.allocationSize  = a_size;
+    allocateInfo.memoryTypeIndex = vk_utils::FindMemoryType(memoryRequirements.memoryTypeBits & hostPointerProps.memoryTypeBits,
+                                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, a_physDevice);
+
+    if(memoryRequirements.size > a_size || allocateInfo.memoryTypeIndex == uint32_t(-1) ||
+       vkAllocateMemory(a_device, &allocateInfo, nullptr, a_pBufferMemory) != VK_SUCCESS)
+    {
+      vkDestroyBuffer(a_device, (*a_pBuffer), nullptr);
+      return false;
+    }
+
+    VK_CHECK_RESULT(vkBindBufferMemory(a_device, (*a_pBuffer), (*a_pBufferMemory), 0));
+    return true;
+  }
+
+  // host visible and coherent; a_usage lets host-written data that does not fit a uniform buffer be a storage buffer
+  static void createUniformBuffer(VkDevice a_device, VkPhysicalDevice a_physDevice, const size_t a_bufferSize,
+                                  VkBuffer* a_pBuffer, VkDeviceMemory* a_pBufferMemory,
+                                  VkBufferUsageFlags a_usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+  {
+
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size        = a_bufferSize;
+    bufferCreateInfo.usage       = a_usage;
     bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
     VK_CHECK_RESULT(vkCreateBuffer(a_device, &bufferCreateInfo, nullptr, a_pBuffer));
@@ -380,36 +2072,56 @@ public:
     VK_CHECK_RESULT(vkBindBufferMemory(a_device, (*a_pBuffer), (*a_pBufferMemory), 0));
   }
 
-
   static void createDescriptorSetLayout(VkDevice a_device, VkDescriptorSetLayout* a_pDSLayout)
   {
-     VkDescriptorSetLayoutBinding descriptorSetLayoutBinding = {};
-     descriptorSetLayoutBinding.binding         = 0;
-     descriptorSetLayoutBinding.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-     descriptorSetLayoutBinding.descriptorCount = 1;
-     descriptorSetLayoutBinding.stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+     VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[4] = {};
+     descriptorSetLayoutBindings[0].binding         = 0;
+     descriptorSetLayoutBindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+     descriptorSetLayoutBindings[0].descriptorCount = 1;
+     descriptorSetLayoutBindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+     descriptorSetLayoutBindings[1].binding         = 1;
+     descriptorSetLayoutBindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+     descriptorSetLayoutBindings[1].descriptorCount = 1;
+     descriptorSetLayoutBindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+     // tile counter of the persistent kernel, left unwritten for the other kernels which do not use it
+     descriptorSetLayoutBindings[2].binding         = 2;
+     descriptorSetLayoutBindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+     descriptorSetLayoutBindings[2].descriptorCount = 1;
+     descriptorSetLayoutBindings[2].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+     // view and reference orbit of the --precision kernels, likewise unwritten for the float kernels
+     descriptorSetLayoutBindings[3].binding         = 3;
+     descriptorSetLayoutBindings[3].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+     descriptorSetLayoutBindings[3].descriptorCount = 1;
+     descriptorSetLayoutBindings[3].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
 
      VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {};
      descriptorSetLayoutCreateInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-     descriptorSetLayoutCreateInfo.bindingCount = 1;
-     descriptorSetLayoutCreateInfo.pBindings    = &descriptorSetLayoutBinding;
+     descriptorSetLayoutCreateInfo.bindingCount = 4;
+     descriptorSetLayoutCreateInfo.pBindings    = descriptorSetLayoutBindings;
      VK_CHECK_RESULT(vkCreateDescriptorSetLayout(a_device, &descriptorSetLayoutCreateInfo, nullptr, a_pDSLayout));
   }
 
-  static void createDescriptorSetForOurBuffer(VkDevice a_device, VkBuffer a_buffer, size_t a_bufferSize,
-                                              const VkDescriptorSetLayout* a_pDSLayout,
+  // a_tileCounter may be VK_NULL_HANDLE when the set is not used with the persistent kernel,
+  // a_precision when it is not used with the --precision kernels
+  static void createDescriptorSetForOurBuffer(VkDevice a_device, VkBuffer a_buffer, size_t a_bufferSize, VkBuffer a_paramsBuffer,
+                                              VkBuffer a_tileCounter, VkBuffer a_precision, const VkDescriptorSetLayout* a_pDSLayout,
                                               VkDescriptorPool* a_pDSPool, VkDescriptorSet* a_pDS)
   {
 
-    VkDescriptorPoolSize descriptorPoolSize = {};
-    descriptorPoolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    descriptorPoolSize.descriptorCount = 1;
+    VkDescriptorPoolSize descriptorPoolSizes[2] = {};
+    descriptorPoolSizes[0].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorPoolSizes[0].descriptorCount = 3;
+    descriptorPoolSizes[1].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorPoolSizes[1].descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {};
     descriptorPoolCreateInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     descriptorPoolCreateInfo.maxSets       = 1;
-    descriptorPoolCreateInfo.poolSizeCount = 1;
-    descriptorPoolCreateInfo.pPoolSizes    = &descriptorPoolSize;
+    descriptorPoolCreateInfo.poolSizeCount = 2;
+    descriptorPoolCreateInfo.pPoolSizes    = descriptorPoolSizes;
 
     VK_CHECK_RESULT(vkCreateDescriptorPool(a_device, &descriptorPoolCreateInfo, nullptr, a_pDSPool));
 
@@ -426,34 +2138,95 @@ public:
     descriptorBufferInfo.offset = 0;
     descriptorBufferInfo.range  = a_bufferSize;
 
-    VkWriteDescriptorSet writeDescriptorSet = {};
-    writeDescriptorSet.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writeDescriptorSet.dstSet          = (*a_pDS);
-    writeDescriptorSet.dstBinding      = 0;
-    writeDescriptorSet.descriptorCount = 1;
-    writeDescriptorSet.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    writeDescriptorSet.pBufferInfo     = &descriptorBufferInfo;
+    VkDescriptorBufferInfo paramsBufferInfo = {};
+    paramsBufferInfo.buffer = a_paramsBuffer;
+    paramsBufferInfo.offset = 0;
+    paramsBufferInfo.range  = sizeof(RenderParams);
+
+    VkDescriptorBufferInfo counterBufferInfo = {};
+    counterBufferInfo.buffer = a_tileCounter;
+    counterBufferInfo.offset = 0;
+    counterBufferInfo.range  = sizeof(uint32_t);
+
+    VkDescriptorBufferInfo precisionBufferInfo = {};
+    precisionBufferInfo.buffer = a_precision;
+    precisionBufferInfo.offset = 0;
+    precisionBufferInfo.range  = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writeDescriptorSets[4] = {};
+    writeDescriptorSets[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[0].dstSet          = (*a_pDS);
+    writeDescriptorSets[0].dstBinding      = 0;
+    writeDescriptorSets[0].descriptorCount = 1;
+    writeDescriptorSets[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writeDescriptorSets[0].pBufferInfo     = &descriptorBufferInfo;
+
+    writeDescriptorSets[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDescriptorSets[1].dstSet          = (*a_pDS);
+    writeDescriptorSets[1].dstBinding      = 1;
+    writeDescriptorSets[1].descriptorCount = 1;
+    writeDescriptorSets[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writeDescriptorSets[1].pBufferInfo     = &paramsBufferInfo;
+
+    uint32_t writesNum = 2;
+    if(a_tileCounter != VK_NULL_HANDLE)
+    {
+      writeDescriptorSets[writesNum].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writeDescriptorSets[writesNum].dstSet          = (*a_pDS);
+      writeDescriptorSets[writesNum].dstBinding      = 2;
+      writeDescriptorSets[writesNum].descriptorCount = 1;
+      writeDescriptorSets[writesNum].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writeDescriptorSets[writesNum].pBufferInfo     = &counterBufferInfo;
+      ++writesNum;
+    }
+    if(a_precision != VK_NULL_HANDLE)
+    {
+      writeDescriptorSets[writesNum].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writeDescriptorSets[writesNum].dstSet          = (*a_pDS);
+      writeDescriptorSets[writesNum].dstBinding      = 3;
+      writeDescriptorSets[writesNum].descriptorCount = 1;
+      writeDescriptorSets[writesNum].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writeDescriptorSets[writesNum].pBufferInfo     = &precisionBufferInfo;
+      ++writesNum;
+    }
 
-    vkUpdateDescriptorSets(a_device, 1, &writeDescriptorSet, 0, nullptr);
+    vkUpdateDescriptorSets(a_device, writesNum, writeDescriptorSets, 0, nullptr);
   }
 
-  static void createComputePipeline(VkDevice a_device, const VkDescriptorSetLayout& a_dsLayout,
-                                    VkShaderModule* a_pShaderModule, VkPipeline* a_pPipeline, VkPipelineLayout* a_pPipelineLayout)
+  // With EMBED_SPIRV the module is taken from the executable when its file name was embedded, otherwise it is read from disk.
+  // Throws if the module lacks a declaration of a_required. a_pHash, when given, gets a hash of the SPIR-V (it
+  // identifies the kernel in tile cache keys).
+  static void createShaderModule(VkDevice a_device, const char* a_shaderPath, const ShaderRequirements& a_required,
+                                 VkShaderModule* a_pShaderModule, uint64_t* a_pHash = nullptr)
   {
-    std::vector<uint32_t> code = vk_utils::ReadFile("shaders/comp.spv");
     VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+#ifdef EMBED_SPIRV
+    if(const EmbeddedSpirv* embedded = FindEmbeddedSpirv(a_shaderPath))
+    {
+      createInfo.pCode    = reinterpret_cast<const uint32_t*>(embedded->code);
+      createInfo.codeSize = embedded->size;
+      CheckShaderInterface(a_shaderPath, createInfo.pCode, createInfo.codeSize, a_required);
+      if(a_pHash != nullptr)
+        *a_pHash = HashBytes(embedded->code, embedded->size);
+      VK_CHECK_RESULT(vkCreateShaderModule(a_device, &createInfo, nullptr, a_pShaderModule));
+      return;
+    }
+    std::cout << a_shaderPath << " is not embedded, reading it from disk" << std::endl;
+#endif
+
+    std::vector<uint32_t> code = vk_utils::ReadFile(a_shaderPath);
     createInfo.pCode    = code.data();
     createInfo.codeSize = code.size()*sizeof(uint32_t);
+    CheckShaderInterface(a_shaderPath, createInfo.pCode, createInfo.codeSize, a_required);
+    if(a_pHash != nullptr)
+      *a_pHash = HashBytes(createInfo.pCode, createInfo.codeSize);
     VK_CHECK_RESULT(vkCreateShaderModule(a_device, &createInfo, nullptr, a_pShaderModule));
+  }
 
-
-    VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {};
-    shaderStageCreateInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStageCreateInfo.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
-    shaderStageCreateInfo.module = (*a_pShaderModule);
-    shaderStageCreateInfo.pName  = "main";
-
+  static void createPipelineLayout(VkDevice a_device, const VkDescriptorSetLayout& a_dsLayout, VkPipelineLayout* a_pPipelineLayout)
+  {
     VkPushConstantRange pcRange = {};
     pcRange.size = sizeof(pushConstants);
     pcRange.offset = 0;
@@ -466,46 +2239,26 @@ public:
     pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
     pipelineLayoutCreateInfo.pPushConstantRanges = &pcRange;
     VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutCreateInfo, nullptr, a_pPipelineLayout));
-
-    VkComputePipelineCreateInfo pipelineCreateInfo = {};
-    pipelineCreateInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.stage  = shaderStageCreateInfo;
-    pipelineCreateInfo.layout = (*a_pPipelineLayout);
-
-    VK_CHECK_RESULT(vkCreateComputePipelines(a_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, a_pPipeline));
-  }
-
-  static void createCommandBuffers(VkDevice a_device, VkCommandPool &a_pool, std::vector<VkCommandBuffer> &cmdBufs, size_t nBufs)
-  {
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
-    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.commandPool = a_pool;
-    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandBufferCount = nBufs;
-    VK_CHECK_RESULT(vkAllocateCommandBuffers(a_device, &commandBufferAllocateInfo, cmdBufs.data()));
   }
 
-  static void recordCommandsTo(VkCommandBuffer a_cmdBuff, VkPipeline a_pipeline, VkPipelineLayout a_layout, const VkDescriptorSet& a_ds,
-                               uint32_t xWork, uint32_t xOffset, uint32_t yWork, uint32_t yOffset)
+  static void createComputePipeline(VkDevice a_device, VkPipelineLayout a_pipelineLayout, VkShaderModule a_shaderModule,
+                                    VkPipelineCache a_cache, const KernelParams& a_kernel, VkPipeline* a_pPipeline)
   {
+    KernelSpecialization specialization(a_kernel);
 
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    VK_CHECK_RESULT(vkBeginCommandBuffer(a_cmdBuff, &beginInfo));
-
-    pushConstants pcData {xOffset, yOffset};
-
-    vkCmdPushConstants(a_cmdBuff, a_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pcData), &pcData);
-
-    vkCmdBindPipeline(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, a_pipeline);
-    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, a_layout, 0, 1, &a_ds, 0, NULL);
+    VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {};
+    shaderStageCreateInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageCreateInfo.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    shaderStageCreateInfo.module = a_shaderModule;
+    shaderStageCreateInfo.pName  = "main";
+    shaderStageCreateInfo.pSpecializationInfo = &specialization.info;
 
-    vkCmdDispatch(a_cmdBuff, (xWork + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
-                  (yWork + WORKGROUP_SIZE) / WORKGROUP_SIZE,
-                  1);
+    VkComputePipelineCreateInfo pipelineCreateInfo = {};
+    pipelineCreateInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage  = shaderStageCreateInfo;
+    pipelineCreateInfo.layout = a_pipelineLayout;
 
-    VK_CHECK_RESULT(vkEndCommandBuffer(a_cmdBuff));
+    VK_CHECK_RESULT(vkCreateComputePipelines(a_device, a_cache, 1, &pipelineCreateInfo, nullptr, a_pPipeline));
   }
 
   void cleanup()
@@ -521,29 +2274,102 @@ public:
           func(instance, debugReportCallback, nullptr);
       }
 
+      plan.reset();
+      profiler.reset();
+      fencePool.reset();
+      hostBackend.reset();
+
+      if(hostImageBuffer != VK_NULL_HANDLE)
+      {
+        vkUnmapMemory(device, hostImageMemory);
+        vkDestroyBuffer(device, hostImageBuffer, nullptr);
+        vkFreeMemory(device, hostImageMemory, nullptr);
+      }
+
+      vkUnmapMemory(device, paramsMemory);
+      vkFreeMemory(device, paramsMemory, nullptr);
+      vkDestroyBuffer(device, paramsBuffer, nullptr);
       vkFreeMemory(device, bufferMemory, nullptr);
       vkDestroyBuffer(device, fractalBuffer, nullptr);
+      vkFreeMemory(device, tileCounterMemory, nullptr);
+      vkDestroyBuffer(device, tileCounterBuffer, nullptr);
+      if(precisionBuffer != VK_NULL_HANDLE)
+        vkUnmapMemory(device, precisionMemory);
+      vkFreeMemory(device, precisionMemory, nullptr);
+      vkDestroyBuffer(device, precisionBuffer, nullptr);
       vkDestroyShaderModule(device, computeShaderModule, nullptr);
+      vkDestroyShaderModule(device, persistentShaderModule, nullptr);
+      vkDestroyShaderModule(device, marianiShaderModule, nullptr);
+      vkDestroyShaderModule(device, progressiveShaderModule, nullptr);
+      vkDestroyShaderModule(device, colorizeShaderModule, nullptr);
+      vkDestroyPipeline(device, colorizePipeline, nullptr);
+      vkDestroyPipelineLayout(device, colorizeLayout, nullptr);
+      vkDestroyDescriptorPool(device, colorizePool, nullptr);
+      vkDestroyDescriptorSetLayout(device, colorizeSetLayout, nullptr);
+      vkFreeMemory(device, colorMemory, nullptr);
+      vkDestroyBuffer(device, colorBuffer, nullptr);
+      vkFreeMemory(device, paletteMemory, nullptr);
+      vkDestroyBuffer(device, paletteBuffer, nullptr);
+      vkDestroyShaderModule(device, histogramShaderModule, nullptr);
+      vkDestroyPipeline(device, histogramPipeline, nullptr);
+      vkDestroyPipelineLayout(device, histogramLayout, nullptr);
+      vkDestroyDescriptorPool(device, histogramPool, nullptr);
+      vkDestroyDescriptorSetLayout(device, histogramSetLayout, nullptr);
+      vkFreeMemory(device, statsMemory, nullptr);
+      vkDestroyBuffer(device, statsBuffer, nullptr);
+      if(statsReadback != VK_NULL_HANDLE)
+        vkUnmapMemory(device, statsReadbackMemory);
+      vkFreeMemory(device, statsReadbackMemory, nullptr);
+      vkDestroyBuffer(device, statsReadback, nullptr);
+      vkDestroyShaderModule(device, edgeShaderModule, nullptr);
+      vkDestroyPipeline(device, edgePipeline, nullptr);
+      vkDestroyPipelineLayout(device, edgeLayout, nullptr);
+      vkDestroyDescriptorPool(device, edgePool, nullptr);
+      vkDestroyDescriptorSetLayout(device, edgeSetLayout, nullptr);
+      vkDestroyShaderModule(device, supersampleShaderModule, nullptr);
+      vkDestroyPipeline(device, supersamplePipeline, nullptr);
+      vkDestroyPipelineLayout(device, supersampleLayout, nullptr);
+      vkDestroyDescriptorPool(device, supersamplePool, nullptr);
+      vkDestroyDescriptorSetLayout(device, supersampleSetLayout, nullptr);
+      vkFreeMemory(device, edgeListMemory, nullptr);
+      vkDestroyBuffer(device, edgeListBuffer, nullptr);
+      if(edgeReadback != VK_NULL_HANDLE)
+        vkUnmapMemory(device, edgeReadbackMemory);
+      vkFreeMemory(device, edgeReadbackMemory, nullptr);
+      vkDestroyBuffer(device, edgeReadback, nullptr);
       vkDestroyDescriptorPool(device, descriptorPool, nullptr);
       vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
       vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-      vkDestroyPipeline(device, pipeline, nullptr);
-      vkDestroyCommandPool(device, commandPool1, nullptr);
-      vkDestroyCommandPool(device, commandPool2, nullptr);
+      for(auto& variant : pipelineVariants)
+        vkDestroyPipeline(device, variant.second, nullptr);
+      for(auto& variant : persistentVariants)
+        vkDestroyPipeline(device, variant.second, nullptr);
+      for(auto& variant : marianiVariants)
+        vkDestroyPipeline(device, variant.second, nullptr);
+      for(auto& variant : progressiveVariants)
+        vkDestroyPipeline(device, variant.second, nullptr);
+      pipelineCache.reset(); // saves the cache file
+      for(auto pool : commandPools)
+        vkDestroyCommandPool(device, pool, nullptr);
+      if(transferPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(device, transferPool, nullptr);
       vkDestroyDevice(device, nullptr);
       vkDestroyInstance(instance, nullptr);
   }
 };
 
-int main()
+int main(int argc, const char** argv)
 {
   ComputeApplication app;
 
-  constexpr unsigned deviceId = 0;
+  AppConfig config;
 
   try
   {
-    app.run(deviceId);
+    if(!ParseCommandLine(argc, argv, &config))
+      return EXIT_SUCCESS;
+
+    app.run(config);
   }
   catch (const std::exception& e)
   {
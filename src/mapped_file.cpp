@@ -0,0 +1,132 @@
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+static void FileError(const char* a_what, const char* a_path)
+{
+  throw std::runtime_error(std::string("MappedFile: can't ") + a_what + " " + a_path);
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char* a_path, size_t a_size, size_t a_mappedSize) :
+                       size(a_size), mappedSize(a_mappedSize > a_size ? a_mappedSize : a_size)
+{
+  file = CreateFileA(a_path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(file == INVALID_HANDLE_VALUE)
+  {
+    file = nullptr;
+    FileError("create", a_path);
+  }
+
+  // the mapping object sets the file length, a view can't reach past it
+  const ULARGE_INTEGER length = {{DWORD(uint64_t(mappedSize)), DWORD(uint64_t(mappedSize) >> 32)}};
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, length.HighPart, length.LowPart, nullptr);
+  if(mapping != nullptr)
+    data = static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, mappedSize));
+
+  if(data == nullptr)
+  {
+    Close();
+    FileError("map", a_path);
+  }
+}
+
+void MappedFile::Close()
+{
+  if(data != nullptr)
+    UnmapViewOfFile(data);
+  if(mapping != nullptr)
+    CloseHandle(mapping);
+
+  if(file != nullptr)
+  {
+    LARGE_INTEGER end;
+    end.QuadPart = LONGLONG(size);
+    if(SetFilePointerEx(file, end, nullptr, FILE_BEGIN))
+      SetEndOfFile(file);
+    CloseHandle(file);
+  }
+
+  data    = nullptr;
+  mapping = nullptr;
+  file    = nullptr;
+}
+
+size_t MappedFile::PageSize()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return size_t(info.dwAllocationGranularity);
+}
+
+#else
+
+MappedFile::MappedFile(const char* a_path, size_t a_size, size_t a_mappedSize) :
+                       size(a_size), mappedSize(a_mappedSize > a_size ? a_mappedSize : a_size)
+{
+  fd = open(a_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0)
+    FileError("create", a_path);
+
+  // reserve the blocks up front where we can: running out of disk space through a mapping is a SIGBUS, not an error code
+#ifdef __linux__
+  const bool sized = (posix_fallocate(fd, 0, off_t(mappedSize)) == 0) || (ftruncate(fd, off_t(mappedSize)) == 0);
+#else
+  const bool sized = (ftruncate(fd, off_t(mappedSize)) == 0);
+#endif
+  if(!sized)
+  {
+    Close();
+    FileError("resize", a_path);
+  }
+
+  void* ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(ptr == MAP_FAILED)
+  {
+    Close();
+    FileError("map", a_path);
+  }
+  data = static_cast<unsigned char*>(ptr);
+}
+
+void MappedFile::Close()
+{
+  if(data != nullptr)
+    munmap(data, mappedSize);
+
+  if(fd >= 0)
+  {
+    if(mappedSize != size && ftruncate(fd, off_t(size)) != 0)
+      perror("MappedFile: ftruncate");
+    close(fd);
+  }
+
+  data = nullptr;
+  fd   = -1;
+}
+
+size_t MappedFile::PageSize()
+{
+  return size_t(sysconf(_SC_PAGESIZE));
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
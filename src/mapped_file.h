@@ -0,0 +1,41 @@
+#ifndef VK_ASYNC_COMPUTE_MAPPED_FILE_H
+#define VK_ASYNC_COMPUTE_MAPPED_FILE_H
+
+#include <cstddef>
+
+// An output file created at its final size and mapped for writing, so results are stored straight into their
+// file offsets, from any thread and in any order, with no intermediate buffer and no write calls.
+// The mapping may be longer than the file (a_mappedSize, e.g. rounded up for a Vulkan host pointer import);
+// the file is cut back to a_size when it is closed. Throws std::runtime_error when the file can't be created.
+class MappedFile
+{
+public:
+  MappedFile(const char* a_path, size_t a_size, size_t a_mappedSize = 0);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  unsigned char* Data()       const { return data; }
+  size_t         Size()       const { return size; }
+  size_t         MappedSize() const { return mappedSize; }
+
+  // unmaps and closes the file; dirty pages are written back by the OS as after a buffered write, no sync is forced
+  void Close();
+
+  static size_t PageSize();
+
+private:
+  unsigned char* data       = nullptr;
+  size_t         size       = 0;
+  size_t         mappedSize = 0;
+
+#ifdef _WIN32
+  void* file    = nullptr;
+  void* mapping = nullptr;
+#else
+  int   fd      = -1;
+#endif
+};
+
+#endif //VK_ASYNC_COMPUTE_MAPPED_FILE_H
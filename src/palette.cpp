@@ -0,0 +1,48 @@
+#include "palette.h"
+
+#include <cmath>
+#include <algorithm>
+
+const char* PaletteName(PaletteKind a_kind)
+{
+  switch(a_kind)
+  {
+    case PaletteKind::GRAY: return "gray";
+    case PaletteKind::FIRE: return "fire";
+    default:                return "cosine";
+  }
+}
+
+PaletteUniforms MakePalette(PaletteKind a_kind)
+{
+  // the cosine palette of shader.comp
+  static const float d[3] = { 0.3f,  0.3f,  0.5f};
+  static const float e[3] = {-0.2f, -0.3f, -0.5f};
+  static const float f[3] = { 2.1f,  2.0f,  3.0f};
+  static const float g[3] = { 0.0f,  0.1f,  0.0f};
+
+  PaletteUniforms res = {};
+  res.entries = PALETTE_SIZE;
+  for(uint32_t i = 0; i < PALETTE_SIZE; ++i)
+  {
+    const float t     = float(i) / float(PALETTE_SIZE - 1);
+    float*      color = res.colors[i];
+    switch(a_kind)
+    {
+      case PaletteKind::GRAY:
+        color[0] = color[1] = color[2] = t;
+        break;
+      case PaletteKind::FIRE:
+        color[0] = std::min(3.0f * t, 1.0f);
+        color[1] = std::min(std::max(3.0f * t - 1.0f, 0.0f), 1.0f);
+        color[2] = std::max(3.0f * t - 2.0f, 0.0f);
+        break;
+      default:
+        for(int k = 0; k < 3; ++k)
+          color[k] = std::max(d[k] + e[k] * std::cos(6.28318f * (f[k] * t + g[k])), 0.0f);
+        break;
+    }
+    color[3] = 1.0f;
+  }
+  return res;
+}
@@ -0,0 +1,31 @@
+#ifndef VK_ASYNC_COMPUTE_PALETTE_H
+#define VK_ASYNC_COMPUTE_PALETTE_H
+
+#include <cstdint>
+
+#include "../shaders/shaderCommon.h"
+
+// Palettes of the colorize pass.
+enum class PaletteKind
+{
+  COSINE, // the palette of shader.comp, so a colorized render looks like the fused one
+  GRAY,
+  FIRE,   // black, red, yellow, white
+};
+
+const char* PaletteName(PaletteKind a_kind);
+
+// Uniform buffer of shader_colorize.comp (std140): 'entries' colors spread evenly over [0, iteration limit].
+// With 'equalize' set, counts outside the set are first mapped through 'cdf' (MakeEqualizationCdf in render_stats.h).
+struct PaletteUniforms
+{
+  float    colors[PALETTE_SIZE][4];
+  uint32_t entries;
+  uint32_t equalize;
+  uint32_t pad[2];
+  float    cdf[HISTOGRAM_BINS + 4]; // HISTOGRAM_BINS + 1 used, std140 vec4 array
+};
+
+PaletteUniforms MakePalette(PaletteKind a_kind);
+
+#endif //VK_ASYNC_COMPUTE_PALETTE_H
@@ -0,0 +1,110 @@
+#include "pipeline_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <vector>
+#include <iostream>
+
+#include "vk_utils.h"
+
+static constexpr uint32_t CACHE_FILE_MAGIC   = 0x43505641; // "AVPC"
+static constexpr uint32_t CACHE_FILE_VERSION = 1;
+
+PersistentPipelineCache::PersistentPipelineCache(VkDevice a_device, VkPhysicalDevice a_physicalDevice, const std::string& a_path) :
+  device(a_device), path(a_path)
+{
+  vkGetPhysicalDeviceProperties(a_physicalDevice, &props);
+
+  std::vector<char> data;
+  FILE* fp = path.empty() ? nullptr : fopen(path.c_str(), "rb");
+  if(fp != nullptr)
+  {
+    FileHeader expected, header;
+    fillHeader(&expected);
+
+    const bool headerRead = (fread(&header, sizeof(header), 1, fp) == 1);
+    const bool sameDevice = headerRead && header.magic == expected.magic && header.version == expected.version &&
+                            header.vendorID == expected.vendorID && header.deviceID == expected.deviceID &&
+                            header.driverVersion == expected.driverVersion &&
+                            std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    if(sameDevice)
+    {
+      data.resize(size_t(header.dataSize));
+      if(data.empty() || fread(data.data(), data.size(), 1, fp) != 1)
+        data.clear();
+    }
+
+    if(data.empty())
+      std::cout << "pipeline cache: " << path << " was written by another device or driver, or is damaged; starting empty" << std::endl;
+    fclose(fp);
+  }
+
+  VkPipelineCacheCreateInfo createInfo = {};
+  createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = data.size();
+  createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+
+  // the driver is free to reject initial data it does not like, retry empty on failure
+  if(vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS)
+  {
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData    = nullptr;
+    data.clear();
+    VK_CHECK_RESULT(vkCreatePipelineCache(device, &createInfo, nullptr, &cache));
+  }
+
+  loadedBytes = data.size();
+}
+
+PersistentPipelineCache::~PersistentPipelineCache()
+{
+  Save();
+  vkDestroyPipelineCache(device, cache, nullptr);
+}
+
+void PersistentPipelineCache::fillHeader(FileHeader* a_pHeader) const
+{
+  std::memset(a_pHeader, 0, sizeof(FileHeader));
+  a_pHeader->magic         = CACHE_FILE_MAGIC;
+  a_pHeader->version       = CACHE_FILE_VERSION;
+  a_pHeader->vendorID      = props.vendorID;
+  a_pHeader->deviceID      = props.deviceID;
+  a_pHeader->driverVersion = props.driverVersion;
+  std::memcpy(a_pHeader->pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+bool PersistentPipelineCache::Save()
+{
+  if(path.empty() || cache == VK_NULL_HANDLE)
+    return true;
+
+  size_t dataSize = 0;
+  if(vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    return false;
+
+  std::vector<char> data(dataSize);
+  if(vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+    return false;
+
+  FileHeader header;
+  fillHeader(&header);
+  header.dataSize = dataSize;
+
+  // write next to the target and rename, so a crash never leaves a truncated cache behind
+  const std::string tmpPath = path + ".tmp";
+  FILE* fp = fopen(tmpPath.c_str(), "wb");
+  if(fp == nullptr)
+    return false;
+
+  const bool written = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(data.data(), dataSize, 1, fp) == 1;
+  fclose(fp);
+
+  std::remove(path.c_str());
+  if(!written || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+  {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
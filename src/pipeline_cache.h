@@ -0,0 +1,47 @@
+#ifndef VK_ASYNC_COMPUTE_PIPELINE_CACHE_H
+#define VK_ASYNC_COMPUTE_PIPELINE_CACHE_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+
+// VkPipelineCache that is loaded from and saved to a file between runs.
+// The file starts with a small header (vendor, device, driver version and pipelineCacheUUID of the device that wrote it);
+// a file written by another device or driver is ignored and the cache starts empty. An empty path disables persistence.
+class PersistentPipelineCache
+{
+public:
+  PersistentPipelineCache(VkDevice a_device, VkPhysicalDevice a_physicalDevice, const std::string& a_path);
+  ~PersistentPipelineCache();
+
+  PersistentPipelineCache(const PersistentPipelineCache&) = delete;
+  PersistentPipelineCache& operator=(const PersistentPipelineCache&) = delete;
+
+  VkPipelineCache Handle() const { return cache; }
+  bool            Loaded() const { return loadedBytes != 0; } // initial data was accepted from the file
+  size_t          LoadedBytes() const { return loadedBytes; }
+
+  // writes the current cache content to the file (also done by the destructor); returns false on I/O error
+  bool Save();
+
+private:
+  struct FileHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+  };
+
+  void fillHeader(FileHeader* a_pHeader) const;
+
+  VkDevice                   device;
+  VkPhysicalDeviceProperties props;
+  std::string                path;
+  VkPipelineCache            cache       = VK_NULL_HANDLE;
+  size_t                     loadedBytes = 0;
+};
+
+#endif //VK_ASYNC_COMPUTE_PIPELINE_CACHE_H
@@ -0,0 +1,216 @@
+#include "pipelined_readback.h"
+
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+
+#include "Bitmap.h"
+#include "mapped_file.h"
+#include "render_plan.h"
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float msBetween(Clock::time_point a_start, Clock::time_point a_end)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(a_end - a_start).count() / 1000.f;
+}
+
+PipelinedReadback::PipelinedReadback(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                                     const KernelParams& a_kernel, vk_utils::FencePool* a_pFences) :
+                                     device(a_device), pipeline(a_pipeline), pipelineLayout(a_layout), descriptorSet(a_ds),
+                                     kernel(a_kernel), pFences(a_pFences)
+{
+}
+
+PipelinedReadback::~PipelinedReadback()
+{
+  for(auto& band : bands)
+  {
+    for(size_t q = 0; q < computeQueues.size(); ++q)
+    {
+      if(band.cmds[q] != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(device, computeQueues[q].pool, 1, &band.cmds[q]);
+      vkDestroySemaphore(device, band.computeDone[q], nullptr);
+    }
+    vkFreeCommandBuffers(device, transferPool, 1, &band.copyCmd);
+  }
+}
+
+void PipelinedReadback::AddComputeQueue(VkQueue a_queue, VkCommandPool a_pool)
+{
+  assert(bands.empty());
+  computeQueues.push_back({a_queue, a_pool});
+}
+
+void PipelinedReadback::SetTransferQueue(VkQueue a_queue, VkCommandPool a_pool)
+{
+  assert(bands.empty());
+  transferQueue = a_queue;
+  transferPool  = a_pool;
+}
+
+void PipelinedReadback::Record(VkBuffer a_src, VkBuffer a_staging)
+{
+  assert(bands.empty() && !computeQueues.empty() && transferQueue != VK_NULL_HANDLE);
+
+  const uint32_t nQueues  = uint32_t(computeQueues.size());
+  const size_t   rowBytes = size_t(kernel.width) * kernel.BytesPerPixel();
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+  semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  bands.resize(kernel.TilesY());
+  for(uint32_t i = 0; i < bands.size(); ++i)
+  {
+    Band& band    = bands[i];
+    band.rowBegin = i * kernel.tileY;
+    band.rowEnd   = std::min(band.rowBegin + kernel.tileY, kernel.height);
+    band.cmds.assign(nQueues, VK_NULL_HANDLE);
+    band.computeDone.resize(nQueues);
+
+    // the same diagonal split as the static schedule of the main benchmark
+    std::vector<std::vector<TileRect>> queueTiles(nQueues);
+    for(uint32_t j = 0; j < kernel.TilesX(); ++j)
+    {
+      const TileRect tile = {kernel.tileX * j, band.rowBegin, std::min(kernel.tileX, kernel.width - kernel.tileX * j),
+                             band.rowEnd - band.rowBegin, i * kernel.TilesX() + j};
+      queueTiles[(i + j) % nQueues].push_back(tile);
+    }
+
+    for(uint32_t q = 0; q < nQueues; ++q)
+    {
+      VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &band.computeDone[q]));
+      if(queueTiles[q].empty())
+        continue;
+
+      commandBufferAllocateInfo.commandPool = computeQueues[q].pool;
+      VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &band.cmds[q]));
+      RenderPlan::recordTilesTo(band.cmds[q], pipeline, pipelineLayout, descriptorSet, kernel.workgroupSize,
+                                queueTiles[q].data(), queueTiles[q].size());
+    }
+
+    commandBufferAllocateInfo.commandPool = transferPool;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &band.copyCmd));
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(band.copyCmd, &beginInfo));
+
+    // iter16 rows are not word aligned for odd widths; the copy is byte exact, so it never reads the other band's half
+    VkBufferCopy region = {};
+    region.srcOffset    = band.rowBegin * rowBytes;
+    region.dstOffset    = band.rowBegin * rowBytes;
+    region.size         = (band.rowEnd - band.rowBegin) * rowBytes;
+    vkCmdCopyBuffer(band.copyCmd, a_src, a_staging, 1, &region);
+
+    VkBufferMemoryBarrier toHost = {};
+    toHost.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer              = a_staging;
+    toHost.offset              = region.dstOffset;
+    toHost.size                = region.size;
+    vkCmdPipelineBarrier(band.copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &toHost, 0, nullptr);
+
+    VK_CHECK_RESULT(vkEndCommandBuffer(band.copyCmd));
+  }
+}
+
+PipelinedStats PipelinedReadback::Run(const void* a_stagingMapped, const char* a_fileName, unsigned a_threads, SimdPath a_simd)
+{
+  PipelinedStats stats;
+  const auto start = Clock::now();
+
+  // everything is submitted up front, the semaphores order compute and copies on the GPU
+  std::vector<VkFence> bandFences(bands.size());
+  for(size_t i = 0; i < bands.size(); ++i)
+  {
+    Band& band = bands[i];
+
+    std::vector<VkSemaphore> waitFor;
+    for(size_t q = 0; q < computeQueues.size(); ++q)
+    {
+      if(band.cmds[q] == VK_NULL_HANDLE)
+        continue;
+
+      VkSubmitInfo submitInfo = {};
+      submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submitInfo.commandBufferCount   = 1;
+      submitInfo.pCommandBuffers      = &band.cmds[q];
+      submitInfo.signalSemaphoreCount = 1;
+      submitInfo.pSignalSemaphores    = &band.computeDone[q];
+      VK_CHECK_RESULT(vkQueueSubmit(computeQueues[q].queue, 1, &submitInfo, VK_NULL_HANDLE));
+      waitFor.push_back(band.computeDone[q]);
+    }
+
+    const std::vector<VkPipelineStageFlags> waitStages(waitFor.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkSubmitInfo copySubmit = {};
+    copySubmit.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    copySubmit.waitSemaphoreCount = uint32_t(waitFor.size());
+    copySubmit.pWaitSemaphores    = waitFor.data();
+    copySubmit.pWaitDstStageMask  = waitStages.data();
+    copySubmit.commandBufferCount = 1;
+    copySubmit.pCommandBuffers    = &band.copyCmd;
+
+    bandFences[i] = pFences->Acquire();
+    VK_CHECK_RESULT(vkQueueSubmit(transferQueue, 1, &copySubmit, bandFences[i]));
+  }
+
+  // the file is created at its final size and every band is converted straight into its place in it
+  MappedFile file(a_fileName, BMPFileSize(int(kernel.width), int(kernel.height)));
+  WriteBMPHeader(file.Data(), int(kernel.width), int(kernel.height));
+  unsigned char* pixels = file.Data() + BMP_HEADER_SIZE;
+
+  // bands are taken in completion order, not file order: queues finish their tiles at different times,
+  // and later bands keep computing while the host converts the finished ones
+  std::vector<size_t> pending(bands.size());
+  for(size_t i = 0; i < pending.size(); ++i)
+    pending[i] = i;
+
+  std::vector<VkFence> pendingFences;
+  while(!pending.empty())
+  {
+    pendingFences.clear();
+    for(size_t i : pending)
+      pendingFences.push_back(bandFences[i]);
+
+    const auto waitStart = Clock::now();
+    VK_CHECK_RESULT(vkWaitForFences(device, uint32_t(pendingFences.size()), pendingFences.data(), VK_FALSE, FENCE_TIMEOUT));
+    const auto waitEnd = Clock::now();
+    stats.gpuWaitMs += msBetween(waitStart, waitEnd);
+
+    for(size_t k = 0; k < pending.size();)
+    {
+      const size_t i = pending[k];
+      if(vkGetFenceStatus(device, bandFences[i]) != VK_SUCCESS)
+      {
+        ++k;
+        continue;
+      }
+      pFences->Release(bandFences[i]);
+      pending.erase(pending.begin() + k);
+
+      const auto convertStart = Clock::now();
+      ConvertRowsToBMPPixels(a_stagingMapped, kernel, pixels, bands[i].rowBegin, bands[i].rowEnd, a_threads, a_simd);
+      stats.convertMs += msBetween(convertStart, Clock::now());
+    }
+  }
+
+  const auto closeStart = Clock::now();
+  file.Close();
+  stats.writeMs = msBetween(closeStart, Clock::now());
+
+  stats.endToEndMs = msBetween(start, Clock::now());
+  return stats;
+}
@@ -0,0 +1,73 @@
+#ifndef VK_ASYNC_COMPUTE_PIPELINED_READBACK_H
+#define VK_ASYNC_COMPUTE_PIPELINED_READBACK_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+#include "readback.h"
+
+struct PipelinedStats
+{
+  float endToEndMs = 0.0f; // first submit to the file being closed
+  float gpuWaitMs  = 0.0f; // host blocked on band fences
+  float convertMs  = 0.0f;
+  float writeMs    = 0.0f; // unmapping and closing the output file
+};
+
+// Renders the image band by band (a band is one row of tiles) and reads every band back as soon as it is done.
+// The tiles of a band are split over the compute queues like the static schedule; each compute submission signals
+// a semaphore, the copy of the band into the staging buffer waits on them on the transfer queue, and the host
+// converts finished bands, in whatever order they finish, into the memory-mapped output file while the following
+// bands are still being computed.
+class PipelinedReadback
+{
+public:
+  PipelinedReadback(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                    const KernelParams& a_kernel, vk_utils::FencePool* a_pFences);
+  ~PipelinedReadback();
+
+  PipelinedReadback(const PipelinedReadback&) = delete;
+  PipelinedReadback& operator=(const PipelinedReadback&) = delete;
+
+  void AddComputeQueue(VkQueue a_queue, VkCommandPool a_pool);
+  void SetTransferQueue(VkQueue a_queue, VkCommandPool a_pool);
+
+  // a_src and a_staging must be shared with the transfer family (or the transfer queue is one of the compute ones)
+  void Record(VkBuffer a_src, VkBuffer a_staging);
+
+  // one frame from submit to a_fileName on disk; a_stagingMapped is the host pointer of a_staging
+  PipelinedStats Run(const void* a_stagingMapped, const char* a_fileName, unsigned a_threads, SimdPath a_simd);
+
+  uint32_t BandsNum() const { return uint32_t(bands.size()); }
+
+private:
+  struct ComputeQueue
+  {
+    VkQueue       queue;
+    VkCommandPool pool;
+  };
+
+  struct Band
+  {
+    uint32_t                     rowBegin, rowEnd;
+    std::vector<VkCommandBuffer> cmds;       // per compute queue, VK_NULL_HANDLE if it has no tiles in this band
+    std::vector<VkSemaphore>     computeDone; // per compute queue
+    VkCommandBuffer              copyCmd;
+  };
+
+  VkDevice         device;
+  VkPipeline       pipeline;
+  VkPipelineLayout pipelineLayout;
+  VkDescriptorSet  descriptorSet;
+  KernelParams     kernel;
+
+  vk_utils::FencePool*      pFences;
+  std::vector<ComputeQueue> computeQueues;
+  VkQueue                   transferQueue = VK_NULL_HANDLE;
+  VkCommandPool             transferPool  = VK_NULL_HANDLE;
+  std::vector<Band>         bands;
+};
+
+#endif //VK_ASYNC_COMPUTE_PIPELINED_READBACK_H
@@ -0,0 +1,151 @@
+#include "precision.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// bits beyond the pixel size: the error of z = z^2 + c grows with every iteration near the set boundary
+static constexpr uint32_t PRECISION_GUARD_BITS = 8;
+
+// the perturbation deltas are floats: below this pixel size their squares and products flush to zero on the GPU
+static constexpr double PERTURBATION_MIN_STEP = 1e-30;
+
+// the reference orbit stops at the first point past this |Z|^2, from there on every pixel rebases to Z_0
+static constexpr double ORBIT_BAILOUT = 4.0;
+
+const char* PrecisionName(Precision a_mode)
+{
+  switch(a_mode)
+  {
+    case Precision::AUTO:         return "auto";
+    case Precision::FLOAT:        return "float";
+    case Precision::FLOAT_FLOAT:  return "float-float";
+    case Precision::DOUBLE:       return "double";
+    case Precision::PERTURBATION: return "perturbation";
+  }
+  return "unknown";
+}
+
+namespace
+{
+  // double-double: the unevaluated sum hi + lo with |lo| <= ulp(hi) / 2, about 106 significand bits
+  struct DoubleDouble
+  {
+    double hi;
+    double lo;
+  };
+
+  DoubleDouble twoSum(double a, double b)
+  {
+    const double s = a + b;
+    const double v = s - a;
+    return {s, (a - (s - v)) + (b - v)};
+  }
+
+  DoubleDouble quickTwoSum(double a, double b)
+  {
+    const double s = a + b;
+    return {s, b - (s - a)};
+  }
+
+  DoubleDouble add(DoubleDouble a, DoubleDouble b)
+  {
+    const DoubleDouble s = twoSum(a.hi, b.hi);
+    return quickTwoSum(s.hi, s.lo + a.lo + b.lo);
+  }
+
+  DoubleDouble mul(DoubleDouble a, DoubleDouble b)
+  {
+    const double p = a.hi * b.hi;
+    const double e = std::fma(a.hi, b.hi, -p) + (a.hi * b.lo + a.lo * b.hi);
+    return quickTwoSum(p, e);
+  }
+
+  void splitFloat(double a_value, float* a_pHi, float* a_pLo)
+  {
+    (*a_pHi) = float(a_value);
+    (*a_pLo) = float(a_value - double(*a_pHi));
+  }
+}
+
+size_t PrecisionBufferBytes(uint32_t a_iterations)
+{
+  return sizeof(PrecisionHeader) + (size_t(a_iterations) + 1) * 2 * sizeof(float);
+}
+
+uint32_t FillPrecisionBuffer(const DeepView& a_view, const KernelParams& a_kernel, void* a_mapped)
+{
+  PrecisionHeader header = {};
+  header.center[0]    = a_view.centerX;
+  header.center[1]    = a_view.centerY;
+  header.pixelStep[0] = a_view.scale / a_kernel.width;
+  header.pixelStep[1] = a_view.scale / a_kernel.height;
+  for(int i = 0; i < 2; ++i)
+  {
+    splitFloat(header.center[i],    &header.centerHi[i], &header.centerLo[i]);
+    splitFloat(header.pixelStep[i], &header.stepHi[i],   &header.stepLo[i]);
+  }
+
+  // the reference is the center itself, every pixel is a small float delta away from it
+  float* orbit = reinterpret_cast<float*>(static_cast<char*>(a_mapped) + sizeof(PrecisionHeader));
+  const DoubleDouble cx = {a_view.centerX, 0.0};
+  const DoubleDouble cy = {a_view.centerY, 0.0};
+  DoubleDouble zx = {0.0, 0.0};
+  DoubleDouble zy = {0.0, 0.0};
+
+  uint32_t length = 0;
+  orbit[2 * length + 0] = 0.0f;
+  orbit[2 * length + 1] = 0.0f;
+  ++length;
+  while(length <= a_kernel.iterations)
+  {
+    const DoubleDouble xx = mul(zx, zx);
+    const DoubleDouble yy = mul(zy, zy);
+    const DoubleDouble xy = mul(zx, zy);
+    zx = add(add(xx, {-yy.hi, -yy.lo}), cx);
+    zy = add(add(xy, xy), cy);
+
+    orbit[2 * length + 0] = float(zx.hi);
+    orbit[2 * length + 1] = float(zy.hi);
+    ++length;
+    if(zx.hi * zx.hi + zy.hi * zy.hi > ORBIT_BAILOUT)
+      break;
+  }
+
+  header.orbitLength = length;
+  memcpy(a_mapped, &header, sizeof(header));
+  return length;
+}
+
+uint32_t RequiredMantissaBits(const DeepView& a_view, const KernelParams& a_kernel)
+{
+  // the largest coordinate of the view over the smallest distance between two pixels
+  const double magnitude = std::max(std::abs(a_view.centerX), std::abs(a_view.centerY)) + a_view.scale / 2;
+  const double step      = a_view.scale / std::max(a_kernel.width, a_kernel.height);
+  return uint32_t(std::max(std::ceil(std::log2(magnitude / step)), 0.0)) + PRECISION_GUARD_BITS;
+}
+
+uint32_t PrecisionMantissaBits(Precision a_mode)
+{
+  switch(a_mode)
+  {
+    case Precision::FLOAT:        return 24;
+    case Precision::FLOAT_FLOAT:  return 40; // 2 x 24, less the error the emulated operations accumulate
+    case Precision::DOUBLE:       return 53;
+    case Precision::PERTURBATION: return 100; // the double-double reference orbit
+    default:                      return 0;
+  }
+}
+
+bool PrecisionAccurate(Precision a_mode, const DeepView& a_view, const KernelParams& a_kernel)
+{
+  if(a_mode == Precision::PERTURBATION)
+  {
+    // the deltas span the view, so they only need as many bits as the pixels of a row, but their exponent is a float's
+    const double step = a_view.scale / std::max(a_kernel.width, a_kernel.height);
+    const DeepView deltas = {0.0, 0.0, a_view.scale};
+    if(step < PERTURBATION_MIN_STEP || RequiredMantissaBits(deltas, a_kernel) > PrecisionMantissaBits(Precision::FLOAT))
+      return false;
+  }
+  return RequiredMantissaBits(a_view, a_kernel) <= PrecisionMantissaBits(a_mode);
+}
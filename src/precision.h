@@ -0,0 +1,58 @@
+#ifndef VK_ASYNC_COMPUTE_PRECISION_H
+#define VK_ASYNC_COMPUTE_PRECISION_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "kernel_params.h"
+
+// Arithmetic of the tile kernel (--precision). Float is shader.comp; the others resolve deeper views at a higher cost
+// per iteration and take the view from the precision buffer (binding 3) instead of the float uniforms.
+enum class Precision
+{
+  AUTO,         // benchmark the modes and render with the fastest one accurate at the view
+  FLOAT,        // shader.comp
+  FLOAT_FLOAT,  // shader_float_float.comp: unevaluated sums of two floats, close to twice the float bits, runs everywhere
+  DOUBLE,       // shader_fp64.comp: native doubles, needs shaderFloat64
+  PERTURBATION, // shader_perturbation.comp: float deltas around a reference orbit computed on the host
+};
+
+const char* PrecisionName(Precision a_mode);
+
+// The view at double precision: the pixel (x, y) maps to center + ((x, y) / (width, height) - 0.5) * scale,
+// like the float RenderParams.
+struct DeepView
+{
+  double centerX, centerY;
+  double scale;
+};
+
+// Header of the precision buffer, mirrored by shader_precision.h (std430). Every mode reads only its own fields;
+// the offsets of a pixel from the center are (x - width / 2, y - height / 2) times pixelStep.
+struct PrecisionHeader
+{
+  double   center[2];   // fp64
+  double   pixelStep[2];
+  float    centerHi[2]; // float-float, value = hi + lo
+  float    centerLo[2];
+  float    stepHi[2];   // also the pixel size of the perturbation deltas
+  float    stepLo[2];
+  uint32_t orbitLength; // perturbation: entries of the reference orbit that follows the header
+  uint32_t pad[3];
+};
+static_assert(sizeof(PrecisionHeader) == 80, "PrecisionHeader must match the std430 block of shader_precision.h");
+
+// the reference orbit Z_0 = 0, Z_1 ... as float pairs, at most the iteration limit + 1 entries
+size_t PrecisionBufferBytes(uint32_t a_iterations);
+
+// Fills the header for a_view and computes the reference orbit at its center in double-double arithmetic.
+// Returns the orbit length; a_mapped must hold PrecisionBufferBytes(a_kernel.iterations).
+uint32_t FillPrecisionBuffer(const DeepView& a_view, const KernelParams& a_kernel, void* a_mapped);
+
+// Significand bits needed to tell the pixels of a_view apart and leave a margin for the rounding error the
+// iterations accumulate; a mode is accurate if it carries at least as many.
+uint32_t RequiredMantissaBits(const DeepView& a_view, const KernelParams& a_kernel);
+uint32_t PrecisionMantissaBits(Precision a_mode);
+bool     PrecisionAccurate(Precision a_mode, const DeepView& a_view, const KernelParams& a_kernel);
+
+#endif //VK_ASYNC_COMPUTE_PRECISION_H
@@ -0,0 +1,237 @@
+#include "progressive.h"
+
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float msBetween(Clock::time_point a_start, Clock::time_point a_end)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(a_end - a_start).count() / 1000.f;
+}
+
+ProgressiveRenderer::ProgressiveRenderer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                                         const KernelParams& a_kernel, VkBuffer a_buffer, VkBuffer a_staging, const void* a_stagingMapped,
+                                         uint32_t a_coarsestStride, vk_utils::FencePool* a_pFences) :
+                                         device(a_device), pipeline(a_pipeline), pipelineLayout(a_layout), descriptorSet(a_ds),
+                                         kernel(a_kernel), buffer(a_buffer), staging(a_staging), stagingMapped(a_stagingMapped),
+                                         pFences(a_pFences)
+{
+  // strides are packed into 16 bits of the push constant
+  assert(a_coarsestStride > 0 && a_coarsestStride <= 0x8000u && (a_coarsestStride & (a_coarsestStride - 1)) == 0);
+  for(uint32_t stride = a_coarsestStride; stride > 0; stride /= 2)
+    strides.push_back(stride);
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+  for(auto& work : queues)
+  {
+    if(!work.cmds.empty())
+      vkFreeCommandBuffers(device, work.pool, uint32_t(work.cmds.size()), work.cmds.data());
+    vkDestroySemaphore(device, work.computeDone, nullptr);
+    vkDestroySemaphore(device, work.copyDone, nullptr);
+  }
+  if(copyCmd != VK_NULL_HANDLE)
+    vkFreeCommandBuffers(device, queues[0].pool, 1, &copyCmd);
+}
+
+size_t ProgressiveRenderer::PassSamples(const KernelParams& a_kernel, uint32_t a_stride, uint32_t a_prevStride)
+{
+  // samples are counted from the origin of every tile
+  auto onGrid = [&](uint32_t a_size, uint32_t a_step) { return size_t((a_size + a_step - 1) / a_step); };
+
+  size_t samples = 0;
+  for(uint32_t i = 0; i < a_kernel.TilesY(); ++i)
+  {
+    for(uint32_t j = 0; j < a_kernel.TilesX(); ++j)
+    {
+      const uint32_t sizeX = std::min(a_kernel.tileX, a_kernel.width  - a_kernel.tileX * j);
+      const uint32_t sizeY = std::min(a_kernel.tileY, a_kernel.height - a_kernel.tileY * i);
+      samples += onGrid(sizeX, a_stride) * onGrid(sizeY, a_stride);
+      if(a_prevStride != 0)
+        samples -= onGrid(sizeX, a_prevStride) * onGrid(sizeY, a_prevStride);
+    }
+  }
+  return samples;
+}
+
+void ProgressiveRenderer::AddQueue(VkQueue a_queue, VkCommandPool a_pool)
+{
+  assert(copyCmd == VK_NULL_HANDLE);
+
+  Queue work = {};
+  work.queue = a_queue;
+  work.pool  = a_pool;
+
+  VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+  semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &work.computeDone));
+  VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &work.copyDone));
+
+  queues.push_back(work);
+}
+
+void ProgressiveRenderer::Record()
+{
+  assert(!queues.empty() && copyCmd == VK_NULL_HANDLE);
+
+  const uint32_t nQueues = uint32_t(queues.size());
+  for(uint32_t i = 0; i < kernel.TilesY(); ++i)
+  {
+    for(uint32_t j = 0; j < kernel.TilesX(); ++j)
+    {
+      const TileRect tile = {kernel.tileX * j, kernel.tileY * i, std::min(kernel.tileX, kernel.width  - kernel.tileX * j),
+                             std::min(kernel.tileY, kernel.height - kernel.tileY * i), i * kernel.TilesX() + j};
+      queues[(i + j) % nQueues].tiles.push_back(tile);
+    }
+  }
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+  // no ONE_TIME_SUBMIT: the passes are replayed by every Run()
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = 0;
+
+  const uint32_t wg = kernel.workgroupSize;
+  for(auto& work : queues)
+  {
+    if(work.tiles.empty())
+      continue;
+
+    work.cmds.resize(strides.size());
+    commandBufferAllocateInfo.commandPool        = work.pool;
+    commandBufferAllocateInfo.commandBufferCount = uint32_t(work.cmds.size());
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, work.cmds.data()));
+
+    for(size_t pass = 0; pass < strides.size(); ++pass)
+    {
+      const uint32_t stride     = strides[pass];
+      const uint32_t prevStride = (pass == 0) ? 0 : strides[pass - 1];
+      VkCommandBuffer cmd = work.cmds[pass];
+
+      VK_CHECK_RESULT(vkBeginCommandBuffer(cmd, &beginInfo));
+      vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+      vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+
+      // one invocation per sample of the pass
+      for(const TileRect& tile : work.tiles)
+      {
+        const progressivePushConstants pcData {tile.offsetX, tile.offsetY, stride | (prevStride << 16)};
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pcData), &pcData);
+
+        const uint32_t samplesX = (tile.sizeX + stride - 1) / stride;
+        const uint32_t samplesY = (tile.sizeY + stride - 1) / stride;
+        vkCmdDispatch(cmd, (samplesX + wg - 1) / wg, (samplesY + wg - 1) / wg, 1);
+      }
+      VK_CHECK_RESULT(vkEndCommandBuffer(cmd));
+    }
+  }
+
+  commandBufferAllocateInfo.commandPool        = queues[0].pool;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &copyCmd));
+
+  // the compute of the pass is ordered before the copy by the semaphores the copy waits for
+  VK_CHECK_RESULT(vkBeginCommandBuffer(copyCmd, &beginInfo));
+
+  VkBufferCopy region = {};
+  region.size = kernel.ImageBytes();
+  vkCmdCopyBuffer(copyCmd, buffer, staging, 1, &region);
+
+  VkBufferMemoryBarrier toHost = {};
+  toHost.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  toHost.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toHost.dstAccessMask       = VK_ACCESS_HOST_READ_BIT;
+  toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.buffer              = staging;
+  toHost.offset              = 0;
+  toHost.size                = region.size;
+  vkCmdPipelineBarrier(copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                       0, nullptr, 1, &toHost, 0, nullptr);
+  VK_CHECK_RESULT(vkEndCommandBuffer(copyCmd));
+}
+
+// A pass overwrites blocks of the previous one, so it waits until the copy of the previous pass has read the buffer.
+void ProgressiveRenderer::submitCompute(uint32_t a_pass)
+{
+  const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+  for(auto& work : queues)
+  {
+    if(work.tiles.empty())
+      continue;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount   = (a_pass == 0) ? 0 : 1;
+    submitInfo.pWaitSemaphores      = &work.copyDone;
+    submitInfo.pWaitDstStageMask    = &waitStage;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &work.cmds[a_pass];
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &work.computeDone;
+    VK_CHECK_RESULT(vkQueueSubmit(work.queue, 1, &submitInfo, VK_NULL_HANDLE));
+  }
+}
+
+void ProgressiveRenderer::submitCopy(uint32_t a_pass, VkFence a_fence)
+{
+  std::vector<VkSemaphore> waitFor, signal;
+  for(const auto& work : queues)
+  {
+    if(work.tiles.empty())
+      continue;
+    waitFor.push_back(work.computeDone);
+    if(a_pass + 1 < PassesNum())
+      signal.push_back(work.copyDone);
+  }
+  const std::vector<VkPipelineStageFlags> waitStages(waitFor.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  VkSubmitInfo copySubmit = {};
+  copySubmit.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  copySubmit.waitSemaphoreCount   = uint32_t(waitFor.size());
+  copySubmit.pWaitSemaphores      = waitFor.data();
+  copySubmit.pWaitDstStageMask    = waitStages.data();
+  copySubmit.commandBufferCount   = 1;
+  copySubmit.pCommandBuffers      = &copyCmd;
+  copySubmit.signalSemaphoreCount = uint32_t(signal.size());
+  copySubmit.pSignalSemaphores    = signal.data();
+  VK_CHECK_RESULT(vkQueueSubmit(queues[0].queue, 1, &copySubmit, a_fence));
+}
+
+std::vector<ProgressivePass> ProgressiveRenderer::Run(const ProgressiveCallback& a_deliver)
+{
+  assert(copyCmd != VK_NULL_HANDLE);
+
+  std::vector<ProgressivePass> passes(strides.size());
+  const auto start = Clock::now();
+
+  submitCompute(0);
+  for(uint32_t pass = 0; pass < PassesNum(); ++pass)
+  {
+    VkFence fence = pFences->Acquire();
+    submitCopy(pass, fence);
+    if(pass + 1 < PassesNum())
+      submitCompute(pass + 1);
+
+    VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+    pFences->Release(fence);
+    passes[pass].readyMs = msBetween(start, Clock::now());
+
+    if(a_deliver)
+      a_deliver(pass, strides[pass], stagingMapped);
+    passes[pass].deliveredMs = msBetween(start, Clock::now());
+
+    passes[pass].stride  = strides[pass];
+    passes[pass].samples = PassSamples(kernel, strides[pass], (pass == 0) ? 0 : strides[pass - 1]);
+  }
+  return passes;
+}
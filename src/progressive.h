@@ -0,0 +1,93 @@
+#ifndef VK_ASYNC_COMPUTE_PROGRESSIVE_H
+#define VK_ASYNC_COMPUTE_PROGRESSIVE_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+#include "render_plan.h"
+
+// push constants of shader_progressive.comp: the start of the range of pushConstants, with the sample strides in place
+// of baseY (progressive passes always write a whole image buffer)
+struct progressivePushConstants
+{
+  uint32_t offX;
+  uint32_t offY;
+  uint32_t strides; // stride of the pass | stride of the previous pass << 16, 0 for the first pass
+};
+static_assert(sizeof(progressivePushConstants) == offsetof(pushConstants, sizeX), "progressive passes use the push constant range of the pipeline layout");
+
+struct ProgressivePass
+{
+  uint32_t stride      = 0;
+  size_t   samples     = 0;    // pixels evaluated by the pass, the rest are reused or filled
+  float    readyMs     = 0.0f; // since the first submit, until the host saw the pass in staging
+  float    deliveredMs = 0.0f; // since the first submit, until the callback returned
+};
+
+// called on the submitting thread with the staging mapping, while the next pass computes
+using ProgressiveCallback = std::function<void(uint32_t a_pass, uint32_t a_stride, const void* a_staging)>;
+
+// Coarse-to-fine rendering with shader_progressive.comp: the frame is rendered in passes of sample stride
+// a_coarsestStride, a_coarsestStride / 2, ... 1, every pass skipping the samples of the previous one, so the last pass
+// gives the single-pass image with no sample computed twice. Tiles are assigned to queues like the static schedule
+// and keep their queue in every pass. After every pass the first queue copies the image into staging (waiting for the
+// other queues on semaphores); the next pass is already submitted behind the copy while the host delivers the
+// partial image, and the copy of that next pass is submitted only after the delivery, so staging is not overwritten.
+// Command buffers are recorded once and replayed by every Run().
+class ProgressiveRenderer
+{
+public:
+  ProgressiveRenderer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                      const KernelParams& a_kernel, VkBuffer a_buffer, VkBuffer a_staging, const void* a_stagingMapped,
+                      uint32_t a_coarsestStride, vk_utils::FencePool* a_pFences);
+  ~ProgressiveRenderer();
+
+  ProgressiveRenderer(const ProgressiveRenderer&) = delete;
+  ProgressiveRenderer& operator=(const ProgressiveRenderer&) = delete;
+
+  // all queues must be added before Record(); the first queue also records the copies
+  void AddQueue(VkQueue a_queue, VkCommandPool a_pool);
+  void Record();
+
+  // returns one entry per pass, coarsest first
+  std::vector<ProgressivePass> Run(const ProgressiveCallback& a_deliver);
+
+  uint32_t PassesNum() const { return uint32_t(strides.size()); }
+
+  // pixels evaluated by a pass of a_stride after a pass of a_prevStride (0: none)
+  static size_t PassSamples(const KernelParams& a_kernel, uint32_t a_stride, uint32_t a_prevStride);
+
+private:
+  struct Queue
+  {
+    VkQueue                      queue;
+    VkCommandPool                pool;
+    std::vector<TileRect>        tiles;
+    std::vector<VkCommandBuffer> cmds;        // per pass
+    VkSemaphore                  computeDone; // waited by the copy of the pass
+    VkSemaphore                  copyDone;    // waited by the next pass
+  };
+
+  void submitCompute(uint32_t a_pass);
+  void submitCopy(uint32_t a_pass, VkFence a_fence);
+
+  VkDevice         device;
+  VkPipeline       pipeline;
+  VkPipelineLayout pipelineLayout;
+  VkDescriptorSet  descriptorSet;
+  KernelParams     kernel;
+  VkBuffer         buffer;
+  VkBuffer         staging;
+  const void*      stagingMapped;
+
+  vk_utils::FencePool*  pFences;
+  std::vector<uint32_t> strides; // per pass, coarsest first
+  std::vector<Queue>    queues;
+  VkCommandBuffer       copyCmd = VK_NULL_HANDLE; // from the pool of the first queue, the same for every pass
+};
+
+#endif //VK_ASYNC_COMPUTE_PROGRESSIVE_H
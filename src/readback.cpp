@@ -0,0 +1,302 @@
+#include "readback.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "Bitmap.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define READBACK_X86
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define READBACK_SSE2
+  #endif
+  // AVX2 code is compiled for this function only and selected at run time
+  #if defined(__GNUC__) || defined(__clang__)
+    #define READBACK_AVX2_FUNC __attribute__((target("avx2")))
+  #else
+    #define READBACK_AVX2_FUNC
+  #endif
+#endif
+
+static constexpr uint32_t MIN_ROWS_PER_THREAD = 16;
+
+struct ConvertContext
+{
+  uint32_t                   width;
+  std::vector<unsigned char> palette; // BGR per iteration count, OUTPUT_FORMAT_ITER16 and OUTPUT_FORMAT_SMOOTH32F only
+};
+
+typedef void (*RowConverter)(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx);
+
+static inline unsigned char FloatToByte(float a_value)
+{
+  const float v = 255.0f * a_value;
+  return (unsigned char)(v > 0.0f ? (v < 255.0f ? v : 255.0f) : 0.0f); // NaN goes to 0 as in the SIMD paths
+}
+
+static void ConvertRowRGBA32FScalar(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  const float* src = reinterpret_cast<const float*>(a_src);
+  for(uint32_t x = 0; x < a_ctx.width; ++x, src += 4, a_dst += 3)
+  {
+    a_dst[0] = FloatToByte(src[2]);
+    a_dst[1] = FloatToByte(src[1]);
+    a_dst[2] = FloatToByte(src[0]);
+  }
+}
+
+static void ConvertRowRGBA8Scalar(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  for(uint32_t x = 0; x < a_ctx.width; ++x, a_src += 4, a_dst += 3)
+  {
+    a_dst[0] = a_src[2];
+    a_dst[1] = a_src[1];
+    a_dst[2] = a_src[0];
+  }
+}
+
+// a table lookup per pixel; there is nothing left to vectorize here
+static void ConvertRowIter16(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  const uint16_t* src     = reinterpret_cast<const uint16_t*>(a_src);
+  const size_t    lastIdx = a_ctx.palette.size() / 3 - 1;
+  for(uint32_t x = 0; x < a_ctx.width; ++x, a_dst += 3)
+  {
+    const unsigned char* color = a_ctx.palette.data() + 3 * std::min<size_t>(src[x], lastIdx);
+    a_dst[0] = color[0];
+    a_dst[1] = color[1];
+    a_dst[2] = color[2];
+  }
+}
+
+// the fractional part of a smooth count is dropped, --colorize is the path that interpolates the palette
+static void ConvertRowSmooth32F(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  const float* src     = reinterpret_cast<const float*>(a_src);
+  const float  lastIdx = float(a_ctx.palette.size() / 3 - 1);
+  for(uint32_t x = 0; x < a_ctx.width; ++x, a_dst += 3)
+  {
+    const float          n     = src[x] > 0.0f ? std::min(src[x], lastIdx) : 0.0f; // NaN goes to 0
+    const unsigned char* color = a_ctx.palette.data() + 3 * size_t(n);
+    a_dst[0] = color[0];
+    a_dst[1] = color[1];
+    a_dst[2] = color[2];
+  }
+}
+
+#ifdef READBACK_SSE2
+static void ConvertRowRGBA32FSSE2(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  const float*  src   = reinterpret_cast<const float*>(a_src);
+  const __m128  scale = _mm_set1_ps(255.0f);
+
+  uint32_t x = 0;
+  for(; x + 4 <= a_ctx.width; x += 4, src += 16, a_dst += 12)
+  {
+    const __m128i p0 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src +  0), scale));
+    const __m128i p1 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src +  4), scale));
+    const __m128i p2 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src +  8), scale));
+    const __m128i p3 = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + 12), scale));
+
+    // saturating packs clamp to [0, 255]; SSE2 has no byte shuffle, so RGBA -> BGR is done on the 16 bytes
+    alignas(16) unsigned char rgba[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(rgba), _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+    for(int i = 0; i < 4; ++i)
+    {
+      a_dst[3 * i + 0] = rgba[4 * i + 2];
+      a_dst[3 * i + 1] = rgba[4 * i + 1];
+      a_dst[3 * i + 2] = rgba[4 * i + 0];
+    }
+  }
+
+  ConvertContext tail = {a_ctx.width - x, {}};
+  ConvertRowRGBA32FScalar(reinterpret_cast<const unsigned char*>(src), a_dst, tail);
+}
+#endif
+
+#ifdef READBACK_X86
+READBACK_AVX2_FUNC static inline void Store12(unsigned char* a_dst, __m128i a_value)
+{
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(a_dst), a_value);
+  const int32_t high = _mm_cvtsi128_si32(_mm_srli_si128(a_value, 8));
+  std::memcpy(a_dst + 8, &high, 4);
+}
+
+// 4 RGBA pixels of every 128-bit lane -> 12 BGR bytes at the bottom of the lane
+READBACK_AVX2_FUNC static inline __m256i RGBAToBGRLanes(__m256i a_rgba)
+{
+  const __m256i mask = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  return _mm256_shuffle_epi8(a_rgba, mask);
+}
+
+READBACK_AVX2_FUNC static void ConvertRowRGBA32FAVX2(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  const float*  src   = reinterpret_cast<const float*>(a_src);
+  const __m256  scale = _mm256_set1_ps(255.0f);
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+  uint32_t x = 0;
+  for(; x + 8 <= a_ctx.width; x += 8, src += 32, a_dst += 24)
+  {
+    const __m256i p01 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src +  0), scale));
+    const __m256i p23 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src +  8), scale));
+    const __m256i p45 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src + 16), scale));
+    const __m256i p67 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src + 24), scale));
+
+    // packs work per lane, which leaves the pixels as 0 2 4 6 | 1 3 5 7; the permute restores 0..7
+    __m256i rgba = _mm256_packus_epi16(_mm256_packs_epi32(p01, p23), _mm256_packs_epi32(p45, p67));
+    rgba = _mm256_permutevar8x32_epi32(rgba, order);
+
+    const __m256i bgr = RGBAToBGRLanes(rgba);
+    Store12(a_dst,      _mm256_castsi256_si128(bgr));
+    Store12(a_dst + 12, _mm256_extracti128_si256(bgr, 1));
+  }
+
+  ConvertContext tail = {a_ctx.width - x, {}};
+  ConvertRowRGBA32FScalar(reinterpret_cast<const unsigned char*>(src), a_dst, tail);
+}
+
+READBACK_AVX2_FUNC static void ConvertRowRGBA8AVX2(const unsigned char* a_src, unsigned char* a_dst, const ConvertContext& a_ctx)
+{
+  uint32_t x = 0;
+  for(; x + 8 <= a_ctx.width; x += 8, a_src += 32, a_dst += 24)
+  {
+    const __m256i bgr = RGBAToBGRLanes(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_src)));
+    Store12(a_dst,      _mm256_castsi256_si128(bgr));
+    Store12(a_dst + 12, _mm256_extracti128_si256(bgr, 1));
+  }
+
+  ConvertContext tail = {a_ctx.width - x, {}};
+  ConvertRowRGBA8Scalar(a_src, a_dst, tail);
+}
+#endif
+
+static bool CpuHasAVX2()
+{
+#if defined(READBACK_X86) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#elif defined(READBACK_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if(info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx     = (info[2] & (1 << 28)) != 0;
+  if(!osxsave || !avx || (_xgetbv(0) & 6) != 6) // the OS must save ymm registers
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+SimdPath DetectSimdPath(SimdPath a_limit)
+{
+  SimdPath best = SimdPath::SCALAR;
+#ifdef READBACK_SSE2
+  best = SimdPath::SSE2;
+#endif
+  if(CpuHasAVX2())
+    best = SimdPath::AVX2;
+  return std::min(best, a_limit);
+}
+
+const char* SimdPathName(SimdPath a_path)
+{
+  switch(a_path)
+  {
+    case SimdPath::AVX2: return "avx2";
+    case SimdPath::SSE2: return "sse2";
+    default:             return "scalar";
+  }
+}
+
+// the cosine palette of shader.comp, for OUTPUT_FORMAT_ITER16/SMOOTH32F where the GPU stores only iteration counts
+static std::vector<unsigned char> MakeIterationPalette(uint32_t a_maxIterations)
+{
+  static const float d[3] = { 0.3f,  0.3f,  0.5f};
+  static const float e[3] = {-0.2f, -0.3f, -0.5f};
+  static const float f[3] = { 2.1f,  2.0f,  3.0f};
+  static const float g[3] = { 0.0f,  0.1f,  0.0f};
+
+  const uint32_t entries = std::min<uint32_t>(a_maxIterations, 0xFFFF) + 1;
+  std::vector<unsigned char> palette(entries * 3);
+  for(uint32_t n = 0; n < entries; ++n)
+  {
+    const float t = float(n) / float(a_maxIterations);
+    for(int k = 0; k < 3; ++k)
+      palette[n * 3 + 2 - k] = FloatToByte(std::min(std::max(d[k] + e[k] * std::cos(6.28318f * (f[k] * t + g[k])), 0.0f), 1.0f));
+  }
+  return palette;
+}
+
+static RowConverter SelectConverter(uint32_t a_format, SimdPath a_path)
+{
+  if(a_format == OUTPUT_FORMAT_ITER16)
+    return &ConvertRowIter16;
+  if(a_format == OUTPUT_FORMAT_SMOOTH32F)
+    return &ConvertRowSmooth32F;
+
+#ifdef READBACK_X86
+  if(a_path == SimdPath::AVX2)
+    return a_format == OUTPUT_FORMAT_RGBA8 ? &ConvertRowRGBA8AVX2 : &ConvertRowRGBA32FAVX2;
+#endif
+#ifdef READBACK_SSE2
+  if(a_path == SimdPath::SSE2 && a_format == OUTPUT_FORMAT_RGBA32F)
+    return &ConvertRowRGBA32FSSE2;
+#endif
+  return a_format == OUTPUT_FORMAT_RGBA8 ? &ConvertRowRGBA8Scalar : &ConvertRowRGBA32FScalar;
+}
+
+void ConvertToBMPPixels(const void* a_src, const KernelParams& a_kernel, unsigned char* a_dst,
+                        unsigned a_threads, SimdPath a_path)
+{
+  ConvertRowsToBMPPixels(a_src, a_kernel, a_dst, 0, a_kernel.height, a_threads, a_path);
+}
+
+void ConvertRowsToBMPPixels(const void* a_src, const KernelParams& a_kernel, unsigned char* a_dst,
+                            uint32_t a_rowBegin, uint32_t a_rowEnd, unsigned a_threads, SimdPath a_path)
+{
+  ConvertContext ctx;
+  ctx.width = a_kernel.width;
+  if(a_kernel.outputFormat == OUTPUT_FORMAT_ITER16 || a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F)
+    ctx.palette = MakeIterationPalette(a_kernel.iterations);
+
+  const RowConverter convert   = SelectConverter(a_kernel.outputFormat, a_path);
+  const size_t       srcStride = size_t(a_kernel.width) * a_kernel.BytesPerPixel();
+  const size_t       dstStride = BMPRowStride(int(a_kernel.width));
+  const uint32_t     height    = a_rowEnd - a_rowBegin;
+
+  unsigned threads = (a_threads != 0) ? a_threads : std::max(1u, std::thread::hardware_concurrency());
+  threads = std::max(1u, std::min(threads, (height + MIN_ROWS_PER_THREAD - 1) / MIN_ROWS_PER_THREAD));
+
+  auto convertRows = [&](unsigned a_part)
+  {
+    const uint32_t rowBegin = a_rowBegin + uint32_t(uint64_t(height) * a_part / threads);
+    const uint32_t rowEnd   = a_rowBegin + uint32_t(uint64_t(height) * (a_part + 1) / threads);
+    for(uint32_t y = rowBegin; y < rowEnd; ++y)
+    {
+      unsigned char* dstRow = a_dst + y * dstStride;
+      convert(static_cast<const unsigned char*>(a_src) + y * srcStride, dstRow, ctx);
+      std::memset(dstRow + size_t(ctx.width) * 3, 0, dstStride - size_t(ctx.width) * 3);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for(unsigned t = 1; t < threads; ++t)
+    workers.emplace_back(convertRows, t);
+  convertRows(0);
+  for(auto& worker : workers)
+    worker.join();
+}
@@ -0,0 +1,29 @@
+#ifndef VK_ASYNC_COMPUTE_READBACK_H
+#define VK_ASYNC_COMPUTE_READBACK_H
+
+#include <cstdint>
+
+#include "kernel_params.h"
+
+// Instruction set used to convert the fractal buffer on the host.
+enum class SimdPath
+{
+  SCALAR,
+  SSE2,
+  AVX2,
+};
+
+// The best path supported by this CPU (and build), never above a_limit.
+SimdPath    DetectSimdPath(SimdPath a_limit = SimdPath::AVX2);
+const char* SimdPathName(SimdPath a_path);
+
+// Converts a fractal buffer in a_kernel.outputFormat into the pixel rows of a 24-bit BMP (BGR, rows padded to
+// BMPRowStride()), writing straight into a_dst. Rows are split over a_threads threads (0 means all hardware threads).
+void ConvertToBMPPixels(const void* a_src, const KernelParams& a_kernel, unsigned char* a_dst,
+                        unsigned a_threads, SimdPath a_path);
+
+// The same for rows [a_rowBegin, a_rowEnd) only; a_src and a_dst still point at the first row of the image.
+void ConvertRowsToBMPPixels(const void* a_src, const KernelParams& a_kernel, unsigned char* a_dst,
+                            uint32_t a_rowBegin, uint32_t a_rowEnd, unsigned a_threads, SimdPath a_path);
+
+#endif //VK_ASYNC_COMPUTE_READBACK_H
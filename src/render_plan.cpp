@@ -0,0 +1,604 @@
+#include "render_plan.h"
+
+#include <cassert>
+#include <algorithm>
+#include <thread>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <deque>
+
+#include "gpu_profiler.h"
+#include "tile_backend.h"
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float msBetween(Clock::time_point a_start, Clock::time_point a_end)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(a_end - a_start).count() / 1000.f;
+}
+
+// number of command buffers in submission 'a_iter' when 'a_total' buffers are split into chunks of 'a_perIter'
+static size_t submitCount(size_t a_total, size_t a_perIter, size_t a_iter)
+{
+  const size_t first = a_iter * a_perIter;
+  return (first >= a_total) ? 0 : std::min(a_perIter, a_total - first);
+}
+
+RenderPlan::RenderPlan(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                       uint32_t a_workgroupSize, vk_utils::FencePool* a_pFences) : device(a_device), pipeline(a_pipeline),
+                                                                                   pipelineLayout(a_layout), descriptorSet(a_ds),
+                                                                                   workgroupSize(a_workgroupSize), pFences(a_pFences)
+{
+}
+
+RenderPlan::~RenderPlan()
+{
+  freeCommandBuffers();
+  if(host.uploadCmd != VK_NULL_HANDLE)
+    vkFreeCommandBuffers(device, queues[0].pool, 1, &host.uploadCmd);
+}
+
+size_t RenderPlan::AddQueue(VkQueue a_queue, uint32_t a_family, VkCommandPool a_pool)
+{
+  QueueWork work = {};
+  work.queue  = a_queue;
+  work.family = a_family;
+  work.pool   = a_pool;
+  queues.push_back(work);
+  return queues.size() - 1;
+}
+
+void RenderPlan::AddTile(size_t a_queueId, const TileRect& a_tile)
+{
+  assert(a_queueId < queues.size());
+  queues[a_queueId].tiles.push_back(a_tile);
+  setTileQueue(a_tile.id, uint32_t(a_queueId));
+}
+
+void RenderPlan::AddSharedTile(const TileRect& a_tile)
+{
+  sharedTiles.push_back(a_tile);
+  setTileQueue(a_tile.id, uint32_t(-1));
+}
+
+void RenderPlan::setTileQueue(uint32_t a_tileId, uint32_t a_queueId)
+{
+  if(tileQueues.size() <= a_tileId)
+    tileQueues.resize(a_tileId + 1, uint32_t(-1));
+  tileQueues[a_tileId] = a_queueId;
+}
+
+void RenderPlan::SetHostBackend(TileBackend* a_backend, unsigned a_hostThreads, const KernelParams& a_kernel, const RenderParams* a_pParams,
+                                void* a_hostImage, VkBuffer a_hostImageBuffer, VkBuffer a_dstBuffer)
+{
+  assert(!queues.empty() && a_backend != nullptr && a_pParams != nullptr);
+
+  host.backend     = a_backend;
+  host.threads     = std::max(a_hostThreads, 1u);
+  host.kernel      = a_kernel;
+  host.pParams     = a_pParams;
+  host.image       = a_hostImage;
+  host.imageBuffer = a_hostImageBuffer;
+  host.dstBuffer   = a_dstBuffer;
+
+  if(host.uploadCmd == VK_NULL_HANDLE)
+  {
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = queues[0].pool;
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &host.uploadCmd));
+  }
+
+  msPerTile.assign(queues.size() + 1, 0.0f);
+}
+
+const GpuProfiler* RenderPlan::profilerFor(const QueueWork& a_work) const
+{
+  return (pProfiler != nullptr && pProfiler->FamilySupported(a_work.family)) ? pProfiler : nullptr;
+}
+
+void RenderPlan::freeCommandBuffers()
+{
+  for(auto& work : queues)
+  {
+    if(!work.cmds.empty())
+      vkFreeCommandBuffers(device, work.pool, uint32_t(work.cmds.size()), work.cmds.data());
+    if(!work.sharedCmds.empty())
+      vkFreeCommandBuffers(device, work.pool, uint32_t(work.sharedCmds.size()), work.sharedCmds.data());
+    work.cmds.clear();
+    work.sharedCmds.clear();
+  }
+
+  if(persistentCmd != VK_NULL_HANDLE)
+    vkFreeCommandBuffers(device, queues[0].pool, 1, &persistentCmd);
+  persistentCmd = VK_NULL_HANDLE;
+}
+
+size_t RenderPlan::CommandBuffersNum() const
+{
+  size_t res = 0;
+  for(const auto& work : queues)
+    res += work.cmds.size();
+  return res;
+}
+
+void RenderPlan::Record(uint32_t a_tilesPerCmd)
+{
+  freeCommandBuffers();
+
+  for(auto& work : queues)
+  {
+    if(work.tiles.empty())
+      continue;
+
+    const size_t perCmd = (a_tilesPerCmd == 0) ? work.tiles.size() : a_tilesPerCmd;
+    work.cmds.resize((work.tiles.size() + perCmd - 1) / perCmd);
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = work.pool;
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = uint32_t(work.cmds.size());
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, work.cmds.data()));
+
+    for(size_t i = 0; i < work.cmds.size(); ++i)
+    {
+      const size_t first = i * perCmd;
+      const size_t count = std::min(perCmd, work.tiles.size() - first);
+      recordTilesTo(work.cmds[i], pipeline, pipelineLayout, descriptorSet, workgroupSize,
+                    work.tiles.data() + first, count, profilerFor(work), 0, groupPerTile);
+    }
+  }
+}
+
+void RenderPlan::RecordShared(uint32_t a_tilesPerBatch)
+{
+  assert(a_tilesPerBatch > 0);
+
+  sharedBatches.clear();
+  for(size_t first = 0; first < sharedTiles.size(); first += a_tilesPerBatch)
+    sharedBatches.push_back({first, std::min(size_t(a_tilesPerBatch), sharedTiles.size() - first)});
+
+  if(sharedBatches.empty())
+    return;
+
+  // any queue may claim any batch, and a command buffer can only be submitted to the family of its pool,
+  // so every queue records its own copy
+  for(auto& work : queues)
+  {
+    if(!work.sharedCmds.empty())
+      vkFreeCommandBuffers(device, work.pool, uint32_t(work.sharedCmds.size()), work.sharedCmds.data());
+    work.sharedCmds.resize(sharedBatches.size());
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = work.pool;
+    commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = uint32_t(work.sharedCmds.size());
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, work.sharedCmds.data()));
+
+    for(size_t i = 0; i < sharedBatches.size(); ++i)
+      recordTilesTo(work.sharedCmds[i], pipeline, pipelineLayout, descriptorSet, workgroupSize,
+                    sharedTiles.data() + sharedBatches[i].first, sharedBatches[i].count, profilerFor(work), 0, groupPerTile);
+  }
+}
+
+void RenderPlan::RecordPersistent(VkBuffer a_tileCounter, uint32_t a_workgroups, uint32_t a_tilesNum)
+{
+  assert(!queues.empty() && a_workgroups > 0);
+
+  freeCommandBuffers();
+  persistentTiles = a_tilesNum;
+
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = queues[0].pool;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &persistentCmd));
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = 0;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(persistentCmd, &beginInfo));
+
+  // the atomics of the previous replay must be done before the counter is zeroed, and the zero visible to the kernel
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(persistentCmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdFillBuffer(persistentCmd, a_tileCounter, 0, sizeof(uint32_t), 0);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(persistentCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(persistentCmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+  vkCmdBindDescriptorSets(persistentCmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+  vkCmdDispatch(persistentCmd, a_workgroups, 1, 1);
+
+  VK_CHECK_RESULT(vkEndCommandBuffer(persistentCmd));
+}
+
+void RenderPlan::Replay(unsigned a_submitIters, bool a_multithreaded, std::vector<QueueStats>* a_pStats)
+{
+  std::vector<VkFence> fences(queues.size());
+  for(auto& fence : fences)
+    fence = pFences->Acquire();
+
+  std::vector<float> busy(queues.size(), 0.0f);
+  const auto wallStart = Clock::now();
+
+  if(a_multithreaded)
+  {
+    auto work = [](VkDevice d, VkQueue q, VkFence fence, const std::vector<VkCommandBuffer> &cmds, size_t nIters, float* pBusy){
+      std::cout << "thread " << std::this_thread::get_id() << " : using queue " << q << std::endl;
+      auto perIter = (cmds.size() + nIters - 1) / nIters;
+      for(size_t i = 0; i < nIters; ++i)
+      {
+        const auto submitStart = Clock::now();
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = uint32_t(submitCount(cmds.size(), perIter, i));
+        submitInfo.pCommandBuffers = cmds.data() + std::min(i * perIter, cmds.size());
+        VK_CHECK_RESULT(vkQueueSubmit(q, 1, &submitInfo, fence));
+        VK_CHECK_RESULT(vkWaitForFences(d, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+        vkResetFences(d, 1, &fence);
+        (*pBusy) += msBetween(submitStart, Clock::now());
+      }
+    };
+
+    std::vector<std::thread> workers(queues.size());
+    for(size_t q = 0; q < queues.size(); ++q)
+      workers[q] = std::thread(work, device, queues[q].queue, fences[q], std::cref(queues[q].cmds), a_submitIters, &busy[q]);
+
+    for(auto& worker : workers)
+    {
+      if(worker.joinable())
+        worker.join();
+    }
+  }
+  else
+  {
+    for(size_t i = 0; i < a_submitIters; ++i)
+    {
+      const auto submitStart = Clock::now();
+      for(size_t q = 0; q < queues.size(); ++q)
+      {
+        const auto& cmds = queues[q].cmds;
+        auto perIter = (cmds.size() + a_submitIters - 1) / a_submitIters;
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = uint32_t(submitCount(cmds.size(), perIter, i));
+        submitInfo.pCommandBuffers = cmds.data() + std::min(i * perIter, cmds.size());
+        VK_CHECK_RESULT(vkQueueSubmit(queues[q].queue, 1, &submitInfo, fences[q]));
+      }
+
+      if(a_pStats == nullptr)
+      {
+        VK_CHECK_RESULT(vkWaitForFences(device, uint32_t(fences.size()), fences.data(), VK_TRUE, FENCE_TIMEOUT));
+      }
+      else
+      {
+        // wait for any queue at a time to see when each of them finishes
+        std::vector<VkFence> pending = fences;
+        while(!pending.empty())
+        {
+          VK_CHECK_RESULT(vkWaitForFences(device, uint32_t(pending.size()), pending.data(), VK_FALSE, FENCE_TIMEOUT));
+          const auto now = Clock::now();
+          for(size_t q = 0; q < fences.size(); ++q)
+          {
+            auto it = std::find(pending.begin(), pending.end(), fences[q]);
+            if(it != pending.end() && vkGetFenceStatus(device, fences[q]) == VK_SUCCESS)
+            {
+              busy[q] += msBetween(submitStart, now);
+              pending.erase(it);
+            }
+          }
+        }
+      }
+      vkResetFences(device, uint32_t(fences.size()), fences.data());
+    }
+  }
+
+  for(auto fence : fences)
+    pFences->Release(fence);
+
+  if(a_pStats != nullptr)
+  {
+    const float wall = msBetween(wallStart, Clock::now());
+    a_pStats->resize(queues.size());
+    for(size_t q = 0; q < queues.size(); ++q)
+    {
+      (*a_pStats)[q].batches += uint32_t(queues[q].cmds.size());
+      (*a_pStats)[q].tiles   += uint32_t(queues[q].tiles.size());
+      (*a_pStats)[q].busyMs  += busy[q];
+      (*a_pStats)[q].idleMs  += std::max(wall - busy[q], 0.0f);
+    }
+  }
+}
+
+// Work stealing balances the participants by itself except at the end of the frame, where a slow participant
+// (the CPU next to a discrete GPU, or a weak iGPU next to the CPU) that claims one of the last batches holds the frame
+// up. So a participant claims a_tiles more only if, at its measured cost, it finishes them before all participants
+// together would finish everything left; the fastest one always claims. Costs come from earlier replays: the first
+// replay of a plan is plain work stealing.
+bool RenderPlan::worthClaiming(size_t a_participant, size_t a_tiles, size_t a_remainingTiles) const
+{
+  if(a_participant >= msPerTile.size() || msPerTile[a_participant] <= 0.0f)
+    return true;
+
+  const float own = msPerTile[a_participant];
+  float fastest   = own;
+  double tilesPerMs = 0.0;
+  for(float ms : msPerTile)
+  {
+    if(ms <= 0.0f)
+      continue;
+    tilesPerMs += 1.0 / ms;
+    fastest = std::min(fastest, ms);
+  }
+
+  if(own <= fastest)
+    return true;
+  return double(a_tiles) * own <= double(a_remainingTiles) / tilesPerMs;
+}
+
+void RenderPlan::ReplayDynamic(uint32_t a_batchesInFlight, std::vector<QueueStats>* a_pStats)
+{
+  assert(a_batchesInFlight > 0);
+
+  const size_t participants = queues.size() + (host.backend != nullptr ? 1 : 0);
+  const size_t perBatch     = sharedBatches.empty() ? 1 : sharedBatches.front().count;
+  msPerTile.resize(participants, 0.0f);
+
+  std::atomic<size_t> nextBatch(0);
+  std::vector<QueueStats> local(participants);
+
+  auto remainingTiles = [&]() {
+    return (sharedBatches.size() - std::min(nextBatch.load(), sharedBatches.size())) * perBatch;
+  };
+
+  // every thread owns one queue; keeping more than one batch in flight hides the submit latency
+  auto work = [&](size_t q){
+    std::deque<std::pair<VkFence, size_t> > pending;
+    auto busyStart = Clock::now();
+    bool exhausted = false;
+
+    while(true)
+    {
+      while(!exhausted && pending.size() < a_batchesInFlight)
+      {
+        if(host.backend != nullptr && !worthClaiming(q, perBatch, remainingTiles()))
+        {
+          exhausted = true;
+          break;
+        }
+
+        const size_t b = nextBatch.fetch_add(1);
+        if(b >= sharedBatches.size())
+        {
+          exhausted = true;
+          break;
+        }
+
+        VkFence fence = pFences->Acquire();
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &queues[q].sharedCmds[b];
+
+        // every batch is claimed by exactly one thread, so these writes never overlap
+        for(size_t t = 0; t < sharedBatches[b].count; ++t)
+          tileQueues[sharedTiles[sharedBatches[b].first + t].id] = uint32_t(q);
+
+        if(pending.empty())
+          busyStart = Clock::now();
+        VK_CHECK_RESULT(vkQueueSubmit(queues[q].queue, 1, &submitInfo, fence));
+        pending.emplace_back(fence, b);
+      }
+
+      if(pending.empty())
+        break;
+
+      VkFence fence = pending.front().first;
+      const size_t b = pending.front().second;
+      pending.pop_front();
+      VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+      pFences->Release(fence);
+
+      local[q].batches++;
+      local[q].tiles += uint32_t(sharedBatches[b].count);
+      if(pending.empty())
+        local[q].busyMs += msBetween(busyStart, Clock::now());
+    }
+  };
+
+  // the host backend claims enough consecutive batches at once to give every one of its threads a tile
+  std::vector<TileRect> hostTiles;
+  auto hostWork = [&]() {
+    const size_t p = queues.size();
+    const size_t batchesPerClaim = std::max<size_t>(1, (host.threads + perBatch - 1) / perBatch);
+
+    while(worthClaiming(p, batchesPerClaim * perBatch, remainingTiles()))
+    {
+      const size_t b0 = nextBatch.fetch_add(batchesPerClaim);
+      if(b0 >= sharedBatches.size())
+        break;
+
+      const size_t bEnd  = std::min(b0 + batchesPerClaim, sharedBatches.size());
+      const size_t first = sharedBatches[b0].first;
+      const size_t count = sharedBatches[bEnd - 1].first + sharedBatches[bEnd - 1].count - first;
+      for(size_t t = first; t < first + count; ++t)
+      {
+        tileQueues[sharedTiles[t].id] = uint32_t(p);
+        hostTiles.push_back(sharedTiles[t]);
+      }
+
+      const auto busyStart = Clock::now();
+      host.backend->RenderTiles(sharedTiles.data() + first, count, *host.pParams, host.image);
+      local[p].busyMs  += msBetween(busyStart, Clock::now());
+      local[p].batches += uint32_t(bEnd - b0);
+      local[p].tiles   += uint32_t(count);
+    }
+  };
+
+  const auto wallStart = Clock::now();
+
+  std::vector<std::thread> workers(queues.size());
+  for(size_t q = 0; q < queues.size(); ++q)
+    workers[q] = std::thread(work, q);
+  if(host.backend != nullptr)
+    workers.emplace_back(hostWork);
+
+  for(auto& worker : workers)
+  {
+    if(worker.joinable())
+      worker.join();
+  }
+
+  if(!hostTiles.empty())
+    uploadHostTiles(hostTiles);
+
+  // exponential average, so the costs follow a change of the view or of the load of the machine within a few frames
+  for(size_t p = 0; p < participants; ++p)
+  {
+    if(local[p].tiles == 0 || local[p].busyMs <= 0.0f)
+      continue;
+    const float sample = local[p].busyMs / float(local[p].tiles);
+    msPerTile[p] = (msPerTile[p] <= 0.0f) ? sample : 0.5f * (msPerTile[p] + sample);
+  }
+
+  if(a_pStats != nullptr)
+  {
+    const float wall = msBetween(wallStart, Clock::now());
+    a_pStats->resize(participants);
+    for(size_t p = 0; p < participants; ++p)
+    {
+      (*a_pStats)[p].batches += local[p].batches;
+      (*a_pStats)[p].tiles   += local[p].tiles;
+      (*a_pStats)[p].busyMs  += local[p].busyMs;
+      (*a_pStats)[p].idleMs  += std::max(wall - local[p].busyMs, 0.0f);
+    }
+  }
+}
+
+void RenderPlan::ReplayPersistent(std::vector<QueueStats>* a_pStats)
+{
+  assert(persistentCmd != VK_NULL_HANDLE);
+
+  VkFence fence = pFences->Acquire();
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &persistentCmd;
+
+  const auto submitStart = Clock::now();
+  VK_CHECK_RESULT(vkQueueSubmit(queues[0].queue, 1, &submitInfo, fence));
+  VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+  const float busy = msBetween(submitStart, Clock::now());
+  pFences->Release(fence);
+
+  if(a_pStats != nullptr)
+  {
+    // the other queues take no part, they are listed idle for the whole replay
+    a_pStats->resize(queues.size());
+    (*a_pStats)[0].batches += 1;
+    (*a_pStats)[0].tiles   += persistentTiles;
+    (*a_pStats)[0].busyMs  += busy;
+    for(size_t q = 1; q < queues.size(); ++q)
+      (*a_pStats)[q].idleMs += busy;
+  }
+}
+
+// Copies the rows of the tiles rendered by the host backend into the device buffer, on the first queue,
+// once every queue is done: the frame is then complete in the device buffer as with the GPU alone.
+void RenderPlan::uploadHostTiles(const std::vector<TileRect>& a_tiles)
+{
+  const VkDeviceSize bpp   = host.kernel.BytesPerPixel();
+  const VkDeviceSize width = host.kernel.width;
+
+  std::vector<VkBufferCopy> regions;
+  for(const auto& tile : a_tiles)
+  {
+    for(uint32_t y = tile.offsetY; y < tile.offsetY + tile.sizeY; ++y)
+    {
+      const VkDeviceSize offset = (VkDeviceSize(y) * width + tile.offsetX) * bpp;
+      regions.push_back({offset, offset, tile.sizeX * bpp});
+    }
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(host.uploadCmd, &beginInfo));
+
+  vkCmdCopyBuffer(host.uploadCmd, host.imageBuffer, host.dstBuffer, uint32_t(regions.size()), regions.data());
+
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(host.uploadCmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VK_CHECK_RESULT(vkEndCommandBuffer(host.uploadCmd));
+
+  VkFence fence = pFences->Acquire();
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &host.uploadCmd;
+  VK_CHECK_RESULT(vkQueueSubmit(queues[0].queue, 1, &submitInfo, fence));
+  VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+  pFences->Release(fence);
+}
+
+void RenderPlan::recordTilesTo(VkCommandBuffer a_cmdBuff, VkPipeline a_pipeline, VkPipelineLayout a_layout, const VkDescriptorSet& a_ds,
+                               uint32_t a_workgroupSize, const TileRect* a_tiles, size_t a_tilesNum,
+                               const GpuProfiler* a_pProfiler, uint32_t a_baseY, bool a_groupPerTile)
+{
+  // no ONE_TIME_SUBMIT: the buffer is recorded once and replayed many times
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = 0;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(a_cmdBuff, &beginInfo));
+
+  vkCmdBindPipeline(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, a_pipeline);
+  vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, a_layout, 0, 1, &a_ds, 0, NULL);
+
+  // tiles write disjoint parts of the buffer, so dispatches need no barriers between them
+  for(size_t i = 0; i < a_tilesNum; ++i)
+  {
+    const TileRect& tile = a_tiles[i];
+    pushConstants pcData {tile.offsetX, tile.offsetY, a_baseY, tile.sizeX, tile.sizeY, tile.originX, tile.originY};
+
+    vkCmdPushConstants(a_cmdBuff, a_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pcData), &pcData);
+
+    if(a_pProfiler != nullptr)
+      a_pProfiler->CmdTileBegin(a_cmdBuff, tile.id);
+
+    if(a_groupPerTile)
+      vkCmdDispatch(a_cmdBuff, 1, 1, 1);
+    else
+      vkCmdDispatch(a_cmdBuff, (tile.sizeX + a_workgroupSize - 1) / a_workgroupSize,
+                    (tile.sizeY + a_workgroupSize - 1) / a_workgroupSize,
+                    1);
+
+    if(a_pProfiler != nullptr)
+      a_pProfiler->CmdTileEnd(a_cmdBuff, tile.id);
+  }
+
+  VK_CHECK_RESULT(vkEndCommandBuffer(a_cmdBuff));
+}
@@ -0,0 +1,178 @@
+#ifndef VK_ASYNC_COMPUTE_RENDER_PLAN_H
+#define VK_ASYNC_COMPUTE_RENDER_PLAN_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+
+struct TileRect
+{
+  uint32_t offsetX, offsetY;
+  uint32_t sizeX, sizeY;
+  uint32_t id; // row-major index of the tile in the frame
+  float    originX = 0.0f, originY = 0.0f; // c of the first pixel, read by kernels specialized with KERNEL_FEATURE_TILE_ORIGIN
+};
+
+class GpuProfiler;
+class TileBackend;
+
+struct pushConstants
+{
+  uint32_t offX;
+  uint32_t offY;
+  uint32_t baseY; // first image row held by the bound buffer (banded rendering), 0 for a full image buffer
+  uint32_t sizeX, sizeY;     // only read with KERNEL_FEATURE_TILE_ORIGIN, the other kernels declare the members above
+  float    originX, originY;
+};
+
+// Data read by the kernel from a uniform buffer (binding 1).
+// It can be changed between replays of a recorded plan without touching command buffers.
+struct RenderParams
+{
+  float centerX, centerY;
+  float scale;
+  float pad;
+};
+
+// Host-observed activity of one queue during a replay: busy is the time at least one submission of this queue
+// was pending (submitted and not yet signaled), idle is the rest of the replay wall time.
+struct QueueStats
+{
+  uint32_t batches = 0;
+  uint32_t tiles   = 0;
+  float    busyMs  = 0.0f;
+  float    idleMs  = 0.0f;
+};
+
+// A tile layout that is recorded into command buffers once and then submitted as many times as needed.
+// Command buffers are recorded without ONE_TIME_SUBMIT and fences are taken from a shared pool,
+// so a replay costs only vkQueueSubmit + wait.
+// Record(n) puts n consecutive tiles of a queue into one command buffer: the pipeline and descriptor set
+// are bound once and every tile is a push constant + vkCmdDispatch. n == 1 gives one command buffer per tile.
+//
+// Tiles added with AddSharedTile() are not bound to a queue. RecordShared() splits them into batches and records
+// every batch for every queue, then ReplayDynamic() runs one submit thread per queue that claims the next batch
+// from a shared counter as soon as one of its own submissions completes (work stealing).
+//
+// RecordPersistent() is the third schedule: the pipeline is a persistent-threads kernel (shader_persistent.comp) and
+// the whole frame is one dispatch on the first queue whose workgroups claim tiles from a counter in device memory,
+// so the host issues no tile at all.
+//
+// SetHostBackend() makes the dynamic schedule hybrid: a host thread drives a TileBackend (the CPU) as one more
+// participant that claims batches from the same counter. Every participant's cost per tile is measured and carried
+// over to the next replay, where it keeps slow participants from claiming the last batches of the frame.
+class RenderPlan
+{
+public:
+  RenderPlan(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+             uint32_t a_workgroupSize, vk_utils::FencePool* a_pFences);
+  ~RenderPlan();
+
+  RenderPlan(const RenderPlan&) = delete;
+  RenderPlan& operator=(const RenderPlan&) = delete;
+
+  // returns index of the added queue
+  size_t AddQueue(VkQueue a_queue, uint32_t a_family, VkCommandPool a_pool);
+  void   AddTile(size_t a_queueId, const TileRect& a_tile);
+
+  void   AddSharedTile(const TileRect& a_tile);
+
+  // must be set before recording; tiles on queues whose family supports timestamps get begin/end queries
+  void   SetProfiler(const GpuProfiler* a_pProfiler) { pProfiler = a_pProfiler; }
+
+  // must be set before recording; every tile is dispatched as a single workgroup that covers the whole tile
+  // (shader_mariani_silver.comp) instead of one invocation per pixel
+  void   SetWorkgroupPerTile(bool a_enable) { groupPerTile = a_enable; }
+
+  // a_hostImage is the host mapping of a_hostImageBuffer, an image sized buffer laid out like a_dstBuffer (the buffer
+  // the pipeline writes); tiles rendered by a_backend are copied from it into a_dstBuffer at the end of every replay.
+  // a_pParams must stay valid, the backend reads it at every replay. Needs the queues added first.
+  void SetHostBackend(TileBackend* a_backend, unsigned a_hostThreads, const KernelParams& a_kernel, const RenderParams* a_pParams,
+                      void* a_hostImage, VkBuffer a_hostImageBuffer, VkBuffer a_dstBuffer);
+
+  void Record(uint32_t a_tilesPerCmd = 1);
+  void RecordShared(uint32_t a_tilesPerBatch);
+  // a_tileCounter is a device buffer of one uint (binding 2 of the descriptor set), zeroed at the start of every replay
+  void RecordPersistent(VkBuffer a_tileCounter, uint32_t a_workgroups, uint32_t a_tilesNum);
+
+  // stats, when given, are accumulated per queue; with a host backend its stats follow those of the queues
+  void Replay(unsigned a_submitIters, bool a_multithreaded, std::vector<QueueStats>* a_pStats = nullptr);
+  void ReplayDynamic(uint32_t a_batchesInFlight, std::vector<QueueStats>* a_pStats = nullptr);
+  void ReplayPersistent(std::vector<QueueStats>* a_pStats = nullptr);
+
+  size_t QueuesNum() const { return queues.size(); }
+  size_t TilesNum(size_t a_queueId) const { return queues[a_queueId].tiles.size(); }
+  size_t CommandBuffersNum() const;
+  size_t SharedBatchesNum() const { return sharedBatches.size(); }
+  bool   HasHostBackend() const { return host.backend != nullptr; }
+
+  // measured cost of a tile per participant (queues, then the host backend) in ms, 0 until measured
+  const std::vector<float>& MsPerTile() const { return msPerTile; }
+
+  // queue that executed every tile (indexed by TileRect::id) during the last replay, QueuesNum() for the host backend
+  const std::vector<uint32_t>& TileQueues() const { return tileQueues; }
+
+  static void recordTilesTo(VkCommandBuffer a_cmdBuff, VkPipeline a_pipeline, VkPipelineLayout a_layout, const VkDescriptorSet& a_ds,
+                            uint32_t a_workgroupSize, const TileRect* a_tiles, size_t a_tilesNum,
+                            const GpuProfiler* a_pProfiler = nullptr, uint32_t a_baseY = 0, bool a_groupPerTile = false);
+
+private:
+  struct QueueWork
+  {
+    VkQueue                      queue;
+    uint32_t                     family;
+    VkCommandPool                pool;
+    std::vector<TileRect>        tiles;
+    std::vector<VkCommandBuffer> cmds;
+    std::vector<VkCommandBuffer> sharedCmds; // own copy of every shared batch, indexed like sharedBatches
+  };
+
+  struct Batch
+  {
+    size_t first;
+    size_t count;
+  };
+
+  struct HostBackend
+  {
+    TileBackend*        backend = nullptr;
+    unsigned            threads = 1;
+    KernelParams        kernel;
+    const RenderParams* pParams = nullptr;
+    void*               image   = nullptr;
+    VkBuffer            imageBuffer = VK_NULL_HANDLE;
+    VkBuffer            dstBuffer   = VK_NULL_HANDLE;
+    VkCommandBuffer     uploadCmd   = VK_NULL_HANDLE; // from the pool of the first queue
+  };
+
+  void freeCommandBuffers();
+  bool worthClaiming(size_t a_participant, size_t a_tiles, size_t a_remainingTiles) const;
+  void uploadHostTiles(const std::vector<TileRect>& a_tiles);
+  const GpuProfiler* profilerFor(const QueueWork& a_work) const;
+  void setTileQueue(uint32_t a_tileId, uint32_t a_queueId);
+
+  VkDevice         device;
+  VkPipeline       pipeline;
+  VkPipelineLayout pipelineLayout;
+  VkDescriptorSet  descriptorSet;
+  uint32_t         workgroupSize;
+
+  vk_utils::FencePool*   pFences;
+  std::vector<QueueWork> queues;
+  std::vector<TileRect>  sharedTiles;
+  std::vector<Batch>     sharedBatches;
+  std::vector<uint32_t>  tileQueues;
+
+  const GpuProfiler*     pProfiler = nullptr;
+  bool                   groupPerTile = false;
+
+  VkCommandBuffer        persistentCmd   = VK_NULL_HANDLE; // from the pool of the first queue
+  uint32_t               persistentTiles = 0;
+
+  HostBackend            host;
+  std::vector<float>     msPerTile;
+};
+
+#endif //VK_ASYNC_COMPUTE_RENDER_PLAN_H
@@ -0,0 +1,148 @@
+#include "render_stats.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+bool RenderStats::operator==(const RenderStats& rhs) const
+{
+  return minCount == rhs.minCount && maxCount == rhs.maxCount && inSet == rhs.inSet && sum == rhs.sum &&
+         histogram == rhs.histogram;
+}
+
+RenderStats UnpackRenderStats(const RenderStatsData& a_data)
+{
+  RenderStats stats;
+  stats.minCount  = a_data.minCount;
+  stats.maxCount  = a_data.maxCount;
+  stats.inSet     = a_data.inSet;
+  stats.sum       = (uint64_t(a_data.sumHigh) << 32) | a_data.sumLow;
+  stats.histogram.assign(a_data.bins, a_data.bins + HISTOGRAM_BINS);
+  return stats;
+}
+
+RenderStats ComputeRenderStats(const void* a_counts, const KernelParams& a_kernel)
+{
+  RenderStats stats;
+  stats.minCount = 0xFFFFFFFFu;
+  stats.histogram.assign(HISTOGRAM_BINS, 0);
+
+  const size_t pixels = size_t(a_kernel.width) * a_kernel.height;
+  for(size_t i = 0; i < pixels; ++i)
+  {
+    uint32_t n;
+    if(a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F)
+      n = uint32_t(std::max(static_cast<const float*>(a_counts)[i], 0.0f));
+    else
+      n = static_cast<const uint16_t*>(a_counts)[i];
+
+    stats.histogram[std::min<uint32_t>(n * HISTOGRAM_BINS / a_kernel.iterations, HISTOGRAM_BINS - 1)]++;
+    stats.minCount = std::min(stats.minCount, n);
+    stats.maxCount = std::max(stats.maxCount, n);
+    stats.sum     += n;
+    if(n >= a_kernel.iterations)
+      stats.inSet++;
+  }
+  return stats;
+}
+
+void MakeEqualizationCdf(const RenderStats& a_stats, float* a_cdf)
+{
+  // pixels inside the set keep the end of the palette, they do not take a share of it
+  std::vector<uint32_t> escaping = a_stats.histogram;
+  escaping.back() -= std::min(escaping.back(), a_stats.inSet);
+
+  uint64_t total = 0;
+  for(uint32_t count : escaping)
+    total += count;
+
+  uint64_t below = 0;
+  for(uint32_t b = 0; b < HISTOGRAM_BINS; ++b)
+  {
+    a_cdf[b] = total != 0 ? float(double(below) / double(total)) : float(b) / float(HISTOGRAM_BINS);
+    below   += escaping[b];
+  }
+  a_cdf[HISTOGRAM_BINS] = 1.0f;
+}
+
+StatsReducer::StatsReducer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+                           const KernelParams& a_kernel, VkBuffer a_statsBuffer, VkBuffer a_readbackBuffer, const void* a_readbackMapped,
+                           VkQueue a_queue, VkCommandPool a_pool, vk_utils::FencePool* a_pFences)
+  : device(a_device), queue(a_queue), pool(a_pool), readbackMapped(a_readbackMapped), pFences(a_pFences)
+{
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = pool;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &cmd));
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(cmd, &beginInfo));
+
+  // minCount starts at ~0 so atomicMin works, everything else at 0; the fills do not overlap
+  static_assert(offsetof(RenderStatsData, minCount) == 0, "minCount is the first word of the stats buffer");
+  vkCmdFillBuffer(cmd, a_statsBuffer, 0, sizeof(uint32_t), 0xFFFFFFFFu);
+  vkCmdFillBuffer(cmd, a_statsBuffer, sizeof(uint32_t), sizeof(RenderStatsData) - sizeof(uint32_t), 0);
+
+  // the clear, and the counts written by the render (compute, or transfer for tiles of the host backend)
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_layout, 0, 1, &a_ds, 0, nullptr);
+  vkCmdDispatch(cmd, (a_kernel.width  + a_kernel.workgroupSize - 1) / a_kernel.workgroupSize,
+                     (a_kernel.height + a_kernel.workgroupSize - 1) / a_kernel.workgroupSize, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VkBufferCopy region = {};
+  region.size = sizeof(RenderStatsData);
+  vkCmdCopyBuffer(cmd, a_statsBuffer, a_readbackBuffer, 1, &region);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VK_CHECK_RESULT(vkEndCommandBuffer(cmd));
+}
+
+StatsReducer::~StatsReducer()
+{
+  vkFreeCommandBuffers(device, pool, 1, &cmd);
+}
+
+float StatsReducer::Run(RenderStats* a_pStats)
+{
+  VkFence fence = pFences->Acquire();
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cmd;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+  VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+  const auto end = std::chrono::high_resolution_clock::now();
+  pFences->Release(fence);
+
+  // the readback memory is host coherent, the fence wait is all the synchronization needed
+  RenderStatsData data;
+  std::memcpy(&data, readbackMapped, sizeof(RenderStatsData));
+  *a_pStats = UnpackRenderStats(data);
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.f;
+}
@@ -0,0 +1,72 @@
+#ifndef VK_ASYNC_COMPUTE_RENDER_STATS_H
+#define VK_ASYNC_COMPUTE_RENDER_STATS_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+
+// Layout of the stats buffer written by shader_histogram.comp (std430).
+struct RenderStatsData
+{
+  uint32_t minCount;
+  uint32_t maxCount;
+  uint32_t inSet;
+  uint32_t sumLow;
+  uint32_t sumHigh;
+  uint32_t pad[3];
+  uint32_t bins[HISTOGRAM_BINS];
+};
+
+// Statistics of a render of iteration counts; counts are whole iterations (smooth counts are truncated), bin b holds
+// the counts n with n * HISTOGRAM_BINS / iterations == b, the last bin also those at the iteration limit.
+struct RenderStats
+{
+  uint32_t              minCount = 0;
+  uint32_t              maxCount = 0;
+  uint32_t              inSet    = 0; // pixels that reached the iteration limit
+  uint64_t              sum      = 0;
+  std::vector<uint32_t> histogram;
+
+  double Mean(const KernelParams& a_kernel) const { return double(sum) / double(size_t(a_kernel.width) * a_kernel.height); }
+  bool   operator==(const RenderStats& rhs) const;
+};
+
+RenderStats UnpackRenderStats(const RenderStatsData& a_data);
+
+// The same statistics computed on the host from a readback of the counts (a_kernel.outputFormat ITER16 or SMOOTH32F).
+RenderStats ComputeRenderStats(const void* a_counts, const KernelParams& a_kernel);
+
+// Histogram equalization table of the colorize pass: a_cdf[b] (HISTOGRAM_BINS + 1 entries) is the share of the pixels
+// outside the set whose bin is below b, so a_cdf[0] == 0 and a_cdf[HISTOGRAM_BINS] == 1.
+void MakeEqualizationCdf(const RenderStats& a_stats, float* a_cdf);
+
+// The reduction pass of --stats: shader_histogram.comp over the iteration buffer, recorded once. Every run clears the
+// stats buffer, dispatches and copies the stats buffer (a few KB) into a host-visible readback buffer.
+class StatsReducer
+{
+public:
+  // a_readbackMapped is the persistent host mapping of a_readbackBuffer, at least sizeof(RenderStatsData) bytes
+  StatsReducer(VkDevice a_device, VkPipeline a_pipeline, VkPipelineLayout a_layout, VkDescriptorSet a_ds,
+               const KernelParams& a_kernel, VkBuffer a_statsBuffer, VkBuffer a_readbackBuffer, const void* a_readbackMapped,
+               VkQueue a_queue, VkCommandPool a_pool, vk_utils::FencePool* a_pFences);
+  ~StatsReducer();
+
+  StatsReducer(const StatsReducer&) = delete;
+  StatsReducer& operator=(const StatsReducer&) = delete;
+
+  // reduces the iteration buffer and waits; returns the time from submit to the fence in ms
+  float Run(RenderStats* a_pStats);
+
+private:
+  VkDevice             device;
+  VkQueue              queue;
+  VkCommandPool        pool;
+  VkCommandBuffer      cmd;
+  const void*          readbackMapped;
+  vk_utils::FencePool* pFences;
+};
+
+#endif //VK_ASYNC_COMPUTE_RENDER_STATS_H
@@ -0,0 +1,113 @@
+#include "shader_interface.h"
+
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+// the few SPIR-V enumerants needed here, from the SPIR-V specification
+static constexpr uint32_t SPIRV_MAGIC         = 0x07230203;
+static constexpr uint32_t SPIRV_HEADER_WORDS  = 5;
+static constexpr uint32_t SPIRV_OP_TYPE_INT    = 21;
+static constexpr uint32_t SPIRV_OP_TYPE_FLOAT  = 22;
+static constexpr uint32_t SPIRV_OP_TYPE_VECTOR = 23;
+static constexpr uint32_t SPIRV_OP_TYPE_STRUCT = 30;
+static constexpr uint32_t SPIRV_OP_TYPE_POINTER = 32;
+static constexpr uint32_t SPIRV_OP_VARIABLE    = 59;
+static constexpr uint32_t SPIRV_OP_DECORATE    = 71;
+static constexpr uint32_t SPIRV_OP_MEMBER_DECORATE = 72;
+static constexpr uint32_t SPIRV_DECORATION_SPEC_ID = 1;
+static constexpr uint32_t SPIRV_DECORATION_OFFSET  = 35;
+static constexpr uint32_t SPIRV_STORAGE_PUSH_CONSTANT = 9;
+
+ShaderInterface ReflectShaderInterface(const uint32_t* a_code, size_t a_bytes)
+{
+  const size_t words = a_bytes / sizeof(uint32_t);
+  if(words < SPIRV_HEADER_WORDS || a_code[0] != SPIRV_MAGIC)
+    throw std::runtime_error("ReflectShaderInterface: not a SPIR-V module");
+
+  ShaderInterface result;
+  std::unordered_map<uint32_t, uint32_t>              typeBytes;     // scalar and vector types
+  std::unordered_map<uint32_t, std::vector<uint32_t>> structMembers; // member types of each struct
+  std::unordered_map<uint32_t, std::vector<uint32_t>> memberOffsets;
+  std::unordered_map<uint32_t, uint32_t>              pointee;       // pointer type -> pointed type
+  uint32_t pushConstantPointer = 0;
+
+  for(size_t i = SPIRV_HEADER_WORDS; i < words;)
+  {
+    const uint32_t  opcode    = a_code[i] & 0xFFFF;
+    const uint32_t  wordCount = a_code[i] >> 16;
+    const uint32_t* op        = a_code + i;
+    if(wordCount == 0 || i + wordCount > words)
+      throw std::runtime_error("ReflectShaderInterface: truncated SPIR-V module");
+
+    switch(opcode)
+    {
+      case SPIRV_OP_DECORATE: // <target> SpecId <id>
+        if(wordCount >= 4 && op[2] == SPIRV_DECORATION_SPEC_ID)
+          result.specIds.push_back(op[3]);
+        break;
+      case SPIRV_OP_MEMBER_DECORATE: // <struct> <member> Offset <bytes>
+        if(wordCount >= 5 && op[3] == SPIRV_DECORATION_OFFSET)
+        {
+          std::vector<uint32_t>& offsets = memberOffsets[op[1]];
+          offsets.resize(std::max<size_t>(offsets.size(), op[2] + 1), 0);
+          offsets[op[2]] = op[4];
+        }
+        break;
+      case SPIRV_OP_TYPE_INT:
+      case SPIRV_OP_TYPE_FLOAT:
+        if(wordCount >= 3)
+          typeBytes[op[1]] = op[2] / 8;
+        break;
+      case SPIRV_OP_TYPE_VECTOR:
+        if(wordCount >= 4)
+          typeBytes[op[1]] = typeBytes[op[2]] * op[3];
+        break;
+      case SPIRV_OP_TYPE_STRUCT:
+        structMembers[op[1]].assign(op + 2, op + wordCount);
+        break;
+      case SPIRV_OP_TYPE_POINTER:
+        if(wordCount >= 4)
+          pointee[op[1]] = op[3];
+        break;
+      case SPIRV_OP_VARIABLE: // <type> <result> <storage class>
+        if(wordCount >= 4 && op[3] == SPIRV_STORAGE_PUSH_CONSTANT)
+          pushConstantPointer = op[1];
+        break;
+    }
+
+    i += wordCount;
+  }
+
+  if(pushConstantPointer != 0)
+  {
+    const uint32_t               block   = pointee[pushConstantPointer];
+    const std::vector<uint32_t>& members = structMembers[block];
+    const std::vector<uint32_t>& offsets = memberOffsets[block];
+    for(size_t m = 0; m < members.size() && m < offsets.size(); ++m)
+    {
+      // the push constant blocks of the kernels hold scalars and vectors only
+      const auto size = typeBytes.find(members[m]);
+      result.pushConstantBytes = std::max(result.pushConstantBytes,
+                                          offsets[m] + ((size != typeBytes.end()) ? size->second : uint32_t(sizeof(uint32_t))));
+    }
+  }
+  return result;
+}
+
+void CheckShaderInterface(const char* a_path, const uint32_t* a_code, size_t a_bytes, const ShaderRequirements& a_required)
+{
+  const ShaderInterface declared = ReflectShaderInterface(a_code, a_bytes);
+  for(uint32_t id : a_required.specIds)
+  {
+    if(std::find(declared.specIds.begin(), declared.specIds.end(), id) == declared.specIds.end())
+      throw std::runtime_error(std::string(a_path) + " declares no specialization constant " + std::to_string(id) +
+                               ", it was compiled from older shaders; rebuild the project or run shaders/compileShaders.sh");
+  }
+
+  if(declared.pushConstantBytes < a_required.pushConstantBytes)
+    throw std::runtime_error(std::string(a_path) + " reads " + std::to_string(declared.pushConstantBytes) + " of the " +
+                             std::to_string(a_required.pushConstantBytes) + " push constant bytes the host sets, it was " +
+                             "compiled from older shaders; rebuild the project or run shaders/compileShaders.sh");
+}
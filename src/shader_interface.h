@@ -0,0 +1,30 @@
+#ifndef VK_ASYNC_COMPUTE_SHADER_INTERFACE_H
+#define VK_ASYNC_COMPUTE_SHADER_INTERFACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// What the host relies on a kernel to declare. A module compiled from older sources than the executable misses some of
+// it and would run with its built-in image size and buffer layout, writing outside the buffers the host sized for
+// KernelParams, so it is rejected before a pipeline is created.
+struct ShaderRequirements
+{
+  std::vector<uint32_t> specIds;           // SPEC_ID_* from shaderCommon.h
+  uint32_t              pushConstantBytes = 0; // at least this much of the push constant range is read
+};
+
+// The same, as declared by a SPIR-V module.
+struct ShaderInterface
+{
+  std::vector<uint32_t> specIds;
+  uint32_t              pushConstantBytes = 0; // end of the last member of the push constant block, 0 without one
+};
+
+// Reads the decorations of a SPIR-V module; throws std::runtime_error if a_code is not SPIR-V.
+ShaderInterface ReflectShaderInterface(const uint32_t* a_code, size_t a_bytes);
+
+// Throws std::runtime_error naming a_path and the first requirement the module does not meet.
+void CheckShaderInterface(const char* a_path, const uint32_t* a_code, size_t a_bytes, const ShaderRequirements& a_required);
+
+#endif //VK_ASYNC_COMPUTE_SHADER_INTERFACE_H
@@ -0,0 +1,149 @@
+#include "supersampler.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+
+static constexpr unsigned long long FENCE_TIMEOUT = 100000000000ul;
+
+static_assert(sizeof(EdgeListHeader) == 32, "EdgeListHeader must match the std430 header of shaders/shader_edges.h");
+
+size_t EdgeListBytes(const KernelParams& a_kernel)
+{
+  return sizeof(EdgeListHeader) + size_t(a_kernel.width) * a_kernel.height * sizeof(uint32_t);
+}
+
+static float loadCount(const void* a_counts, const KernelParams& a_kernel, size_t a_index)
+{
+  if(a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F)
+    return static_cast<const float*>(a_counts)[a_index];
+  return float(static_cast<const uint16_t*>(a_counts)[a_index]);
+}
+
+size_t CountEdgePixels(const void* a_counts, const KernelParams& a_kernel, float a_threshold)
+{
+  assert(a_kernel.outputFormat == OUTPUT_FORMAT_ITER16 || a_kernel.outputFormat == OUTPUT_FORMAT_SMOOTH32F);
+
+  const uint32_t w = a_kernel.width;
+  const uint32_t h = a_kernel.height;
+  auto differs = [&](float a_count, uint32_t a_x, uint32_t a_y)
+  {
+    return std::fabs(a_count - loadCount(a_counts, a_kernel, size_t(a_y) * w + a_x)) > a_threshold;
+  };
+
+  size_t edges = 0;
+  for(uint32_t y = 0; y < h; ++y)
+  {
+    for(uint32_t x = 0; x < w; ++x)
+    {
+      const float count = loadCount(a_counts, a_kernel, size_t(y) * w + x);
+      if((x > 0 && differs(count, x - 1, y)) || (x + 1 < w && differs(count, x + 1, y)) ||
+         (y > 0 && differs(count, x, y - 1)) || (y + 1 < h && differs(count, x, y + 1)))
+        ++edges;
+    }
+  }
+  return edges;
+}
+
+EdgeSupersampler::EdgeSupersampler(VkDevice a_device, VkPipeline a_edgePipeline, VkPipelineLayout a_edgeLayout, VkDescriptorSet a_edgeSet,
+                                   VkPipeline a_samplePipeline, VkPipelineLayout a_sampleLayout, VkDescriptorSet a_sampleSet,
+                                   const KernelParams& a_kernel, VkBuffer a_edgeList, uint32_t a_grid, float a_threshold,
+                                   VkBuffer a_readbackBuffer, const void* a_readbackMapped,
+                                   VkQueue a_queue, VkCommandPool a_pool, vk_utils::FencePool* a_pFences)
+  : device(a_device), queue(a_queue), pool(a_pool), readbackMapped(a_readbackMapped), pFences(a_pFences)
+{
+  VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+  commandBufferAllocateInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferAllocateInfo.commandPool = pool;
+  commandBufferAllocateInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferAllocateInfo.commandBufferCount = 1;
+  VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &cmd));
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  VK_CHECK_RESULT(vkBeginCommandBuffer(cmd, &beginInfo));
+
+  // the counts of the render, the colors of the colorize pass, and the header read back by the previous run
+  VkMemoryBarrier barrier = {};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  // an empty list dispatches no supersample group
+  EdgeListHeader header = {};
+  header.groupsX   = 0;
+  header.groupsY   = 1;
+  header.groupsZ   = 1;
+  header.count     = 0;
+  header.grid      = a_grid;
+  header.threshold = a_threshold;
+  vkCmdUpdateBuffer(cmd, a_edgeList, 0, sizeof(header), &header);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_edgePipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_edgeLayout, 0, 1, &a_edgeSet, 0, nullptr);
+  vkCmdDispatch(cmd, (a_kernel.width  + a_kernel.workgroupSize - 1) / a_kernel.workgroupSize,
+                     (a_kernel.height + a_kernel.workgroupSize - 1) / a_kernel.workgroupSize, 1);
+
+  // the list and the dispatch size it wrote
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_samplePipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, a_sampleLayout, 0, 1, &a_sampleSet, 0, nullptr);
+  vkCmdDispatchIndirect(cmd, a_edgeList, offsetof(EdgeListHeader, groupsX));
+
+  // colors are read back by a copy, and so is the header
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VkBufferCopy region = {};
+  region.size = sizeof(EdgeListHeader);
+  vkCmdCopyBuffer(cmd, a_edgeList, a_readbackBuffer, 1, &region);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                       0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  VK_CHECK_RESULT(vkEndCommandBuffer(cmd));
+}
+
+EdgeSupersampler::~EdgeSupersampler()
+{
+  vkFreeCommandBuffers(device, pool, 1, &cmd);
+}
+
+float EdgeSupersampler::Run(uint32_t* a_pEdgePixels)
+{
+  VkFence fence = pFences->Acquire();
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &cmd;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+  VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, FENCE_TIMEOUT));
+  const auto end = std::chrono::high_resolution_clock::now();
+  pFences->Release(fence);
+
+  // the readback memory is host coherent, the fence wait is all the synchronization needed
+  EdgeListHeader header;
+  std::memcpy(&header, readbackMapped, sizeof(EdgeListHeader));
+  *a_pEdgePixels = header.count;
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.f;
+}
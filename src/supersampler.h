@@ -0,0 +1,59 @@
+#ifndef VK_ASYNC_COMPUTE_SUPERSAMPLER_H
+#define VK_ASYNC_COMPUTE_SUPERSAMPLER_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+#include "vk_utils.h"
+#include "kernel_params.h"
+
+// Header of the edge list buffer (shaders/shader_edges.h, std430), followed by one uint per pixel of the image.
+struct EdgeListHeader
+{
+  uint32_t groupsX;   // VkDispatchIndirectCommand of the supersample pass
+  uint32_t groupsY;
+  uint32_t groupsZ;
+  uint32_t count;
+  uint32_t grid;
+  float    threshold;
+  uint32_t pad[2];
+};
+
+// size of the edge list buffer for a_kernel: the header and room for every pixel
+size_t EdgeListBytes(const KernelParams& a_kernel);
+
+// Pixels of a readback of counts (a_kernel.outputFormat ITER16 or SMOOTH32F) that shader_edge_detect.comp puts into
+// the edge list: the count differs from one of the four neighbours by more than a_threshold.
+size_t CountEdgePixels(const void* a_counts, const KernelParams& a_kernel, float a_threshold);
+
+// The anti-aliasing passes of --supersample, recorded once and run after the colorize pass: the header of the edge
+// list is reset, shader_edge_detect.comp compacts the pixels on count boundaries into the list and sizes the indirect
+// dispatch of shader_supersample.comp, which recolors only those pixels from a_grid x a_grid samples each. The
+// number of edge pixels is copied into a host-visible readback buffer at the end of every run.
+class EdgeSupersampler
+{
+public:
+  // a_readbackMapped is the persistent host mapping of a_readbackBuffer, at least sizeof(EdgeListHeader) bytes
+  EdgeSupersampler(VkDevice a_device, VkPipeline a_edgePipeline, VkPipelineLayout a_edgeLayout, VkDescriptorSet a_edgeSet,
+                   VkPipeline a_samplePipeline, VkPipelineLayout a_sampleLayout, VkDescriptorSet a_sampleSet,
+                   const KernelParams& a_kernel, VkBuffer a_edgeList, uint32_t a_grid, float a_threshold,
+                   VkBuffer a_readbackBuffer, const void* a_readbackMapped,
+                   VkQueue a_queue, VkCommandPool a_pool, vk_utils::FencePool* a_pFences);
+  ~EdgeSupersampler();
+
+  EdgeSupersampler(const EdgeSupersampler&) = delete;
+  EdgeSupersampler& operator=(const EdgeSupersampler&) = delete;
+
+  // supersamples the edges of the colored image and waits; returns the time from submit to the fence in ms
+  float Run(uint32_t* a_pEdgePixels);
+
+private:
+  VkDevice             device;
+  VkQueue              queue;
+  VkCommandPool        pool;
+  VkCommandBuffer      cmd;
+  const void*          readbackMapped;
+  vk_utils::FencePool* pFences;
+};
+
+#endif //VK_ASYNC_COMPUTE_SUPERSAMPLER_H
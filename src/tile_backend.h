@@ -0,0 +1,22 @@
+#ifndef VK_ASYNC_COMPUTE_TILE_BACKEND_H
+#define VK_ASYNC_COMPUTE_TILE_BACKEND_H
+
+#include <cstddef>
+
+#include "render_plan.h"
+#include "kernel_params.h"
+
+// Something that renders tiles of the frame described by a KernelParams into host memory laid out like the
+// fractal buffer (row-major, KernelParams::outputFormat, a_dst points at the first pixel of the image).
+// RenderTiles() blocks until every given tile is written; tiles never overlap, so they may be split between
+// backends freely.
+class TileBackend
+{
+public:
+  virtual ~TileBackend() = default;
+
+  virtual const char* Name() const = 0;
+  virtual void        RenderTiles(const TileRect* a_tiles, size_t a_tilesNum, const RenderParams& a_params, void* a_dst) = 0;
+};
+
+#endif //VK_ASYNC_COMPUTE_TILE_BACKEND_H
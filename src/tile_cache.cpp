@@ -0,0 +1,199 @@
+#include "tile_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+static constexpr uint32_t TILE_FILE_MAGIC   = 0x45544156; // "VATE"
+static constexpr uint32_t TILE_FILE_VERSION = 2;
+
+struct TileFileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;  // guards against a file renamed into the wrong place
+  uint64_t size;
+};
+
+uint64_t HashBytes(const void* a_data, size_t a_size, uint64_t a_seed)
+{
+  uint64_t hash = a_seed;
+  const uint8_t* bytes = static_cast<const uint8_t*>(a_data);
+  for(size_t i = 0; i < a_size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+void GridCorner(const RenderParams& a_params, const KernelParams& a_kernel, int64_t* a_pX, int64_t* a_pY)
+{
+  *a_pX = std::llround((double(a_params.centerX) - 0.5 * a_params.scale) * a_kernel.width  / a_params.scale);
+  *a_pY = std::llround((double(a_params.centerY) - 0.5 * a_params.scale) * a_kernel.height / a_params.scale);
+}
+
+RenderParams SnapToPixelGrid(const RenderParams& a_params, const KernelParams& a_kernel)
+{
+  int64_t cornerX, cornerY;
+  GridCorner(a_params, a_kernel, &cornerX, &cornerY);
+
+  RenderParams snapped = a_params;
+  snapped.centerX = float(double(cornerX) * a_params.scale / a_kernel.width  + 0.5 * a_params.scale);
+  snapped.centerY = float(double(cornerY) * a_params.scale / a_kernel.height + 0.5 * a_params.scale);
+  return snapped;
+}
+
+// (offset, size) in the image of the tiles along one axis; a_first is the grid position of image pixel 0
+static std::vector<std::pair<uint32_t, uint32_t> > GridSpans(int64_t a_first, uint32_t a_imageSize, uint32_t a_tileSize)
+{
+  std::vector<std::pair<uint32_t, uint32_t> > spans;
+  const int64_t tile = a_tileSize;
+  for(uint32_t offset = 0; offset < a_imageSize; )
+  {
+    const int64_t pos  = a_first + offset;
+    const int64_t next = pos - ((pos % tile) + tile) % tile + tile; // first tile boundary right of pos, pos may be negative
+    const uint32_t size = uint32_t(std::min<int64_t>(next - pos, a_imageSize - offset));
+    spans.emplace_back(offset, size);
+    offset += size;
+  }
+  return spans;
+}
+
+std::vector<TileRect> MakeGridTiles(const KernelParams& a_kernel, float a_scale, int64_t a_gridX, int64_t a_gridY)
+{
+  const auto columns = GridSpans(a_gridX, a_kernel.width,  a_kernel.tileX);
+  const auto rows    = GridSpans(a_gridY, a_kernel.height, a_kernel.tileY);
+
+  std::vector<TileRect> tiles;
+  tiles.reserve(columns.size() * rows.size());
+  for(const auto& row : rows)
+  {
+    for(const auto& column : columns)
+    {
+      TileRect tile = {column.first, row.first, column.second, row.second, uint32_t(tiles.size())};
+      tile.originX = float(double(a_gridX + column.first) * a_scale / a_kernel.width);
+      tile.originY = float(double(a_gridY + row.first)    * a_scale / a_kernel.height);
+      tiles.push_back(tile);
+    }
+  }
+  return tiles;
+}
+
+uint64_t TileCacheKey(uint64_t a_variantHash, const KernelParams& a_kernel, float a_scale, const TileRect& a_tile)
+{
+  // the workgroup and tile sizes of the kernel do not change pixels, the size of this tile does
+  const uint32_t fields[] = {a_kernel.width, a_kernel.height, a_kernel.iterations, a_kernel.outputFormat, a_kernel.features,
+                             a_tile.sizeX, a_tile.sizeY};
+  const float    origin[] = {a_scale, a_tile.originX, a_tile.originY};
+  const uint64_t hash     = HashBytes(fields, sizeof(fields), HashBytes(&a_variantHash, sizeof(a_variantHash)));
+  return HashBytes(origin, sizeof(origin), hash);
+}
+
+TileCache::TileCache(size_t a_memoryBytes, const std::string& a_dir) : capacity(a_memoryBytes), dir(a_dir)
+{
+  std::error_code error;
+  if(!dir.empty() && !std::filesystem::is_directory(dir) && !std::filesystem::create_directories(dir, error))
+    throw std::runtime_error("can't create the tile cache directory " + dir);
+}
+
+const std::vector<uint8_t>* TileCache::Find(uint64_t a_key)
+{
+  auto it = index.find(a_key);
+  if(it != index.end())
+  {
+    lru.splice(lru.begin(), lru, it->second);
+    stats.memoryHits++;
+    return &lru.front().second;
+  }
+
+  std::vector<uint8_t> data;
+  if(!dir.empty() && readTile(a_key, &data))
+  {
+    stats.diskHits++;
+    return insertMemory(a_key, std::move(data));
+  }
+
+  stats.misses++;
+  return nullptr;
+}
+
+void TileCache::Insert(uint64_t a_key, const uint8_t* a_data, size_t a_size)
+{
+  if(!dir.empty())
+    writeTile(a_key, a_data, a_size);
+  insertMemory(a_key, std::vector<uint8_t>(a_data, a_data + a_size));
+}
+
+const std::vector<uint8_t>* TileCache::insertMemory(uint64_t a_key, std::vector<uint8_t>&& a_data)
+{
+  auto it = index.find(a_key);
+  if(it != index.end())
+  {
+    memoryBytes -= it->second->second.size();
+    lru.erase(it->second);
+    index.erase(it);
+  }
+
+  memoryBytes += a_data.size();
+  lru.emplace_front(a_key, std::move(a_data));
+  index[a_key] = lru.begin();
+
+  // the new tile is kept even if it alone is over capacity, it is returned to the caller
+  while(memoryBytes > capacity && lru.size() > 1)
+  {
+    memoryBytes -= lru.back().second.size();
+    index.erase(lru.back().first);
+    lru.pop_back();
+    stats.evictions++;
+  }
+  return &lru.front().second;
+}
+
+std::string TileCache::tilePath(uint64_t a_key) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.tile", (unsigned long long)a_key);
+  return (std::filesystem::path(dir) / name).string();
+}
+
+bool TileCache::readTile(uint64_t a_key, std::vector<uint8_t>* a_pData) const
+{
+  FILE* fp = fopen(tilePath(a_key).c_str(), "rb");
+  if(fp == nullptr)
+    return false;
+
+  TileFileHeader header;
+  bool ok = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == TILE_FILE_MAGIC &&
+            header.version == TILE_FILE_VERSION && header.key == a_key;
+  if(ok)
+  {
+    a_pData->resize(size_t(header.size));
+    ok = !a_pData->empty() && fread(a_pData->data(), a_pData->size(), 1, fp) == 1;
+  }
+  fclose(fp);
+  return ok;
+}
+
+void TileCache::writeTile(uint64_t a_key, const uint8_t* a_data, size_t a_size) const
+{
+  TileFileHeader header = {TILE_FILE_MAGIC, TILE_FILE_VERSION, a_key, a_size};
+
+  // write next to the target and rename, so a crash never leaves a truncated tile behind; a failed write only
+  // costs a future hit
+  const std::string path    = tilePath(a_key);
+  const std::string tmpPath = path + ".tmp";
+  FILE* fp = fopen(tmpPath.c_str(), "wb");
+  if(fp == nullptr)
+    return;
+
+  const bool written = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(a_data, a_size, 1, fp) == 1;
+  fclose(fp);
+
+  std::remove(path.c_str());
+  if(!written || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    std::remove(tmpPath.c_str());
+}
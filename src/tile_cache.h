@@ -0,0 +1,76 @@
+#ifndef VK_ASYNC_COMPUTE_TILE_CACHE_H
+#define VK_ASYNC_COMPUTE_TILE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+#include "render_plan.h"
+#include "kernel_params.h"
+
+// 64-bit FNV-1a, a_seed chains several calls.
+uint64_t HashBytes(const void* a_data, size_t a_size, uint64_t a_seed = 0xcbf29ce484222325ull);
+
+// The pixel grid of a scale puts pixel (gx, gy) at c = (gx * scale / width, gy * scale / height), the spacing of the
+// kernel's pixels. GridCorner() is the grid pixel nearest to the top left pixel of the view, SnapToPixelGrid() moves the
+// view center by less than a pixel so that the kernel's pixels of the view fall on the grid.
+void         GridCorner(const RenderParams& a_params, const KernelParams& a_kernel, int64_t* a_pX, int64_t* a_pY);
+RenderParams SnapToPixelGrid(const RenderParams& a_params, const KernelParams& a_kernel);
+
+// Tiles of the image whose top left pixel is grid pixel (a_gridX, a_gridY) at a_scale. Their boundaries fall on
+// multiples of the tile size on the grid rather than in the image, so a view panned by any number of pixels shares all
+// but its border tiles with the previous one; the tiles along the image border are cut by it. Every tile carries c of
+// its first pixel, computed in double from its grid position and rounded to float once, for KERNEL_FEATURE_TILE_ORIGIN.
+std::vector<TileRect> MakeGridTiles(const KernelParams& a_kernel, float a_scale, int64_t a_gridX, int64_t a_gridY);
+
+// Content address of a tile: the kernel (a_variantHash, e.g. of its SPIR-V), everything it is specialized with that
+// changes pixels, the scale, and the size and the exact origin bits of the tile. A kernel specialized with
+// KERNEL_FEATURE_TILE_ORIGIN computes every pixel from these alone, so tiles of equal keys hold equal pixels.
+uint64_t TileCacheKey(uint64_t a_variantHash, const KernelParams& a_kernel, float a_scale, const TileRect& a_tile);
+
+// Tile results by content address: an in-memory LRU tier of a_memoryBytes and, with a non empty a_dir, an unbounded
+// on-disk tier of one file per tile that outlives the process. Insert() writes both tiers, a disk hit is promoted
+// into memory. A tile is the raw fractal buffer rows of the tile, tightly packed.
+class TileCache
+{
+public:
+  struct Stats
+  {
+    size_t memoryHits = 0;
+    size_t diskHits   = 0;
+    size_t misses     = 0;
+    size_t evictions  = 0; // memory tier only
+  };
+
+  TileCache(size_t a_memoryBytes, const std::string& a_dir);
+
+  TileCache(const TileCache&) = delete;
+  TileCache& operator=(const TileCache&) = delete;
+
+  // returns nullptr on a miss; the pointer is valid until the next Find() or Insert()
+  const std::vector<uint8_t>* Find(uint64_t a_key);
+  void Insert(uint64_t a_key, const uint8_t* a_data, size_t a_size);
+
+  const Stats& GetStats() const { return stats; }
+  size_t       MemoryBytes() const { return memoryBytes; }
+  size_t       MemoryTiles() const { return lru.size(); }
+
+private:
+  typedef std::pair<uint64_t, std::vector<uint8_t> > Entry;
+
+  std::string tilePath(uint64_t a_key) const;
+  bool        readTile(uint64_t a_key, std::vector<uint8_t>* a_pData) const;
+  void        writeTile(uint64_t a_key, const uint8_t* a_data, size_t a_size) const;
+  const std::vector<uint8_t>* insertMemory(uint64_t a_key, std::vector<uint8_t>&& a_data);
+
+  size_t           capacity;
+  size_t           memoryBytes = 0;
+  std::string      dir;
+  std::list<Entry> lru; // most recently used first
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+  Stats            stats;
+};
+
+#endif //VK_ASYNC_COMPUTE_TILE_CACHE_H
@@ -184,26 +184,125 @@ uint32_t vk_utils::GetQueueFamilyIndex(VkPhysicalDevice a_physicalDevice, VkQueu
 }
 
 
-VkDevice vk_utils::CreateLogicalDevice(const std::vector<uint32_t> &queueFamilyIndices, VkPhysicalDevice physicalDevice, const std::vector<const char *>& a_enabledLayers, std::vector<const char *> a_extentions)
+std::vector<vk_utils::QueueSlot> vk_utils::FindComputeQueues(VkPhysicalDevice a_physicalDevice, uint32_t a_maxQueues)
 {
-  std::vector<VkDeviceQueueCreateInfo> qI;
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+  uint32_t maxPerFamily = 0;
+  for(const auto& props : queueFamilies)
+  {
+    if(props.queueFlags & VK_QUEUE_COMPUTE_BIT)
+      maxPerFamily = std::max(maxPerFamily, props.queueCount);
+  }
+
+  std::vector<QueueSlot> res;
+  for(uint32_t index = 0; index < maxPerFamily; ++index)
+  {
+    for(uint32_t family = 0; family < queueFamilyCount; ++family)
+    {
+      const auto& props = queueFamilies[family];
+      if(!(props.queueFlags & VK_QUEUE_COMPUTE_BIT) || index >= props.queueCount)
+        continue;
+
+      if(a_maxQueues != 0 && res.size() == a_maxQueues)
+        return res;
+
+      res.push_back({family, index});
+    }
+  }
+
+  if(res.empty())
+    RUN_TIME_ERROR("vk_utils::FindComputeQueues: no queue supports compute");
 
+  return res;
+}
+
+std::vector<uint32_t> vk_utils::UniqueFamilies(const std::vector<QueueSlot>& a_queues)
+{
+  std::vector<uint32_t> res;
+  for(const auto& slot : a_queues)
+  {
+    if(std::find(res.begin(), res.end(), slot.family) == res.end())
+      res.push_back(slot.family);
+  }
+  return res;
+}
+
+uint32_t vk_utils::FindDedicatedTransferFamily(VkPhysicalDevice a_physicalDevice)
+{
   uint32_t queueFamilyCount = 0;
-  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+  vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, nullptr);
 
   std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+  vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+  for(uint32_t family = 0; family < queueFamilyCount; ++family)
+  {
+    const VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+      return family;
+  }
 
-  assert(queueFamilyCount > queueFamilyIndices.size());
+  return uint32_t(-1);
+}
+
+bool vk_utils::DeviceExtensionSupported(VkPhysicalDevice a_physicalDevice, const char* a_name)
+{
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(a_physicalDevice, nullptr, &extensionCount, nullptr);
 
-  float queuePriorities = 0.0;
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(a_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+  for(const auto& ext : extensions)
+  {
+    if(strcmp(ext.extensionName, a_name) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+VkDevice vk_utils::CreateLogicalDevice(const std::vector<uint32_t> &queueFamilyIndices, VkPhysicalDevice physicalDevice, const std::vector<const char *>& a_enabledLayers, std::vector<const char *> a_extentions,
+                                       const VkPhysicalDeviceFeatures* a_pFeatures)
+{
+  std::vector<QueueSlot> queues;
   for(const auto& idx : queueFamilyIndices)
+    queues.push_back({idx, 0});
+
+  return CreateLogicalDevice(queues, physicalDevice, a_enabledLayers, std::move(a_extentions), a_pFeatures);
+}
+
+VkDevice vk_utils::CreateLogicalDevice(const std::vector<QueueSlot> &a_queues, VkPhysicalDevice physicalDevice, const std::vector<const char *>& a_enabledLayers, std::vector<const char *> a_extentions,
+                                       const VkPhysicalDeviceFeatures* a_pFeatures)
+{
+  std::vector<VkDeviceQueueCreateInfo> qI;
+
+  const std::vector<uint32_t> families = UniqueFamilies(a_queues);
+
+  std::vector<uint32_t> queueCounts(families.size(), 0);
+  for(const auto& slot : a_queues)
+  {
+    const size_t i = std::find(families.begin(), families.end(), slot.family) - families.begin();
+    queueCounts[i] = std::max(queueCounts[i], slot.index + 1);
+  }
+
+  uint32_t maxCount = 0;
+  for(auto count : queueCounts)
+    maxCount = std::max(maxCount, count);
+
+  std::vector<float> queuePriorities(maxCount, 0.0f);
+  for(size_t i = 0; i < families.size(); ++i)
   {
     VkDeviceQueueCreateInfo queueCreateInfo = {};
     queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo.queueFamilyIndex = idx;
-    queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = &queuePriorities;
+    queueCreateInfo.queueFamilyIndex = families[i];
+    queueCreateInfo.queueCount = queueCounts[i];
+    queueCreateInfo.pQueuePriorities = queuePriorities.data();
 
     qI.push_back(queueCreateInfo);
   }
@@ -211,6 +310,8 @@ VkDevice vk_utils::CreateLogicalDevice(const std::vector<uint32_t> &queueFamilyI
   VkDeviceCreateInfo deviceCreateInfo = {};
 
   VkPhysicalDeviceFeatures deviceFeatures = {};
+  if(a_pFeatures != nullptr)
+    deviceFeatures = (*a_pFeatures);
 
   deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   deviceCreateInfo.enabledLayerCount    = uint32_t(a_enabledLayers.size());
@@ -291,3 +392,35 @@ VkShaderModule vk_utils::CreateShaderModule(VkDevice a_device, const std::vector
 }
 
 
+
+vk_utils::FencePool::~FencePool()
+{
+  for(auto fence : allFences)
+    vkDestroyFence(device, fence, nullptr);
+}
+
+VkFence vk_utils::FencePool::Acquire()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!freeFences.empty())
+  {
+    VkFence fence = freeFences.back();
+    freeFences.pop_back();
+    return fence;
+  }
+
+  VkFence fence;
+  VkFenceCreateInfo fenceCreateInfo = {};
+  fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceCreateInfo.flags = 0;
+  VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
+  allFences.push_back(fence);
+  return fence;
+}
+
+void vk_utils::FencePool::Release(VkFence a_fence)
+{
+  VK_CHECK_RESULT(vkResetFences(device, 1, &a_fence));
+  std::lock_guard<std::mutex> guard(lock);
+  freeFences.push_back(a_fence);
+}
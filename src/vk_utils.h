@@ -5,6 +5,7 @@
 #include <vector>
 #include <stdexcept>
 #include <sstream>
+#include <mutex>
 
 
 namespace vk_utils
@@ -32,15 +33,62 @@ namespace vk_utils
   void       InitDebugReportCallback(VkInstance a_instance, DebugReportCallbackFuncType a_callback, VkDebugReportCallbackEXT* a_debugReportCallback);
   VkPhysicalDevice FindPhysicalDevice(VkInstance a_instance, bool a_printInfo, unsigned a_preferredDeviceId);
 
+  struct QueueSlot
+  {
+    uint32_t family;
+    uint32_t index; // index of the queue inside its family
+  };
+
   uint32_t GetQueueFamilyIndex(VkPhysicalDevice a_physicalDevice, VkQueueFlagBits a_bits);
   uint32_t GetComputeQueueFamilyIndex(VkPhysicalDevice a_physicalDevice);
+
+  // All queues of all families with VK_QUEUE_COMPUTE_BIT, at most a_maxQueues of them (0 means no limit).
+  // Families are interleaved (first queue of every family, then the second one, ...), so a small limit
+  // still spreads the queues over different families.
+  std::vector<QueueSlot> FindComputeQueues(VkPhysicalDevice a_physicalDevice, uint32_t a_maxQueues);
+  std::vector<uint32_t>  UniqueFamilies(const std::vector<QueueSlot>& a_queues);
+
+  // A family with VK_QUEUE_TRANSFER_BIT but neither graphics nor compute (usually backed by copy engines),
+  // uint32_t(-1) if the device has none.
+  uint32_t FindDedicatedTransferFamily(VkPhysicalDevice a_physicalDevice);
+
+  bool DeviceExtensionSupported(VkPhysicalDevice a_physicalDevice, const char* a_name);
+
+  // a_pFeatures: core features to enable, none if null
   VkDevice CreateLogicalDevice(const std::vector<uint32_t> &queueFamilyIndices, VkPhysicalDevice physicalDevice,
                                const std::vector<const char *>& a_enabledLayers = std::vector<const char *>(), 
-                               std::vector<const char *> a_extentions = std::vector<const char *>());
+                               std::vector<const char *> a_extentions = std::vector<const char *>(),
+                               const VkPhysicalDeviceFeatures* a_pFeatures = nullptr);
+  VkDevice CreateLogicalDevice(const std::vector<QueueSlot> &a_queues, VkPhysicalDevice physicalDevice,
+                               const std::vector<const char *>& a_enabledLayers = std::vector<const char *>(),
+                               std::vector<const char *> a_extentions = std::vector<const char *>(),
+                               const VkPhysicalDeviceFeatures* a_pFeatures = nullptr);
   uint32_t FindMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice);
 
   std::vector<uint32_t> ReadFile(const char* filename);
   VkShaderModule CreateShaderModule(VkDevice a_device, const std::vector<uint32_t>& code);
+
+  // Keeps fences alive between submissions so that replayed work does not create/destroy them every time.
+  // Acquire() returns an unsignaled fence, Release() resets it and puts it back. Thread safe.
+  class FencePool
+  {
+  public:
+    explicit FencePool(VkDevice a_device) : device(a_device) {}
+    ~FencePool();
+
+    FencePool(const FencePool&) = delete;
+    FencePool& operator=(const FencePool&) = delete;
+
+    VkFence Acquire();
+    void    Release(VkFence a_fence);
+    size_t  Size() const { return allFences.size(); }
+
+  private:
+    VkDevice             device;
+    std::vector<VkFence> freeFences;
+    std::vector<VkFence> allFences;
+    std::mutex           lock;
+  };
 };
 
 #undef  RUN_TIME_ERROR